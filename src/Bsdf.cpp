@@ -0,0 +1,110 @@
+#include "Bsdf.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// Perfectly smooth GGX is a delta distribution; clamp to keep f and pdf finite
+constexpr float kMinAlpha = 0.002f;
+
+float Luminance(const glm::vec3& c) {
+    return glm::dot(c, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+glm::vec3 SchlickFresnel(const glm::vec3& f0, float cos_theta) {
+    float m = 1.0f - std::min(std::max(cos_theta, 0.0f), 1.0f);
+    float m2 = m * m;
+    return f0 + (glm::vec3(1.0f) - f0) * (m2 * m2 * m);
+}
+
+}  // namespace
+
+ShadingFrame::ShadingFrame(const glm::vec3& n)
+    : normal(n) {
+    // Branchless basis (Duff et al. 2017)
+    float sign = std::copysign(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    tangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    bitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+Bsdf::Bsdf(const Material& material)
+    : diffuse_(material.base_color * (1.0f - material.metallic))
+    , f0_(glm::mix(glm::vec3(0.04f), material.base_color, material.metallic))
+    , alpha_(std::max(material.roughness * material.roughness, kMinAlpha)) {}
+
+float Bsdf::SpecularProbability(const glm::vec3& wo) const {
+    float specular = Luminance(SchlickFresnel(f0_, wo.z));
+    float diffuse = Luminance(diffuse_) * (1.0f - specular);
+    return std::min(std::max(specular / std::max(specular + diffuse, 1e-6f), 0.1f), 1.0f);
+}
+
+float Bsdf::SmithLambda(const glm::vec3& w) const {
+    float cos2 = w.z * w.z;
+    float tan2 = std::max(1.0f - cos2, 0.0f) / cos2;
+    return 0.5f * (std::sqrt(1.0f + alpha_ * alpha_ * tan2) - 1.0f);
+}
+
+glm::vec3 Bsdf::Evaluate(const glm::vec3& wo, const glm::vec3& wi, float& pdf) const {
+    pdf = 0.0f;
+    if (wo.z <= 0.0f || wi.z <= 0.0f) {
+        return glm::vec3(0.0f);
+    }
+    glm::vec3 h = glm::normalize(wo + wi);
+    float alpha2 = alpha_ * alpha_;
+    float d_denominator = h.z * h.z * (alpha2 - 1.0f) + 1.0f;
+    float d = alpha2 / (kPi * d_denominator * d_denominator);
+    float lambda_o = SmithLambda(wo);
+    float g2 = 1.0f / (1.0f + lambda_o + SmithLambda(wi));
+    glm::vec3 fresnel = SchlickFresnel(f0_, glm::dot(wo, h));
+
+    glm::vec3 specular = fresnel * (d * g2 / (4.0f * wo.z * wi.z));
+    glm::vec3 diffuse = (glm::vec3(1.0f) - fresnel) * diffuse_ * (1.0f / kPi);
+
+    // Visible normals: D_wo(h) / (4 wo.h) = G1(wo) D(h) / (4 wo.z)
+    float specular_pdf = d / ((1.0f + lambda_o) * 4.0f * wo.z);
+    float diffuse_pdf = wi.z * (1.0f / kPi);
+    float p = SpecularProbability(wo);
+    pdf = p * specular_pdf + (1.0f - p) * diffuse_pdf;
+    return specular + diffuse;
+}
+
+bool Bsdf::SampleDirection(const glm::vec3& wo, float lobe_u, const glm::vec2& u, Sample& sample) const {
+    if (wo.z <= 0.0f) {
+        return false;
+    }
+    if (lobe_u < SpecularProbability(wo)) {
+        // Visible normal sampling (Heitz 2018): stretch wo to the unit-roughness
+        // configuration, sample the projected hemisphere, unstretch
+        glm::vec3 vh = glm::normalize(glm::vec3(alpha_ * wo.x, alpha_ * wo.y, wo.z));
+        float length2 = vh.x * vh.x + vh.y * vh.y;
+        glm::vec3 t1 = length2 > 0.0f ? glm::vec3(-vh.y, vh.x, 0.0f) / std::sqrt(length2) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 t2 = glm::cross(vh, t1);
+        float r = std::sqrt(u.x);
+        float phi = 2.0f * kPi * u.y;
+        float p1 = r * std::cos(phi);
+        float p2 = r * std::sin(phi);
+        float s = 0.5f * (1.0f + vh.z);
+        p2 = (1.0f - s) * std::sqrt(std::max(1.0f - p1 * p1, 0.0f)) + s * p2;
+        glm::vec3 nh = t1 * p1 + t2 * p2 + vh * std::sqrt(std::max(1.0f - p1 * p1 - p2 * p2, 0.0f));
+        glm::vec3 h = glm::normalize(glm::vec3(alpha_ * nh.x, alpha_ * nh.y, std::max(nh.z, 0.0f)));
+        sample.wi = 2.0f * glm::dot(wo, h) * h - wo;
+    } else {
+        sample.wi = SampleCosineHemisphere(u);
+    }
+    if (sample.wi.z <= 0.0f) {
+        return false;
+    }
+    sample.f = Evaluate(wo, sample.wi, sample.pdf);
+    return sample.pdf > 0.0f;
+}
+
+glm::vec3 Bsdf::SampleCosineHemisphere(const glm::vec2& u) {
+    float r = std::sqrt(u.x);
+    float phi = 2.0f * kPi * u.y;
+    return glm::vec3(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(1.0f - u.x, 0.0f)));
+}
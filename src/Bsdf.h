@@ -0,0 +1,52 @@
+#pragma once
+#include "long_march.h"
+#include "Material.h"
+
+// Orthonormal basis around a shading normal; local directions have z along the normal
+struct ShadingFrame {
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+    glm::vec3 normal;
+
+    explicit ShadingFrame(const glm::vec3& n);
+
+    glm::vec3 ToLocal(const glm::vec3& v) const {
+        return glm::vec3(glm::dot(v, tangent), glm::dot(v, bitangent), glm::dot(v, normal));
+    }
+    glm::vec3 ToWorld(const glm::vec3& v) const { return tangent * v.x + bitangent * v.y + normal * v.z; }
+};
+
+// Metallic-roughness BSDF of a Material (the glTF model): a Lambertian base weighted by
+// (1 - metallic) and (1 - F), plus a GGX specular lobe with Schlick Fresnel (F0 is 0.04
+// for dielectrics and base_color for metals) and height-correlated Smith masking
+// All directions are local to the ShadingFrame and point away from the surface
+// Sampling picks the specular lobe (visible-normal sampling) or the diffuse one
+// (cosine-weighted) by their estimated reflectance; pdfs are for the combined strategy
+class Bsdf {
+public:
+    explicit Bsdf(const Material& material);
+
+    struct Sample {
+        glm::vec3 wi;
+        glm::vec3 f;
+        float pdf;
+    };
+
+    // f(wo, wi) (without the cosine) and the pdf of sampling wi
+    glm::vec3 Evaluate(const glm::vec3& wo, const glm::vec3& wi, float& pdf) const;
+
+    // Choose wi from a uniform number for the lobe and a 2D one for the direction;
+    // false if the sample is below the surface or has zero pdf
+    bool SampleDirection(const glm::vec3& wo, float lobe_u, const glm::vec2& u, Sample& sample) const;
+
+    // Cosine-weighted direction on the local hemisphere (pdf = z / pi)
+    static glm::vec3 SampleCosineHemisphere(const glm::vec2& u);
+
+private:
+    float SpecularProbability(const glm::vec3& wo) const;
+    float SmithLambda(const glm::vec3& w) const;
+
+    glm::vec3 diffuse_;  // Lambertian albedo, base_color * (1 - metallic)
+    glm::vec3 f0_;       // Specular reflectance at normal incidence
+    float alpha_;        // GGX width, roughness squared
+};
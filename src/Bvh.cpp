@@ -0,0 +1,476 @@
+#include "Bvh.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+
+namespace {
+
+constexpr int kBinCount = 16;
+constexpr float kTraversalCost = 1.0f;       // Relative to one triangle test
+constexpr size_t kMinSubtreeSize = 1024;     // Smaller ranges are never worth a task of their own
+constexpr size_t kParallelGrain = 16384;     // Primitives per chunk when binning/partitioning in parallel
+
+// Primitive reference carrying its bounds, so binning and partitioning stream through
+// one array instead of gathering from per-primitive tables
+struct PrimRef {
+    Aabb bounds;
+    uint32_t prim;
+
+    glm::vec3 Centroid() const { return bounds.Center(); }
+};
+
+struct Bin {
+    Aabb bounds;
+    uint32_t count = 0;
+};
+
+struct BinSet {
+    Bin bins[3][kBinCount];
+    Aabb bounds;
+    Aabb centroid_bounds;
+};
+
+}  // namespace
+
+struct Bvh::BuildContext {
+    std::vector<PrimRef> refs;
+    std::vector<PrimRef> scratch;
+    uint32_t max_leaf_size;
+};
+
+std::string BvhBuildStats::LeafHistogramString() const {
+    std::string result;
+    for (size_t size = 1; size < leaf_size_histogram.size(); ++size) {
+        if (leaf_size_histogram[size] == 0) {
+            continue;
+        }
+        if (!result.empty()) {
+            result += ' ';
+        }
+        result += std::to_string(size) + ":" + std::to_string(leaf_size_histogram[size]);
+    }
+    return result;
+}
+
+void Bvh::Build(const glm::vec3* positions, const uint32_t* indices, size_t num_triangles) {
+    auto start_time = std::chrono::steady_clock::now();
+
+    nodes_.clear();
+    triangles_.clear();
+    triangle_data_ = nullptr;
+    triangle_count_ = 0;
+    wide_.Clear();
+    bounds_ = Aabb();
+    stats_ = BvhBuildStats();
+    if (num_triangles == 0) {
+        return;
+    }
+
+    std::vector<uint32_t> order;
+    BuildHierarchy(num_triangles, [&](size_t i) {
+        Aabb box;
+        box.Expand(positions[indices[i * 3 + 0]]);
+        box.Expand(positions[indices[i * 3 + 1]]);
+        box.Expand(positions[indices[i * 3 + 2]]);
+        return box;
+    }, kMaxLeafSize, nodes_, order);
+    bounds_ = nodes_[0].bounds;
+
+    // Store triangles in leaf order so each leaf reads a contiguous range
+    triangles_.resize(num_triangles);
+    ThreadPool::Global().ParallelFor(num_triangles, kParallelGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t prim = order[i];
+            const glm::vec3& v0 = positions[indices[prim * 3 + 0]];
+            const glm::vec3& v1 = positions[indices[prim * 3 + 1]];
+            const glm::vec3& v2 = positions[indices[prim * 3 + 2]];
+            triangles_[i] = BvhTriangle{ v0, v1 - v0, v2 - v0, prim };
+        }
+    });
+    triangle_data_ = triangles_.data();
+    triangle_count_ = triangles_.size();
+    wide_.Build(nodes_);
+
+    stats_.build_time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    ComputeStats();
+}
+
+void Bvh::BuildHierarchy(size_t count, const std::function<Aabb(size_t)>& prim_bounds, uint32_t max_leaf_size,
+                         std::vector<BvhNode>& nodes, std::vector<uint32_t>& order) {
+    nodes.clear();
+    order.clear();
+    if (count == 0) {
+        return;
+    }
+
+    ThreadPool& pool = ThreadPool::Global();
+    BuildContext context;
+    context.refs.resize(count);
+    context.scratch.resize(count);
+    context.max_leaf_size = max_leaf_size;
+    pool.ParallelFor(count, kParallelGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            context.refs[i] = PrimRef{ prim_bounds(i), static_cast<uint32_t>(i) };
+        }
+    });
+
+    // Top of the tree: split the large nodes one at a time, parallelizing the work inside
+    // each split, until there are enough independent subtrees to keep every thread busy
+    size_t subtree_threshold = std::max(kMinSubtreeSize, count / (pool.GetThreadCount() * 8));
+    nodes.emplace_back();
+    std::vector<BuildTask> pending{ BuildTask{ 0, 0, static_cast<uint32_t>(count), 0 } };
+    std::vector<BuildTask> subtrees;
+    while (!pending.empty()) {
+        BuildTask task = pending.back();
+        pending.pop_back();
+        if (task.end - task.begin <= subtree_threshold) {
+            subtrees.push_back(task);
+            continue;
+        }
+
+        uint32_t mid = 0;
+        Aabb bounds;
+        bool split = FindSplit(context, task, bounds, mid, true);
+        nodes[task.node_index].bounds = bounds;
+        if (!split) {
+            nodes[task.node_index].offset = task.begin;
+            nodes[task.node_index].count = task.end - task.begin;
+            continue;
+        }
+        uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + 2);
+        nodes[task.node_index].offset = left;
+        nodes[task.node_index].count = 0;
+        pending.push_back(BuildTask{ left + 1, mid, task.end, task.depth + 1 });
+        pending.push_back(BuildTask{ left, task.begin, mid, task.depth + 1 });
+    }
+
+    // Build the subtrees as parallel tasks, biggest first, each into its own node array
+    std::sort(subtrees.begin(), subtrees.end(), [](const BuildTask& a, const BuildTask& b) {
+        return a.end - a.begin > b.end - b.begin;
+    });
+    std::vector<std::vector<BvhNode>> subtree_nodes(subtrees.size());
+    pool.ParallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            BuildSubtree(context, subtrees[i], subtree_nodes[i]);
+        }
+    });
+
+    // Splice: local node 0 replaces the placeholder at the task's node, the rest is appended
+    std::vector<uint32_t> bases(subtrees.size());
+    size_t total_nodes = nodes.size();
+    for (size_t i = 0; i < subtrees.size(); ++i) {
+        bases[i] = static_cast<uint32_t>(total_nodes);
+        total_nodes += subtree_nodes[i].size() - 1;
+    }
+    nodes.resize(total_nodes);
+    pool.ParallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<BvhNode>& local = subtree_nodes[i];
+            uint32_t base = bases[i];
+            auto relocate = [base](BvhNode node) {
+                if (!node.IsLeaf()) {
+                    node.offset = base + node.offset - 1;
+                }
+                return node;
+            };
+            nodes[subtrees[i].node_index] = relocate(local[0]);
+            for (size_t k = 1; k < local.size(); ++k) {
+                nodes[base + k - 1] = relocate(local[k]);
+            }
+        }
+    });
+
+    // Leaf ranges index into the primitives in this order
+    order.resize(count);
+    pool.ParallelFor(count, kParallelGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            order[i] = context.refs[i].prim;
+        }
+    });
+}
+
+void Bvh::BuildSubtree(BuildContext& context, const BuildTask& task, std::vector<BvhNode>& nodes) {
+    nodes.clear();
+    nodes.reserve(2 * static_cast<size_t>(task.end - task.begin));
+    nodes.emplace_back();
+
+    std::vector<BuildTask> stack{ BuildTask{ 0, task.begin, task.end, task.depth } };
+    while (!stack.empty()) {
+        BuildTask current = stack.back();
+        stack.pop_back();
+
+        uint32_t mid = 0;
+        Aabb bounds;
+        bool split = FindSplit(context, current, bounds, mid, false);
+        nodes[current.node_index].bounds = bounds;
+        if (!split) {
+            nodes[current.node_index].offset = current.begin;
+            nodes[current.node_index].count = current.end - current.begin;
+            continue;
+        }
+        uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + 2);
+        nodes[current.node_index].offset = left;
+        nodes[current.node_index].count = 0;
+        stack.push_back(BuildTask{ left + 1, mid, current.end, current.depth + 1 });
+        stack.push_back(BuildTask{ left, current.begin, mid, current.depth + 1 });
+    }
+}
+
+bool Bvh::FindSplit(BuildContext& context, const BuildTask& task, Aabb& bounds, uint32_t& mid, bool parallel) {
+    const uint32_t begin = task.begin;
+    const uint32_t end = task.end;
+    const uint32_t count = end - begin;
+    const PrimRef* refs = context.refs.data();
+    ThreadPool& pool = ThreadPool::Global();
+    parallel = parallel && count > kParallelGrain;
+
+    // Node bounds and centroid bounds
+    Aabb centroid_bounds;
+    auto accumulate_bounds = [&](size_t from, size_t to, Aabb& box, Aabb& centroid_box) {
+        for (size_t i = from; i < to; ++i) {
+            box.Expand(refs[i].bounds);
+            centroid_box.Expand(refs[i].Centroid());
+        }
+    };
+    if (parallel) {
+        std::mutex merge_mutex;
+        pool.ParallelFor(count, kParallelGrain, [&](size_t from, size_t to) {
+            Aabb box, centroid_box;
+            accumulate_bounds(begin + from, begin + to, box, centroid_box);
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            bounds.Expand(box);
+            centroid_bounds.Expand(centroid_box);
+        });
+    } else {
+        accumulate_bounds(begin, end, bounds, centroid_bounds);
+    }
+
+    if (count == 1) {
+        return false;
+    }
+
+    int axis = centroid_bounds.LongestAxis();
+    auto median_split = [&]() {
+        // Object median along the longest axis (or arbitrary halves for identical centroids)
+        mid = begin + count / 2;
+        if (centroid_bounds.Extent()[axis] > 0.0f) {
+            std::nth_element(context.refs.begin() + begin, context.refs.begin() + mid, context.refs.begin() + end,
+                [axis](const PrimRef& a, const PrimRef& b) { return a.Centroid()[axis] < b.Centroid()[axis]; });
+        }
+        return true;
+    };
+
+    if (centroid_bounds.Extent()[axis] <= 0.0f) {
+        return count > context.max_leaf_size ? median_split() : false;
+    }
+    if (task.depth >= kMedianSplitDepth) {
+        return count > context.max_leaf_size ? median_split() : false;
+    }
+
+    // Bin centroids on all three axes
+    glm::vec3 bin_scale;
+    for (int a = 0; a < 3; ++a) {
+        float extent = centroid_bounds.Extent()[a];
+        bin_scale[a] = extent > 0.0f ? static_cast<float>(kBinCount) * 0.9999f / extent : 0.0f;
+    }
+    auto bin_index = [&](const glm::vec3& c, int a) {
+        int b = static_cast<int>((c[a] - centroid_bounds.lower[a]) * bin_scale[a]);
+        return std::min(std::max(b, 0), kBinCount - 1);
+    };
+    auto fill_bins = [&](size_t from, size_t to, BinSet& set) {
+        for (size_t i = from; i < to; ++i) {
+            const PrimRef& ref = refs[i];
+            glm::vec3 c = ref.Centroid();
+            for (int a = 0; a < 3; ++a) {
+                Bin& bin = set.bins[a][bin_index(c, a)];
+                bin.bounds.Expand(ref.bounds);
+                bin.count++;
+            }
+        }
+    };
+
+    BinSet binned;
+    if (parallel) {
+        std::mutex merge_mutex;
+        pool.ParallelFor(count, kParallelGrain, [&](size_t from, size_t to) {
+            BinSet local;
+            fill_bins(begin + from, begin + to, local);
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < kBinCount; ++b) {
+                    binned.bins[a][b].bounds.Expand(local.bins[a][b].bounds);
+                    binned.bins[a][b].count += local.bins[a][b].count;
+                }
+            }
+        });
+    } else {
+        fill_bins(begin, end, binned);
+    }
+
+    // Sweep the bins: cost(split after bin b) = traversal + (A_L * N_L + A_R * N_R) / A_parent
+    float parent_area = std::max(bounds.HalfArea(), 1e-20f);
+    float best_cost = std::numeric_limits<float>::infinity();
+    int best_axis = -1;
+    int best_bin = 0;
+    for (int a = 0; a < 3; ++a) {
+        if (bin_scale[a] == 0.0f) {
+            continue;
+        }
+        float right_cost[kBinCount];
+        Aabb right_box;
+        uint32_t right_count = 0;
+        for (int b = kBinCount - 1; b > 0; --b) {
+            right_box.Expand(binned.bins[a][b].bounds);
+            right_count += binned.bins[a][b].count;
+            right_cost[b] = right_box.HalfArea() * static_cast<float>(right_count);
+        }
+        Aabb left_box;
+        uint32_t left_count = 0;
+        for (int b = 0; b < kBinCount - 1; ++b) {
+            left_box.Expand(binned.bins[a][b].bounds);
+            left_count += binned.bins[a][b].count;
+            if (left_count == 0 || left_count == count) {
+                continue;
+            }
+            float cost = kTraversalCost + (left_box.HalfArea() * static_cast<float>(left_count) + right_cost[b + 1]) / parent_area;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = a;
+                best_bin = b;
+            }
+        }
+    }
+
+    float leaf_cost = static_cast<float>(count);
+    if (best_axis < 0) {
+        return count > context.max_leaf_size ? median_split() : false;
+    }
+    if (count <= context.max_leaf_size && leaf_cost <= best_cost) {
+        return false;
+    }
+
+    // Partition references by bin
+    auto goes_left = [&](const PrimRef& ref) { return bin_index(ref.Centroid(), best_axis) <= best_bin; };
+    if (parallel) {
+        // Count per chunk, then scatter into scratch at prefix-summed offsets and copy back
+        size_t num_chunks = (count + kParallelGrain - 1) / kParallelGrain;
+        std::vector<uint32_t> left_counts(num_chunks);
+        auto chunk_range = [&](size_t c) {
+            return std::make_pair(c * kParallelGrain, std::min<size_t>((c + 1) * kParallelGrain, count));
+        };
+        pool.ParallelFor(num_chunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+            for (size_t c = chunk_begin; c < chunk_end; ++c) {
+                auto [from, to] = chunk_range(c);
+                uint32_t n = 0;
+                for (size_t i = from; i < to; ++i) {
+                    n += goes_left(refs[begin + i]) ? 1u : 0u;
+                }
+                left_counts[c] = n;
+            }
+        });
+        std::vector<uint32_t> left_offsets(num_chunks);
+        std::vector<uint32_t> right_offsets(num_chunks);
+        uint32_t total_left = 0;
+        for (size_t c = 0; c < num_chunks; ++c) {
+            left_offsets[c] = total_left;
+            total_left += left_counts[c];
+        }
+        uint32_t right_cursor = total_left;
+        for (size_t c = 0; c < num_chunks; ++c) {
+            auto [from, to] = chunk_range(c);
+            right_offsets[c] = right_cursor;
+            right_cursor += static_cast<uint32_t>(to - from) - left_counts[c];
+        }
+        pool.ParallelFor(num_chunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+            for (size_t c = chunk_begin; c < chunk_end; ++c) {
+                auto [from, to] = chunk_range(c);
+                uint32_t l = begin + left_offsets[c];
+                uint32_t r = begin + right_offsets[c];
+                for (size_t i = from; i < to; ++i) {
+                    const PrimRef& ref = refs[begin + i];
+                    context.scratch[goes_left(ref) ? l++ : r++] = ref;
+                }
+            }
+        });
+        pool.ParallelFor(count, kParallelGrain, [&](size_t from, size_t to) {
+            std::copy(context.scratch.begin() + begin + from, context.scratch.begin() + begin + to,
+                      context.refs.begin() + begin + from);
+        });
+        mid = begin + total_left;
+    } else {
+        auto middle = std::partition(context.refs.begin() + begin, context.refs.begin() + end, goes_left);
+        mid = static_cast<uint32_t>(middle - context.refs.begin());
+    }
+
+    if (mid == begin || mid == end) {
+        return median_split();
+    }
+    return true;
+}
+
+void Bvh::ComputeStats() {
+    stats_.node_count = nodes_.size();
+    stats_.wide_node_count = wide_.GetNodeCount();
+    stats_.leaf_count = 0;
+    stats_.max_depth = 0;
+    stats_.leaf_size_histogram.fill(0);
+
+    float root_area = std::max(nodes_[0].bounds.HalfArea(), 1e-20f);
+    double cost = 0.0;
+    std::vector<std::pair<uint32_t, int>> stack{ { 0u, 0 } };
+    while (!stack.empty()) {
+        auto [node_index, depth] = stack.back();
+        stack.pop_back();
+        const BvhNode& node = nodes_[node_index];
+        stats_.max_depth = std::max(stats_.max_depth, depth);
+        double relative_area = node.bounds.HalfArea() / root_area;
+        if (node.IsLeaf()) {
+            stats_.leaf_count++;
+            stats_.leaf_size_histogram[std::min<size_t>(node.count, BvhBuildStats::kHistogramSize - 1)]++;
+            cost += relative_area * node.count;
+        } else {
+            cost += relative_area * kTraversalCost;
+            stack.push_back({ node.offset, depth + 1 });
+            stack.push_back({ node.offset + 1, depth + 1 });
+        }
+    }
+    stats_.sah_cost = static_cast<float>(cost);
+}
+
+void Bvh::Attach(const BvhData& data) {
+    nodes_.clear();
+    triangles_.clear();
+    bounds_ = data.bounds;
+    stats_ = data.stats;
+    triangle_data_ = data.triangles;
+    triangle_count_ = data.triangle_count;
+    wide_.Attach(data.wide_nodes, data.wide_node_count);
+}
+
+BvhData Bvh::GetData() const {
+    BvhData data;
+    data.bounds = bounds_;
+    data.stats = stats_;
+    data.triangles = triangle_data_;
+    data.triangle_count = triangle_count_;
+    data.wide_nodes = wide_.GetNodes();
+    data.wide_node_count = wide_.GetNodeCount();
+    return data;
+}
+
+bool Bvh::Intersect(const Ray& ray, HitRecord& hit) const {
+    return wide_.Intersect(triangle_data_, ray, hit);
+}
+
+bool Bvh::Occluded(const Ray& ray) const {
+    return wide_.Occluded(triangle_data_, ray);
+}
+
+void Bvh::IntersectPacket(const RayPacket& packet, const RayFrustum& frustum, PacketHits& hits, uint32_t instance_id) const {
+    wide_.IntersectPacket(triangle_data_, packet, frustum, hits, instance_id);
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include "long_march.h"
+#include "Ray.h"
+#include "Bvh8.h"
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Node of a binary BVH, 32 bytes so two nodes share a cache line
+// Interior: children are stored next to each other at `offset` and `offset + 1`
+// Leaf: triangles [offset, offset + count)
+struct BvhNode {
+    Aabb bounds;
+    uint32_t offset;
+    uint32_t count;
+
+    bool IsLeaf() const { return count > 0; }
+};
+
+// Triangle in edge form, stored in leaf order for Moller-Trumbore tests
+struct BvhTriangle {
+    glm::vec3 v0;
+    glm::vec3 e1;
+    glm::vec3 e2;
+    uint32_t primitive_id;
+};
+
+// Moller-Trumbore; updates hit (t, u, v, primitive_id) and returns true on a closer hit
+inline bool IntersectTriangle(const BvhTriangle& tri, const Ray& ray, HitRecord& hit) {
+    glm::vec3 p = glm::cross(ray.direction, tri.e2);
+    float det = glm::dot(tri.e1, p);
+    if (det == 0.0f) {
+        return false;
+    }
+    float inv_det = 1.0f / det;
+    glm::vec3 s = ray.origin - tri.v0;
+    float u = glm::dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    glm::vec3 q = glm::cross(s, tri.e1);
+    float v = glm::dot(ray.direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    float t = glm::dot(tri.e2, q) * inv_det;
+    if (t < ray.t_min || t >= hit.t) {
+        return false;
+    }
+    hit.t = t;
+    hit.u = u;
+    hit.v = v;
+    hit.primitive_id = tri.primitive_id;
+    return true;
+}
+
+// Build time and tree quality, reported when an entity's BLAS is built
+struct BvhBuildStats {
+    static constexpr size_t kHistogramSize = 9;  // Leaf sizes 0..8
+
+    double build_time_ms = 0.0;
+    float sah_cost = 0.0f;      // Expected cost per ray hitting the root (traversal step = 1, triangle test = 1)
+    int max_depth = 0;
+    size_t node_count = 0;
+    size_t wide_node_count = 0;  // Nodes after collapsing into the BVH8 used for traversal
+    size_t leaf_count = 0;
+    std::array<size_t, kHistogramSize> leaf_size_histogram{};
+
+    // "1:123 2:456 ..." for the log
+    std::string LeafHistogramString() const;
+};
+
+// Traversal arrays of a built Bvh, for storing it and using it in place later
+// (e.g. from a memory-mapped mesh cache); the binary nodes are not needed for that
+struct BvhData {
+    Aabb bounds;
+    BvhBuildStats stats;
+    const BvhTriangle* triangles = nullptr;
+    size_t triangle_count = 0;
+    const Bvh8Node* wide_nodes = nullptr;
+    size_t wide_node_count = 0;
+};
+
+// CPU bottom-level acceleration structure over one triangle mesh
+// Built top-down with a binned SAH; large nodes are binned and partitioned in
+// parallel, and once there are enough independent subtrees they are built as
+// parallel tasks on the global ThreadPool
+// The binary tree is then collapsed into a Bvh8, which the queries traverse
+class Bvh {
+public:
+    static constexpr uint32_t kMaxLeafSize = 8;
+
+    Bvh() = default;
+
+    // Queries read through pointers into this object's storage (or attached storage)
+    Bvh(const Bvh&) = delete;
+    Bvh& operator=(const Bvh&) = delete;
+
+    // Past this depth splits fall back to the median, which bounds the tree depth
+    // (and so the traversal stack) at kMaxDepth
+    static constexpr int kMedianSplitDepth = 32;
+    static constexpr int kMaxDepth = kMedianSplitDepth + 32;
+    static_assert(kMaxDepth <= Bvh8::kMaxDepth, "Bvh8 traversal stack too small");
+
+    // Build over an indexed triangle list (3 indices per triangle)
+    void Build(const glm::vec3* positions, const uint32_t* indices, size_t num_triangles);
+
+    // Binned SAH hierarchy over `count` primitives with the given bounds, shared with the TLAS
+    // Leaves of nodes cover [offset, offset + count) of order, which maps back to primitive indices
+    static void BuildHierarchy(size_t count, const std::function<Aabb(size_t)>& prim_bounds, uint32_t max_leaf_size,
+                               std::vector<BvhNode>& nodes, std::vector<uint32_t>& order);
+
+    // Use a BVH built earlier without copying it; the arrays must outlive the Bvh
+    void Attach(const BvhData& data);
+    BvhData GetData() const;
+
+    // Closest hit along the ray; hit.t is used as the current t_max
+    bool Intersect(const Ray& ray, HitRecord& hit) const;
+
+    // Any hit in [t_min, t_max] (for shadow rays)
+    bool Occluded(const Ray& ray) const;
+
+    // Closest hits for a coherent packet culled by its frustum; updated rays take instance_id
+    void IntersectPacket(const RayPacket& packet, const RayFrustum& frustum, PacketHits& hits, uint32_t instance_id) const;
+
+    const Aabb& GetBounds() const { return bounds_; }
+    // Binary tree the Bvh8 was collapsed from; empty for an attached BVH
+    const std::vector<BvhNode>& GetNodes() const { return nodes_; }
+    const BvhTriangle* GetTriangles() const { return triangle_data_; }
+    const Bvh8& GetWideBvh() const { return wide_; }
+    size_t GetTriangleCount() const { return triangle_count_; }
+    const BvhBuildStats& GetBuildStats() const { return stats_; }
+
+private:
+    struct BuildContext;
+    struct BuildTask {
+        uint32_t node_index;
+        uint32_t begin;
+        uint32_t end;
+        int depth;
+    };
+
+    // Decide how to split a node; returns false when it should stay a leaf
+    static bool FindSplit(BuildContext& context, const BuildTask& task, Aabb& bounds, uint32_t& mid, bool parallel);
+    static void BuildSubtree(BuildContext& context, const BuildTask& task, std::vector<BvhNode>& nodes);
+    void ComputeStats();
+
+    Aabb bounds_;
+    std::vector<BvhNode> nodes_;
+    std::vector<BvhTriangle> triangles_;
+    // Triangles traversed: triangles_ after Build, or attached external storage
+    const BvhTriangle* triangle_data_ = nullptr;
+    size_t triangle_count_ = 0;
+    Bvh8 wide_;
+    BvhBuildStats stats_;
+};
@@ -0,0 +1,274 @@
+#include "Bvh8.h"
+#include "Bvh.h"
+#include "Bvh8Kernels.h"
+#include "Bvh8Traversal.h"
+#include "CpuFeatures.h"
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// The kernels address the bounds by float offset from lower_x
+static_assert(offsetof(Bvh8Node, upper_x) == 8 * sizeof(float), "unexpected Bvh8Node layout");
+static_assert(offsetof(Bvh8Node, lower_y) == 16 * sizeof(float), "unexpected Bvh8Node layout");
+static_assert(offsetof(Bvh8Node, lower_z) == 32 * sizeof(float), "unexpected Bvh8Node layout");
+static_assert(sizeof(Bvh8Node) == 256, "unexpected Bvh8Node layout");
+
+// The kernels read BvhTriangles in place as Bvh8Triangles
+static_assert(sizeof(Bvh8Triangle) == sizeof(BvhTriangle), "unexpected BvhTriangle layout");
+static_assert(offsetof(Bvh8Triangle, e1) == offsetof(BvhTriangle, e1), "unexpected BvhTriangle layout");
+static_assert(offsetof(Bvh8Triangle, e2) == offsetof(BvhTriangle, e2), "unexpected BvhTriangle layout");
+static_assert(offsetof(Bvh8Triangle, primitive_id) == offsetof(BvhTriangle, primitive_id), "unexpected BvhTriangle layout");
+static_assert(kBvh8PacketLanes == RayPacket::kLanes, "packet leaf test width differs from RayPacket");
+
+namespace {
+
+struct Bvh8Kernel {
+    const char* name;
+    Bvh8IntersectFn intersect;
+    Bvh8OccludedFn occluded;
+    Bvh8IntersectPacketFn intersect_packet;
+};
+
+Bvh8Kernel SelectKernel() {
+#if defined(SHORT_MARCH_X86_SIMD)
+    const CpuFeatures& features = CpuFeatures::Get();
+    if (features.avx512f && features.avx2 && features.fma) {
+        // Packets are processed in groups of eight rays, which AVX2 already covers
+        return Bvh8Kernel{ "AVX-512", Bvh8IntersectAvx512, Bvh8OccludedAvx512, Bvh8IntersectPacketAvx2 };
+    }
+    if (features.avx2 && features.fma) {
+        return Bvh8Kernel{ "AVX2", Bvh8IntersectAvx2, Bvh8OccludedAvx2, Bvh8IntersectPacketAvx2 };
+    }
+#endif
+    return Bvh8Kernel{ "scalar", Bvh8IntersectScalar, Bvh8OccludedScalar, Bvh8IntersectPacketScalar };
+}
+
+const Bvh8Kernel& GetKernel() {
+    static const Bvh8Kernel kernel = SelectKernel();
+    return kernel;
+}
+
+struct BoxTestScalar {
+    const Bvh8Ray& ray;
+    int near_x, near_y, near_z;   // Float offsets of the near planes inside the node
+
+    explicit BoxTestScalar(const Bvh8Ray& r)
+        : ray(r)
+        , near_x(r.negative[0] ? 8 : 0)
+        , near_y(r.negative[1] ? 24 : 16)
+        , near_z(r.negative[2] ? 40 : 32) {}
+
+    uint32_t operator()(const Bvh8Node& node, float t_max, float* entry_t) const {
+        const float* base = node.lower_x;
+        uint32_t mask = 0;
+        for (int i = 0; i < Bvh8Node::kWidth; ++i) {
+            float t0x = base[near_x + i] * ray.inv_direction[0] - ray.origin_inv[0];
+            float t0y = base[near_y + i] * ray.inv_direction[1] - ray.origin_inv[1];
+            float t0z = base[near_z + i] * ray.inv_direction[2] - ray.origin_inv[2];
+            float t1x = base[(near_x ^ 8) + i] * ray.inv_direction[0] - ray.origin_inv[0];
+            float t1y = base[(near_y ^ 8) + i] * ray.inv_direction[1] - ray.origin_inv[1];
+            float t1z = base[(near_z ^ 8) + i] * ray.inv_direction[2] - ray.origin_inv[2];
+            float enter = std::max(std::max(t0x, t0y), std::max(t0z, ray.t_min));
+            float exit = std::min(std::min(t1x, t1y), std::min(t1z, t_max));
+            entry_t[i] = enter;
+            mask |= (enter <= exit ? 1u : 0u) << i;
+        }
+        return mask;
+    }
+};
+
+struct PacketLeafTestScalar {
+    void operator()(const PacketTriangle& tri, uint32_t primitive_id, const Bvh8Packet& packet,
+                    const Bvh8PacketHits& hits, uint32_t instance_id) const {
+        for (int i = 0; i < packet.count; ++i) {
+            const float dx = packet.direction_x[i];
+            const float dy = packet.direction_y[i];
+            const float dz = packet.direction_z[i];
+            const float det = dx * tri.normal[0] + dy * tri.normal[1] + dz * tri.normal[2];
+            if (det == 0.0f) {
+                continue;
+            }
+            const float inv_det = 1.0f / det;
+            const float u = (dx * tri.u_axis[0] + dy * tri.u_axis[1] + dz * tri.u_axis[2]) * inv_det;
+            const float v = (dx * tri.v_axis[0] + dy * tri.v_axis[1] + dz * tri.v_axis[2]) * inv_det;
+            const float t = tri.t_numerator * inv_det;
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= packet.t_min && t < hits.t[i]) {
+                hits.t[i] = t;
+                hits.u[i] = u;
+                hits.v[i] = v;
+                hits.primitive_id[i] = primitive_id;
+                hits.instance_id[i] = instance_id;
+            }
+        }
+    }
+};
+
+inline Bvh8Ray MakeBvh8Ray(const Ray& ray) {
+    const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+    return MakeBvh8Ray(origin, direction, ray.t_min);
+}
+
+const Bvh8Triangle* AsBvh8Triangles(const BvhTriangle* triangles) {
+    return reinterpret_cast<const Bvh8Triangle*>(triangles);
+}
+
+// Slot of a wide node under construction: a binary node that is either pulled up
+// further or becomes a child of the wide node
+struct CollapseTask {
+    uint32_t binary_node;
+    uint32_t wide_node;
+};
+
+}  // namespace
+
+bool Bvh8IntersectScalar(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit) {
+    return IntersectBvh8<BoxTestScalar>(nodes, triangles, ray, hit);
+}
+
+bool Bvh8OccludedScalar(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max) {
+    return OccludedBvh8<BoxTestScalar>(nodes, triangles, ray, t_max);
+}
+
+void Bvh8IntersectPacketScalar(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet,
+                               const Bvh8PacketHits& hits, uint32_t instance_id) {
+    IntersectPacketBvh8<BoxTestScalar, PacketLeafTestScalar>(nodes, triangles, packet, hits, instance_id);
+}
+
+void Bvh8::Build(const std::vector<BvhNode>& nodes) {
+    Clear();
+    if (nodes.empty()) {
+        return;
+    }
+    nodes_.reserve(nodes.size() / 4 + 1);
+
+    // The wide root stands for the binary root; a leaf root becomes its only child
+    std::vector<CollapseTask> tasks{ CollapseTask{ 0, 0 } };
+    nodes_.emplace_back();
+    while (!tasks.empty()) {
+        CollapseTask task = tasks.back();
+        tasks.pop_back();
+
+        // Open the interior child with the largest surface area until the node is full
+        uint32_t slots[Bvh8Node::kWidth];
+        int num_slots = 0;
+        const BvhNode& binary = nodes[task.binary_node];
+        if (binary.IsLeaf()) {
+            slots[num_slots++] = task.binary_node;
+        } else {
+            slots[num_slots++] = binary.offset;
+            slots[num_slots++] = binary.offset + 1;
+        }
+        while (num_slots < Bvh8Node::kWidth) {
+            int best = -1;
+            float best_area = -1.0f;
+            for (int s = 0; s < num_slots; ++s) {
+                const BvhNode& candidate = nodes[slots[s]];
+                if (!candidate.IsLeaf() && candidate.bounds.HalfArea() > best_area) {
+                    best_area = candidate.bounds.HalfArea();
+                    best = s;
+                }
+            }
+            if (best < 0) {
+                break;
+            }
+            uint32_t opened = nodes[slots[best]].offset;
+            slots[best] = opened;
+            slots[num_slots++] = opened + 1;
+        }
+
+        Bvh8Node wide;
+        for (int s = 0; s < Bvh8Node::kWidth; ++s) {
+            Aabb box;   // Empty: lower = +inf, upper = -inf never overlaps a ray
+            uint32_t child = kInvalidId;
+            uint32_t count = 0;
+            if (s < num_slots) {
+                const BvhNode& source = nodes[slots[s]];
+                box = source.bounds;
+                if (source.IsLeaf()) {
+                    child = source.offset;
+                    count = source.count;
+                } else {
+                    child = static_cast<uint32_t>(nodes_.size());
+                    nodes_.emplace_back();
+                    tasks.push_back(CollapseTask{ slots[s], child });
+                }
+            }
+            wide.lower_x[s] = box.lower.x;
+            wide.lower_y[s] = box.lower.y;
+            wide.lower_z[s] = box.lower.z;
+            wide.upper_x[s] = box.upper.x;
+            wide.upper_y[s] = box.upper.y;
+            wide.upper_z[s] = box.upper.z;
+            wide.child[s] = child;
+            wide.count[s] = count;
+        }
+        nodes_[task.wide_node] = wide;
+    }
+    node_data_ = nodes_.data();
+    node_count_ = nodes_.size();
+}
+
+void Bvh8::Clear() {
+    nodes_.clear();
+    node_data_ = nullptr;
+    node_count_ = 0;
+}
+
+void Bvh8::Attach(const Bvh8Node* nodes, size_t count) {
+    nodes_.clear();
+    node_data_ = nodes;
+    node_count_ = count;
+}
+
+bool Bvh8::Intersect(const BvhTriangle* triangles, const Ray& ray, HitRecord& hit) const {
+    if (node_count_ == 0) {
+        return false;
+    }
+    Bvh8Hit closest{ ray.t_max < hit.t ? ray.t_max : hit.t, 0.0f, 0.0f, 0 };
+    if (!GetKernel().intersect(node_data_, AsBvh8Triangles(triangles), MakeBvh8Ray(ray), closest)) {
+        return false;
+    }
+    hit.t = closest.t;
+    hit.u = closest.u;
+    hit.v = closest.v;
+    hit.primitive_id = closest.primitive_id;
+    return true;
+}
+
+bool Bvh8::Occluded(const BvhTriangle* triangles, const Ray& ray) const {
+    if (node_count_ == 0) {
+        return false;
+    }
+    return GetKernel().occluded(node_data_, AsBvh8Triangles(triangles), MakeBvh8Ray(ray), ray.t_max);
+}
+
+void Bvh8::IntersectPacket(const BvhTriangle* triangles, const RayPacket& packet, const RayFrustum& frustum,
+                           PacketHits& hits, uint32_t instance_id) const {
+    if (node_count_ == 0) {
+        return;
+    }
+    Bvh8Packet plain;
+    plain.origin[0] = packet.origin.x;
+    plain.origin[1] = packet.origin.y;
+    plain.origin[2] = packet.origin.z;
+    plain.t_min = packet.t_min;
+    plain.count = packet.GetRayCount();
+    plain.direction_x = packet.direction_x;
+    plain.direction_y = packet.direction_y;
+    plain.direction_z = packet.direction_z;
+    for (int k = 0; k < 4; ++k) {
+        for (int a = 0; a < 4; ++a) {
+            plain.planes[k][a] = frustum.planes[k][a];
+        }
+    }
+    plain.max_direction_length = frustum.max_direction_length;
+    plain.spread = frustum.spread;
+    const Bvh8PacketHits plain_hits{ hits.t, hits.u, hits.v, hits.primitive_id, hits.instance_id };
+    GetKernel().intersect_packet(node_data_, AsBvh8Triangles(triangles), plain, plain_hits, instance_id);
+}
+
+const char* Bvh8::GetKernelName() {
+    return GetKernel().name;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Ray.h"
+#include "Bvh8Kernels.h"
+#include <vector>
+
+struct BvhNode;
+struct BvhTriangle;
+struct RayPacket;
+struct RayFrustum;
+struct PacketHits;
+
+// Wide form of a binary Bvh used for CPU traversal
+// Built by collapsing the binary tree, pulling up the largest interior children
+// until every node has up to eight; leaves keep referencing the binary tree's
+// leaf-ordered triangles
+class Bvh8 {
+public:
+    // Deepest wide tree the kernels' fixed traversal stacks can handle
+    static constexpr int kMaxDepth = kBvh8MaxDepth;
+
+    Bvh8() = default;
+
+    void Build(const std::vector<BvhNode>& nodes);
+    void Clear();
+
+    // Use nodes stored elsewhere (e.g. a mapped mesh cache) in place; they must outlive the Bvh8
+    void Attach(const Bvh8Node* nodes, size_t count);
+
+    bool Intersect(const BvhTriangle* triangles, const Ray& ray, HitRecord& hit) const;
+    bool Occluded(const BvhTriangle* triangles, const Ray& ray) const;
+
+    // Closest hits for a shared-origin packet; rays that get closer hits take instance_id
+    void IntersectPacket(const BvhTriangle* triangles, const RayPacket& packet, const RayFrustum& frustum,
+                         PacketHits& hits, uint32_t instance_id) const;
+
+    bool IsEmpty() const { return node_count_ == 0; }
+    size_t GetNodeCount() const { return node_count_; }
+    const Bvh8Node* GetNodes() const { return node_data_; }
+
+    // Name of the kernel picked for this CPU ("AVX-512", "AVX2" or "scalar")
+    static const char* GetKernelName();
+
+private:
+    // std::vector only guarantees alignof(Bvh8Node) from C++17 aligned new, which the build uses
+    std::vector<Bvh8Node> nodes_;
+    // Nodes traversed: nodes_ after Build, or attached external storage
+    const Bvh8Node* node_data_ = nullptr;
+    size_t node_count_ = 0;
+};
@@ -0,0 +1,116 @@
+// Compiled with AVX2 + FMA (see src/CMakeLists.txt); only reached after CpuFeatures reports support
+#include "Bvh8Kernels.h"
+#include "Bvh8Traversal.h"
+
+#if defined(SHORT_MARCH_X86_SIMD)
+#include <immintrin.h>
+
+namespace {
+
+// One ray against the eight child boxes: six fused slab distances and a movemask
+struct BoxTestAvx2 {
+    __m256 inv_x, inv_y, inv_z;
+    __m256 origin_inv_x, origin_inv_y, origin_inv_z;
+    __m256 t_min;
+    int near_x, near_y, near_z;   // Float offsets of the near planes inside the node
+
+    explicit BoxTestAvx2(const Bvh8Ray& ray)
+        : inv_x(_mm256_set1_ps(ray.inv_direction[0]))
+        , inv_y(_mm256_set1_ps(ray.inv_direction[1]))
+        , inv_z(_mm256_set1_ps(ray.inv_direction[2]))
+        , origin_inv_x(_mm256_set1_ps(ray.origin_inv[0]))
+        , origin_inv_y(_mm256_set1_ps(ray.origin_inv[1]))
+        , origin_inv_z(_mm256_set1_ps(ray.origin_inv[2]))
+        , t_min(_mm256_set1_ps(ray.t_min))
+        , near_x(ray.negative[0] ? 8 : 0)
+        , near_y(ray.negative[1] ? 24 : 16)
+        , near_z(ray.negative[2] ? 40 : 32) {}
+
+    uint32_t operator()(const Bvh8Node& node, float t_max, float* entry_t) const {
+        const float* base = node.lower_x;
+        __m256 t0x = _mm256_fmsub_ps(_mm256_load_ps(base + near_x), inv_x, origin_inv_x);
+        __m256 t1x = _mm256_fmsub_ps(_mm256_load_ps(base + (near_x ^ 8)), inv_x, origin_inv_x);
+        __m256 t0y = _mm256_fmsub_ps(_mm256_load_ps(base + near_y), inv_y, origin_inv_y);
+        __m256 t1y = _mm256_fmsub_ps(_mm256_load_ps(base + (near_y ^ 8)), inv_y, origin_inv_y);
+        __m256 t0z = _mm256_fmsub_ps(_mm256_load_ps(base + near_z), inv_z, origin_inv_z);
+        __m256 t1z = _mm256_fmsub_ps(_mm256_load_ps(base + (near_z ^ 8)), inv_z, origin_inv_z);
+        __m256 enter = _mm256_max_ps(_mm256_max_ps(t0x, t0y), _mm256_max_ps(t0z, t_min));
+        __m256 exit = _mm256_min_ps(_mm256_min_ps(t1x, t1y), _mm256_min_ps(t1z, _mm256_set1_ps(t_max)));
+        _mm256_store_ps(entry_t, enter);
+        return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ)));
+    }
+};
+
+// One triangle against eight packet rays per iteration; lanes past the ray count are masked off
+struct PacketLeafTestAvx2 {
+    void operator()(const PacketTriangle& tri, uint32_t primitive_id, const Bvh8Packet& packet,
+                    const Bvh8PacketHits& hits, uint32_t instance_id) const {
+        const int count = packet.count;
+        const __m256 normal_x = _mm256_set1_ps(tri.normal[0]);
+        const __m256 normal_y = _mm256_set1_ps(tri.normal[1]);
+        const __m256 normal_z = _mm256_set1_ps(tri.normal[2]);
+        const __m256 u_x = _mm256_set1_ps(tri.u_axis[0]);
+        const __m256 u_y = _mm256_set1_ps(tri.u_axis[1]);
+        const __m256 u_z = _mm256_set1_ps(tri.u_axis[2]);
+        const __m256 v_x = _mm256_set1_ps(tri.v_axis[0]);
+        const __m256 v_y = _mm256_set1_ps(tri.v_axis[1]);
+        const __m256 v_z = _mm256_set1_ps(tri.v_axis[2]);
+        const __m256 t_numerator = _mm256_set1_ps(tri.t_numerator);
+        const __m256 t_min = _mm256_set1_ps(packet.t_min);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i primitive = _mm256_set1_epi32(static_cast<int>(primitive_id));
+        const __m256i instance = _mm256_set1_epi32(static_cast<int>(instance_id));
+
+        for (int i = 0; i < count; i += kBvh8PacketLanes) {
+            const __m256 dx = _mm256_load_ps(packet.direction_x + i);
+            const __m256 dy = _mm256_load_ps(packet.direction_y + i);
+            const __m256 dz = _mm256_load_ps(packet.direction_z + i);
+            const __m256 det = _mm256_fmadd_ps(dx, normal_x, _mm256_fmadd_ps(dy, normal_y, _mm256_mul_ps(dz, normal_z)));
+            // det == 0 gives inf/NaN below, which fails the ordered comparisons
+            const __m256 inv_det = _mm256_div_ps(one, det);
+            const __m256 u = _mm256_mul_ps(_mm256_fmadd_ps(dx, u_x, _mm256_fmadd_ps(dy, u_y, _mm256_mul_ps(dz, u_z))), inv_det);
+            const __m256 v = _mm256_mul_ps(_mm256_fmadd_ps(dx, v_x, _mm256_fmadd_ps(dy, v_y, _mm256_mul_ps(dz, v_z))), inv_det);
+            const __m256 t = _mm256_mul_ps(t_numerator, inv_det);
+            const __m256 t_hit = _mm256_load_ps(hits.t + i);
+
+            __m256 mask = _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, t_min, _CMP_GE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, t_hit, _CMP_LT_OQ));
+            const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - i), lane);
+            mask = _mm256_and_ps(mask, _mm256_castsi256_ps(valid));
+            if (_mm256_testz_ps(mask, mask)) {
+                continue;
+            }
+
+            _mm256_store_ps(hits.t + i, _mm256_blendv_ps(t_hit, t, mask));
+            _mm256_store_ps(hits.u + i, _mm256_blendv_ps(_mm256_load_ps(hits.u + i), u, mask));
+            _mm256_store_ps(hits.v + i, _mm256_blendv_ps(_mm256_load_ps(hits.v + i), v, mask));
+            __m256i* primitive_out = reinterpret_cast<__m256i*>(hits.primitive_id + i);
+            __m256i* instance_out = reinterpret_cast<__m256i*>(hits.instance_id + i);
+            _mm256_store_si256(primitive_out, _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(_mm256_load_si256(primitive_out)), _mm256_castsi256_ps(primitive), mask)));
+            _mm256_store_si256(instance_out, _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(_mm256_load_si256(instance_out)), _mm256_castsi256_ps(instance), mask)));
+        }
+    }
+};
+
+}  // namespace
+
+bool Bvh8IntersectAvx2(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit) {
+    return IntersectBvh8<BoxTestAvx2>(nodes, triangles, ray, hit);
+}
+
+bool Bvh8OccludedAvx2(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max) {
+    return OccludedBvh8<BoxTestAvx2>(nodes, triangles, ray, t_max);
+}
+
+void Bvh8IntersectPacketAvx2(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet,
+                             const Bvh8PacketHits& hits, uint32_t instance_id) {
+    IntersectPacketBvh8<BoxTestAvx2, PacketLeafTestAvx2>(nodes, triangles, packet, hits, instance_id);
+}
+
+#endif
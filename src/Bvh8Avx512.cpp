@@ -0,0 +1,69 @@
+// Compiled with AVX-512F (see src/CMakeLists.txt); only reached after CpuFeatures reports support
+#include "Bvh8Kernels.h"
+#include "Bvh8Traversal.h"
+
+#if defined(SHORT_MARCH_X86_SIMD)
+#include <immintrin.h>
+
+namespace {
+
+// Each axis' lower and upper bounds share one 64-byte line, so a single 16-lane
+// load and fused multiply-subtract gives all sixteen slab distances of that axis;
+// a per-ray permutation moves them into [near x8 | far x8] order
+struct BoxTestAvx512 {
+    __m512 inv_x, inv_y, inv_z;
+    __m512 origin_inv_x, origin_inv_y, origin_inv_z;
+    __m512i order_x, order_y, order_z;
+    __m512 t_min_low;   // t_min in lanes 0..7; the upper lanes are filled with t_max per node
+
+    explicit BoxTestAvx512(const Bvh8Ray& ray)
+        : inv_x(_mm512_set1_ps(ray.inv_direction[0]))
+        , inv_y(_mm512_set1_ps(ray.inv_direction[1]))
+        , inv_z(_mm512_set1_ps(ray.inv_direction[2]))
+        , origin_inv_x(_mm512_set1_ps(ray.origin_inv[0]))
+        , origin_inv_y(_mm512_set1_ps(ray.origin_inv[1]))
+        , origin_inv_z(_mm512_set1_ps(ray.origin_inv[2]))
+        , order_x(Order(ray.negative[0]))
+        , order_y(Order(ray.negative[1]))
+        , order_z(Order(ray.negative[2]))
+        , t_min_low(_mm512_set1_ps(ray.t_min)) {}
+
+    static __m512i Order(bool negative) {
+        return negative ? _mm512_set_epi32(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8)
+                        : _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    }
+
+    uint32_t operator()(const Bvh8Node& node, float t_max, float* entry_t) const {
+        const __mmask16 near_lanes = 0x00FF;
+        const __mmask16 far_lanes = 0xFF00;
+        __m512 tx = _mm512_permutexvar_ps(order_x, _mm512_fmsub_ps(_mm512_load_ps(node.lower_x), inv_x, origin_inv_x));
+        __m512 ty = _mm512_permutexvar_ps(order_y, _mm512_fmsub_ps(_mm512_load_ps(node.lower_y), inv_y, origin_inv_y));
+        __m512 tz = _mm512_permutexvar_ps(order_z, _mm512_fmsub_ps(_mm512_load_ps(node.lower_z), inv_z, origin_inv_z));
+        __m512 range = _mm512_mask_mov_ps(t_min_low, far_lanes, _mm512_set1_ps(t_max));
+
+        // Lanes 0..7 take the max (entry), lanes 8..15 the min (exit)
+        __m512 t = _mm512_mask_max_ps(tx, near_lanes, tx, ty);
+        t = _mm512_mask_min_ps(t, far_lanes, t, ty);
+        __m512 tzr_max = _mm512_max_ps(tz, range);
+        __m512 tzr_min = _mm512_min_ps(tz, range);
+        t = _mm512_mask_max_ps(t, near_lanes, t, tzr_max);
+        t = _mm512_mask_min_ps(t, far_lanes, t, tzr_min);
+
+        // Compare each entry against the exit in the other half straight into a mask register
+        __m512 exit = _mm512_shuffle_f32x4(t, t, _MM_SHUFFLE(1, 0, 3, 2));
+        _mm256_store_ps(entry_t, _mm512_castps512_ps256(t));
+        return static_cast<uint32_t>(_mm512_cmp_ps_mask(t, exit, _CMP_LE_OQ)) & 0xFFu;
+    }
+};
+
+}  // namespace
+
+bool Bvh8IntersectAvx512(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit) {
+    return IntersectBvh8<BoxTestAvx512>(nodes, triangles, ray, hit);
+}
+
+bool Bvh8OccludedAvx512(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max) {
+    return OccludedBvh8<BoxTestAvx512>(nodes, triangles, ray, t_max);
+}
+
+#endif
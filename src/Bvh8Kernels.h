@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+
+// Traversal kernels over an 8-wide BVH (see Bvh8.h); the AVX2 and AVX-512 ones live in
+// translation units compiled with the matching instruction set flags and are only
+// called after CpuFeatures confirms support, so this header and Bvh8Traversal.h stay
+// free of glm and other shared inline code: the kernels see plain float copies of
+// rays, triangles and packets, converted in Bvh8.cpp before dispatch
+
+// Node of the 8-wide BVH: child bounds are stored as structure-of-arrays so one
+// ray is tested against all eight boxes with a single pass of vector instructions
+// Unused slots hold an inverted box that no ray can hit
+struct alignas(64) Bvh8Node {
+    static constexpr int kWidth = 8;
+
+    float lower_x[kWidth];
+    float upper_x[kWidth];
+    float lower_y[kWidth];
+    float upper_y[kWidth];
+    float lower_z[kWidth];
+    float upper_z[kWidth];
+    uint32_t child[kWidth];   // Interior: wide node index; leaf: first triangle
+    uint32_t count[kWidth];   // Triangle count for leaves, 0 for interior children and empty slots
+};
+
+// Deepest wide tree the kernels' fixed traversal stacks can handle
+constexpr int kBvh8MaxDepth = 80;
+constexpr int kBvh8StackSize = kBvh8MaxDepth * (Bvh8Node::kWidth - 1) + 1;
+
+// Same layout as BvhTriangle
+struct Bvh8Triangle {
+    float v0[3];
+    float e1[3];
+    float e2[3];
+    uint32_t primitive_id;
+};
+
+// Ray with the per-ray terms of the slab test precomputed (see MakeBvh8Ray)
+struct Bvh8Ray {
+    float origin[3];
+    float direction[3];
+    float inv_direction[3];
+    float origin_inv[3];   // origin * inv_direction, for fused slab distances
+    bool negative[3];
+    float t_min;
+};
+
+// Closest hit; t starts out as the ray's t_max
+struct Bvh8Hit {
+    float t;
+    float u;
+    float v;
+    uint32_t primitive_id;
+};
+
+// Rays per step of the packet leaf test, as RayPacket::kLanes
+constexpr int kBvh8PacketLanes = 8;
+
+// Shared-origin packet and its frustum (see RayPacket and RayFrustum); the direction
+// and hit arrays are 32-byte aligned and padded to a multiple of kBvh8PacketLanes
+struct Bvh8Packet {
+    float origin[3];
+    float t_min;
+    int count;
+    const float* direction_x;
+    const float* direction_y;
+    const float* direction_z;
+    float planes[4][4];   // xyz: inward normal, w: offset
+    float max_direction_length;
+    float spread;
+};
+
+struct Bvh8PacketHits {
+    float* t;
+    float* u;
+    float* v;
+    uint32_t* primitive_id;
+    uint32_t* instance_id;
+};
+
+// Traversal kernel over a wide tree; returns true on a closer hit
+using Bvh8IntersectFn = bool (*)(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit);
+using Bvh8OccludedFn = bool (*)(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max);
+using Bvh8IntersectPacketFn = void (*)(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet,
+                                       const Bvh8PacketHits& hits, uint32_t instance_id);
+
+bool Bvh8IntersectScalar(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit);
+bool Bvh8OccludedScalar(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max);
+void Bvh8IntersectPacketScalar(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet,
+                               const Bvh8PacketHits& hits, uint32_t instance_id);
+
+#if defined(SHORT_MARCH_X86_SIMD)
+bool Bvh8IntersectAvx2(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit);
+bool Bvh8OccludedAvx2(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max);
+void Bvh8IntersectPacketAvx2(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet,
+                             const Bvh8PacketHits& hits, uint32_t instance_id);
+bool Bvh8IntersectAvx512(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, Bvh8Hit& hit);
+bool Bvh8OccludedAvx512(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& ray, float t_max);
+#endif
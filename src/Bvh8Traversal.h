@@ -0,0 +1,362 @@
+#pragma once
+#include "Bvh8Kernels.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Traversal loop shared by the Bvh8 kernels, parameterized by the 8-box test
+// Everything here has internal linkage and avoids glm/std helpers on purpose:
+// each kernel translation unit is compiled with different instruction set flags,
+// and a shared inline function would let the linker pick an AVX-512 copy for the
+// scalar path
+namespace {
+
+struct Bvh8StackEntry {
+    uint32_t child;
+    uint32_t count;
+    float t;
+};
+
+inline Bvh8Ray MakeBvh8Ray(const float origin[3], const float direction[3], float t_min) {
+    const float big = 1e30f;
+    Bvh8Ray r;
+    for (int a = 0; a < 3; ++a) {
+        r.origin[a] = origin[a];
+        r.direction[a] = direction[a];
+        r.inv_direction[a] = direction[a] != 0.0f ? 1.0f / direction[a] : big;
+        r.origin_inv[a] = origin[a] * r.inv_direction[a];
+        r.negative[a] = r.inv_direction[a] < 0.0f;
+    }
+    r.t_min = t_min;
+    return r;
+}
+
+// Moller-Trumbore on raw floats, same math as IntersectTriangle
+inline bool IntersectBvh8Triangle(const Bvh8Triangle& tri, const Bvh8Ray& ray, float t_max, float& t, float& u, float& v) {
+    const float* d = ray.direction;
+    const float px = d[1] * tri.e2[2] - d[2] * tri.e2[1];
+    const float py = d[2] * tri.e2[0] - d[0] * tri.e2[2];
+    const float pz = d[0] * tri.e2[1] - d[1] * tri.e2[0];
+    const float det = tri.e1[0] * px + tri.e1[1] * py + tri.e1[2] * pz;
+    if (det == 0.0f) {
+        return false;
+    }
+    const float inv_det = 1.0f / det;
+    const float sx = ray.origin[0] - tri.v0[0];
+    const float sy = ray.origin[1] - tri.v0[1];
+    const float sz = ray.origin[2] - tri.v0[2];
+    const float uu = (sx * px + sy * py + sz * pz) * inv_det;
+    if (uu < 0.0f || uu > 1.0f) {
+        return false;
+    }
+    const float qx = sy * tri.e1[2] - sz * tri.e1[1];
+    const float qy = sz * tri.e1[0] - sx * tri.e1[2];
+    const float qz = sx * tri.e1[1] - sy * tri.e1[0];
+    const float vv = (d[0] * qx + d[1] * qy + d[2] * qz) * inv_det;
+    if (vv < 0.0f || uu + vv > 1.0f) {
+        return false;
+    }
+    const float tt = (tri.e2[0] * qx + tri.e2[1] * qy + tri.e2[2] * qz) * inv_det;
+    if (tt < ray.t_min || tt >= t_max) {
+        return false;
+    }
+    t = tt;
+    u = uu;
+    v = vv;
+    return true;
+}
+
+inline int LowestSlot(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Closest hit of one ray in the subtree below start; t_max shrinks to the hit distance
+// BoxTest is constructed from the ray; box_test(node, t_max, entry_t) returns the mask of
+// children whose box overlaps [t_min, t_max] and writes their entry distances
+template <class BoxTest>
+bool TraceBvh8(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& r, Bvh8StackEntry start,
+               float& t_max, float& hit_u, float& hit_v, uint32_t& primitive_id) {
+    const BoxTest box_test(r);
+    bool found = false;
+
+    Bvh8StackEntry stack[kBvh8StackSize];
+    int stack_size = 0;
+    Bvh8StackEntry entry = start;
+    for (;;) {
+        if (entry.count == 0) {
+            const Bvh8Node& node = nodes[entry.child];
+            alignas(32) float entry_t[Bvh8Node::kWidth];
+            uint32_t mask = box_test(node, t_max, entry_t);
+            if (mask != 0) {
+                int slot = LowestSlot(mask);
+                mask &= mask - 1;
+                entry = Bvh8StackEntry{ node.child[slot], node.count[slot], entry_t[slot] };
+                if (mask == 0) {
+                    continue;
+                }
+
+                // Several children hit: continue with the nearest, push the rest farthest first
+                Bvh8StackEntry children[Bvh8Node::kWidth];
+                children[0] = entry;
+                int num_children = 1;
+                while (mask != 0) {
+                    slot = LowestSlot(mask);
+                    mask &= mask - 1;
+                    Bvh8StackEntry child{ node.child[slot], node.count[slot], entry_t[slot] };
+                    int k = num_children++;
+                    while (k > 0 && children[k - 1].t < child.t) {
+                        children[k] = children[k - 1];
+                        --k;
+                    }
+                    children[k] = child;
+                }
+                for (int k = 0; k < num_children - 1; ++k) {
+                    stack[stack_size++] = children[k];
+                }
+                entry = children[num_children - 1];
+                continue;
+            }
+        } else {
+            for (uint32_t i = 0; i < entry.count; ++i) {
+                const Bvh8Triangle& tri = triangles[entry.child + i];
+                if (IntersectBvh8Triangle(tri, r, t_max, t_max, hit_u, hit_v)) {
+                    primitive_id = tri.primitive_id;
+                    found = true;
+                }
+            }
+        }
+
+        // Next postponed child that can still contain a closer hit
+        do {
+            if (stack_size == 0) {
+                return found;
+            }
+            entry = stack[--stack_size];
+        } while (entry.t > t_max);
+    }
+}
+
+template <class BoxTest>
+bool IntersectBvh8(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& r, Bvh8Hit& hit) {
+    return TraceBvh8<BoxTest>(nodes, triangles, r, Bvh8StackEntry{ 0, 0, r.t_min }, hit.t, hit.u, hit.v, hit.primitive_id);
+}
+
+template <class BoxTest>
+bool OccludedBvh8(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Ray& r, float t_max) {
+    const BoxTest box_test(r);
+
+    uint32_t stack[kBvh8StackSize];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const Bvh8Node& node = nodes[stack[--stack_size]];
+        alignas(32) float entry_t[Bvh8Node::kWidth];
+        uint32_t mask = box_test(node, t_max, entry_t);
+        while (mask != 0) {
+            int slot = LowestSlot(mask);
+            mask &= mask - 1;
+            if (node.count[slot] == 0) {
+                stack[stack_size++] = node.child[slot];
+                continue;
+            }
+            for (uint32_t i = 0; i < node.count[slot]; ++i) {
+                float t, u, v;
+                if (IntersectBvh8Triangle(triangles[node.child[slot] + i], r, t_max, t, u, v)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Triangle in the form used against a shared-origin packet: with s = origin - v0 fixed,
+// Moller-Trumbore reduces to three dot products with the ray direction
+struct PacketTriangle {
+    float normal[3];   // e2 x e1, so det = dot(d, normal)
+    float u_axis[3];   // e2 x s, so u = dot(d, u_axis) / det
+    float v_axis[3];   // s x e1, so v = dot(d, v_axis) / det
+    float t_numerator; // dot(e2, s x e1), so t = t_numerator / det
+};
+
+inline PacketTriangle MakePacketTriangle(const Bvh8Triangle& tri, const Bvh8Packet& packet) {
+    const float sx = packet.origin[0] - tri.v0[0];
+    const float sy = packet.origin[1] - tri.v0[1];
+    const float sz = packet.origin[2] - tri.v0[2];
+    PacketTriangle result;
+    result.normal[0] = tri.e2[1] * tri.e1[2] - tri.e2[2] * tri.e1[1];
+    result.normal[1] = tri.e2[2] * tri.e1[0] - tri.e2[0] * tri.e1[2];
+    result.normal[2] = tri.e2[0] * tri.e1[1] - tri.e2[1] * tri.e1[0];
+    result.u_axis[0] = tri.e2[1] * sz - tri.e2[2] * sy;
+    result.u_axis[1] = tri.e2[2] * sx - tri.e2[0] * sz;
+    result.u_axis[2] = tri.e2[0] * sy - tri.e2[1] * sx;
+    result.v_axis[0] = sy * tri.e1[2] - sz * tri.e1[1];
+    result.v_axis[1] = sz * tri.e1[0] - sx * tri.e1[2];
+    result.v_axis[2] = sx * tri.e1[1] - sy * tri.e1[0];
+    result.t_numerator = tri.e2[0] * result.v_axis[0] + tri.e2[1] * result.v_axis[1] + tri.e2[2] * result.v_axis[2];
+    return result;
+}
+
+// Fraction of the packet footprint below which a child box counts as divergent
+constexpr float kDivergentBoxFraction = 1.0f;
+
+// Child box small compared to the width of the packet at the box's distance
+inline bool IsDivergentChild(const Bvh8Node& node, int slot, float distance2, float spread) {
+    const float ex = node.upper_x[slot] - node.lower_x[slot];
+    const float ey = node.upper_y[slot] - node.lower_y[slot];
+    const float ez = node.upper_z[slot] - node.lower_z[slot];
+    const float size2 = ex * ex + ey * ey + ez * ez;
+    // Footprint ~ spread * distance; compare squared sizes, bounding distance by the
+    // near distance plus the box size
+    const float footprint = spread * kDivergentBoxFraction;
+    return size2 < footprint * footprint * (distance2 + size2);
+}
+
+// Trace every ray of the packet separately through the subtree in one slot of a node,
+// skipping the rays that miss its box
+template <class BoxTest>
+void TracePacketRays(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet, const Bvh8Node& node,
+                     int slot, const Bvh8PacketHits& hits, uint32_t instance_id) {
+    const float lower[3] = { node.lower_x[slot], node.lower_y[slot], node.lower_z[slot] };
+    const float upper[3] = { node.upper_x[slot], node.upper_y[slot], node.upper_z[slot] };
+    const Bvh8StackEntry start{ node.child[slot], node.count[slot], 0.0f };
+    for (int i = 0; i < packet.count; ++i) {
+        const float direction[3] = { packet.direction_x[i], packet.direction_y[i], packet.direction_z[i] };
+        const Bvh8Ray r = MakeBvh8Ray(packet.origin, direction, packet.t_min);
+        float t_max = hits.t[i];
+        float enter = r.t_min;
+        float exit = t_max;
+        for (int a = 0; a < 3; ++a) {
+            float t0 = (r.negative[a] ? upper[a] : lower[a]) * r.inv_direction[a] - r.origin_inv[a];
+            float t1 = (r.negative[a] ? lower[a] : upper[a]) * r.inv_direction[a] - r.origin_inv[a];
+            enter = t0 > enter ? t0 : enter;
+            exit = t1 < exit ? t1 : exit;
+        }
+        if (enter > exit) {
+            continue;
+        }
+
+        float u = 0.0f;
+        float v = 0.0f;
+        uint32_t primitive_id = 0;
+        if (TraceBvh8<BoxTest>(nodes, triangles, r, start, t_max, u, v, primitive_id)) {
+            hits.t[i] = t_max;
+            hits.u[i] = u;
+            hits.v[i] = v;
+            hits.primitive_id[i] = primitive_id;
+            hits.instance_id[i] = instance_id;
+        }
+    }
+}
+
+// Packet traversal: the eight child boxes are culled against the packet frustum and
+// against the farthest current hit; surviving children are visited nearest first
+// Once a child box is small compared to the packet footprint at its distance, only a
+// few of the rays can still hit it, so its subtree is traced ray by ray instead
+// LeafTest: void (const PacketTriangle&, uint32_t primitive_id, const Bvh8Packet&, const Bvh8PacketHits&, uint32_t instance_id)
+template <class BoxTest, class LeafTest>
+void IntersectPacketBvh8(const Bvh8Node* nodes, const Bvh8Triangle* triangles, const Bvh8Packet& packet,
+                         const Bvh8PacketHits& hits, uint32_t instance_id) {
+    const LeafTest leaf_test;
+    const float* origin = packet.origin;
+
+    // Offsets of the box corner farthest along each plane normal
+    int plane_offset[4][3];
+    for (int k = 0; k < 4; ++k) {
+        plane_offset[k][0] = packet.planes[k][0] >= 0.0f ? 8 : 0;
+        plane_offset[k][1] = packet.planes[k][1] >= 0.0f ? 24 : 16;
+        plane_offset[k][2] = packet.planes[k][2] >= 0.0f ? 40 : 32;
+    }
+
+    // Squared distance a box may be away from the origin and still hold a closer hit
+    auto compute_reach = [&]() {
+        float max_t = 0.0f;
+        for (int i = 0; i < packet.count; ++i) {
+            max_t = hits.t[i] > max_t ? hits.t[i] : max_t;
+        }
+        float reach = max_t * packet.max_direction_length;
+        return reach * reach;
+    };
+    float reach2 = compute_reach();
+
+    Bvh8StackEntry stack[kBvh8StackSize];
+    int stack_size = 0;
+    Bvh8StackEntry entry{ 0, 0, 0.0f };
+    for (;;) {
+        if (entry.count == 0) {
+            const Bvh8Node& node = nodes[entry.child];
+            const float* base = node.lower_x;
+            float distance2[Bvh8Node::kWidth];
+            uint32_t mask = 0;
+            for (int i = 0; i < Bvh8Node::kWidth; ++i) {
+                bool inside = true;
+                for (int k = 0; k < 4; ++k) {
+                    const float dot = packet.planes[k][0] * base[plane_offset[k][0] + i] +
+                                      packet.planes[k][1] * base[plane_offset[k][1] + i] +
+                                      packet.planes[k][2] * base[plane_offset[k][2] + i] + packet.planes[k][3];
+                    inside = inside && dot >= 0.0f;
+                }
+                float d2 = 0.0f;
+                for (int a = 0; a < 3; ++a) {
+                    const float below = base[16 * a + i] - origin[a];
+                    const float above = origin[a] - base[16 * a + 8 + i];
+                    float d = below > above ? below : above;
+                    d = d > 0.0f ? d : 0.0f;
+                    d2 += d * d;
+                }
+                distance2[i] = d2;
+                mask |= (inside && d2 <= reach2 ? 1u : 0u) << i;
+            }
+
+            if (mask != 0) {
+                Bvh8StackEntry children[Bvh8Node::kWidth];
+                int num_children = 0;
+                while (mask != 0) {
+                    int slot = LowestSlot(mask);
+                    mask &= mask - 1;
+                    Bvh8StackEntry child{ node.child[slot], node.count[slot], distance2[slot] };
+                    if (child.count == 0 && IsDivergentChild(node, slot, distance2[slot], packet.spread)) {
+                        TracePacketRays<BoxTest>(nodes, triangles, packet, node, slot, hits, instance_id);
+                        continue;
+                    }
+                    int k = num_children++;
+                    while (k > 0 && children[k - 1].t < child.t) {
+                        children[k] = children[k - 1];
+                        --k;
+                    }
+                    children[k] = child;
+                }
+                if (num_children > 0) {
+                    for (int k = 0; k < num_children - 1; ++k) {
+                        stack[stack_size++] = children[k];
+                    }
+                    entry = children[num_children - 1];
+                    continue;
+                }
+                reach2 = compute_reach();
+            }
+        } else {
+            for (uint32_t i = 0; i < entry.count; ++i) {
+                const Bvh8Triangle& tri = triangles[entry.child + i];
+                leaf_test(MakePacketTriangle(tri, packet), tri.primitive_id, packet, hits, instance_id);
+            }
+            reach2 = compute_reach();
+        }
+
+        do {
+            if (stack_size == 0) {
+                return;
+            }
+            entry = stack[--stack_size];
+        } while (entry.t > reach2);
+    }
+}
+
+}  // namespace
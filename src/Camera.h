@@ -0,0 +1,36 @@
+#pragma once
+#include "long_march.h"
+
+// Camera constants shared by the shader (space2) and the CPU renderer
+struct CameraObject {
+    glm::mat4 screen_to_camera;
+    glm::mat4 camera_to_world;
+};
+
+// Normalized direction of the ray through a point of a width x height film (pixel (x, y)
+// covers [x, x + 1) x [y, y + 1)), as computed in RayGenMain
+inline glm::vec3 GetCameraRayDirection(const CameraObject& camera, glm::vec2 film_position, int width, int height) {
+    glm::vec2 uv = film_position / glm::vec2(static_cast<float>(width), static_cast<float>(height));
+    uv.y = 1.0f - uv.y;
+    glm::vec2 d = uv * 2.0f - 1.0f;
+    glm::vec4 target = camera.screen_to_camera * glm::vec4(d, 1.0f, 1.0f);
+    glm::vec4 direction = camera.camera_to_world * glm::vec4(glm::vec3(target), 0.0f);
+    return glm::normalize(glm::vec3(direction));
+}
+
+// Inverse of GetCameraRayDirection: film position of a world-space point (w = 1) or
+// direction (w = 0), given inverse(camera_to_world) and inverse(screen_to_camera)
+// Returns false for points behind the camera
+inline bool ProjectToFilm(const glm::mat4& world_to_camera, const glm::mat4& camera_to_screen, const glm::vec4& point,
+                          int width, int height, glm::vec2& film_position) {
+    glm::vec4 camera_point = world_to_camera * point;
+    camera_point.w = 1.0f;
+    glm::vec4 screen = camera_to_screen * camera_point;
+    if (screen.w <= 0.0f) {
+        return false;
+    }
+    glm::vec2 uv = (glm::vec2(screen.x, screen.y) / screen.w + 1.0f) * 0.5f;
+    uv.y = 1.0f - uv.y;
+    film_position = uv * glm::vec2(static_cast<float>(width), static_cast<float>(height));
+    return true;
+}
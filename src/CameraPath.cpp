@@ -0,0 +1,134 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Cubic Hermite segment from p0 to p1 over duration, with tangents m0 and m1 per second
+template <typename T>
+T Hermite(const T& p0, const T& m0, const T& p1, const T& m1, float duration, float s) {
+    const float s2 = s * s;
+    const float s3 = s2 * s;
+    return p0 * (2.0f * s3 - 3.0f * s2 + 1.0f) + m0 * (duration * (s3 - 2.0f * s2 + s)) +
+           p1 * (3.0f * s2 - 2.0f * s3) + m1 * (duration * (s3 - s2));
+}
+
+// Catmull-Rom tangent of keyframe i: the slope between its neighbours, or towards the
+// only neighbour at either end
+template <typename T>
+T Tangent(const std::vector<CameraKeyframe>& keyframes, size_t i, T CameraKeyframe::* member) {
+    const size_t before = i > 0 ? i - 1 : i;
+    const size_t after = i + 1 < keyframes.size() ? i + 1 : i;
+    return (keyframes[after].*member - keyframes[before].*member) * (1.0f / (keyframes[after].time - keyframes[before].time));
+}
+
+}  // namespace
+
+bool CameraPath::AddKeyframe(const CameraKeyframe& keyframe) {
+    if (!keyframes_.empty() && !(keyframe.time > keyframes_.back().time)) {
+        grassland::LogWarning("Camera keyframe at {} s ignored: not after the last one ({} s)", keyframe.time, keyframes_.back().time);
+        return false;
+    }
+    keyframes_.push_back(keyframe);
+    return true;
+}
+
+bool CameraPath::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        grassland::LogError("Failed to open camera path: {}", path);
+        return false;
+    }
+
+    keyframes_.clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+        std::string statement;
+        if (!(stream >> statement)) {
+            continue;
+        }
+
+        CameraKeyframe keyframe;
+        if (statement != "key") {
+            grassland::LogError("{}:{}: unknown statement '{}'", path, line_number, statement);
+            return false;
+        }
+        if (!(stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >>
+              keyframe.yaw >> keyframe.pitch)) {
+            grassland::LogError("{}:{}: malformed keyframe", path, line_number);
+            return false;
+        }
+        if (!keyframes_.empty() && !(keyframe.time > keyframes_.back().time)) {
+            grassland::LogError("{}:{}: keyframe times must increase", path, line_number);
+            return false;
+        }
+        keyframes_.push_back(keyframe);
+    }
+    if (keyframes_.empty()) {
+        grassland::LogError("Camera path has no keyframes: {}", path);
+        return false;
+    }
+    return true;
+}
+
+bool CameraPath::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    file << "# time  position  yaw pitch (degrees)\n";
+    for (const CameraKeyframe& keyframe : keyframes_) {
+        file << "key " << keyframe.time << "  " << keyframe.position.x << ' ' << keyframe.position.y << ' '
+             << keyframe.position.z << "  " << keyframe.yaw << ' ' << keyframe.pitch << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+CameraKeyframe CameraPath::Evaluate(float time) const {
+    if (keyframes_.empty()) {
+        return CameraKeyframe{ time, glm::vec3(0.0f, 1.0f, 5.0f), -90.0f, 0.0f };
+    }
+    if (time <= keyframes_.front().time || keyframes_.size() == 1) {
+        CameraKeyframe pose = keyframes_.front();
+        pose.time = time;
+        return pose;
+    }
+    if (time >= keyframes_.back().time) {
+        CameraKeyframe pose = keyframes_.back();
+        pose.time = time;
+        return pose;
+    }
+
+    // Segment [i, i + 1] containing time
+    const size_t i = static_cast<size_t>(std::upper_bound(keyframes_.begin(), keyframes_.end(), time,
+                                                          [](float t, const CameraKeyframe& keyframe) { return t < keyframe.time; }) -
+                                         keyframes_.begin()) - 1;
+    const CameraKeyframe& k0 = keyframes_[i];
+    const CameraKeyframe& k1 = keyframes_[i + 1];
+    const float duration = k1.time - k0.time;
+    const float s = (time - k0.time) / duration;
+
+    CameraKeyframe pose;
+    pose.time = time;
+    pose.position = Hermite(k0.position, Tangent(keyframes_, i, &CameraKeyframe::position), k1.position,
+                            Tangent(keyframes_, i + 1, &CameraKeyframe::position), duration, s);
+    pose.yaw = Hermite(k0.yaw, Tangent(keyframes_, i, &CameraKeyframe::yaw), k1.yaw,
+                       Tangent(keyframes_, i + 1, &CameraKeyframe::yaw), duration, s);
+    // The spline may swing past the viewer's pitch limit between keyframes
+    pose.pitch = std::clamp(Hermite(k0.pitch, Tangent(keyframes_, i, &CameraKeyframe::pitch), k1.pitch,
+                                    Tangent(keyframes_, i + 1, &CameraKeyframe::pitch), duration, s),
+                            -89.0f, 89.0f);
+    return pose;
+}
+
+glm::vec3 CameraPath::GetFront(float yaw, float pitch) {
+    glm::vec3 front;
+    front.x = std::cos(glm::radians(yaw)) * std::cos(glm::radians(pitch));
+    front.y = std::sin(glm::radians(pitch));
+    front.z = std::sin(glm::radians(yaw)) * std::cos(glm::radians(pitch));
+    return glm::normalize(front);
+}
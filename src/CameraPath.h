@@ -0,0 +1,44 @@
+#pragma once
+#include "long_march.h"
+#include <string>
+#include <vector>
+
+// Camera pose at a point in time, in the viewer's terms: yaw and pitch in degrees, yaw
+// -90 looking down -Z (see Application::OnMouseMove)
+struct CameraKeyframe {
+    float time;  // Seconds
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// Keyframed camera animation for turntables and flythroughs
+// Position, yaw and pitch follow a Catmull-Rom spline through the keyframes, with
+// tangents taken over the neighbours' time span so the speed stays continuous when
+// keyframes are unevenly spaced; yaw is not wrapped, so a turntable can go from -90 to 270
+// Files hold one statement per line ('#' starts a comment):
+//   key TIME X Y Z YAW PITCH
+class CameraPath {
+public:
+    // Keyframes must come in increasing time order; false (and ignored) otherwise
+    bool AddKeyframe(const CameraKeyframe& keyframe);
+    void Clear() { keyframes_.clear(); }
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    // Pose at time (held at the first and last keyframes outside the path)
+    CameraKeyframe Evaluate(float time) const;
+
+    bool IsEmpty() const { return keyframes_.empty(); }
+    size_t GetKeyframeCount() const { return keyframes_.size(); }
+    const std::vector<CameraKeyframe>& GetKeyframes() const { return keyframes_; }
+    float GetStartTime() const { return keyframes_.empty() ? 0.0f : keyframes_.front().time; }
+    float GetEndTime() const { return keyframes_.empty() ? 0.0f : keyframes_.back().time; }
+
+    // View direction of a yaw and pitch, as the viewer computes camera_front_
+    static glm::vec3 GetFront(float yaw, float pitch);
+
+private:
+    std::vector<CameraKeyframe> keyframes_;
+};
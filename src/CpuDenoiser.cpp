@@ -0,0 +1,177 @@
+#include "CpuDenoiser.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Edge-stopping parameters of SVGF: luminance differences are measured in standard
+// deviations, normals by a power of their cosine, depth relative to the distance
+constexpr float kColorSigma = 4.0f;
+constexpr float kDepthSigma = 0.1f;  // Per pixel of tap offset
+
+// Fewer samples give too unreliable a variance; the neighborhood's is used instead
+constexpr int kMinTemporalSamples = 4;
+
+// Albedo is clamped before dividing so black surfaces keep their (zero) color
+constexpr float kMinAlbedo = 0.01f;
+
+// 1D B3-spline kernel by tap distance (1/16, 1/4, 3/8, 1/4, 1/16)
+constexpr float kKernel[3] = { 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+float Luminance(const glm::vec3& c) {
+    return glm::dot(c, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// max(cos, 0)^128 by repeated squaring
+float NormalWeight(const glm::vec3& a, const glm::vec3& b) {
+    float w = std::max(glm::dot(a, b), 0.0f);
+    for (int i = 0; i < 7; ++i) {
+        w *= w;
+    }
+    return w;
+}
+
+glm::vec3 ClampedAlbedo(const glm::vec3& albedo) {
+    return glm::max(albedo, glm::vec3(kMinAlbedo));
+}
+
+}  // namespace
+
+const glm::vec4* CpuDenoiser::Denoise(const CpuFilm& film, bool accumulated) {
+    const int width = film.GetWidth();
+    const int height = film.GetHeight();
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+    const glm::vec4* color = accumulated ? film.GetOutputData() : film.GetColorData();
+    const glm::vec3* albedo = film.GetAlbedoData();
+    const glm::vec4* normal_depth = film.GetNormalDepthData();
+    const int32_t* entity_ids = film.GetEntityIdData();
+    const int32_t* sample_counts = film.GetAccumulatedSamplesData();
+    for (std::vector<glm::vec4>& buffer : buffers_) {
+        buffer.resize(pixel_count);
+    }
+    output_.resize(pixel_count);
+    ThreadPool& pool = ThreadPool::Global();
+
+    // Demodulate, with the variance of the accumulated mean where it is reliable
+    pool.ParallelFor(pixel_count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 a = ClampedAlbedo(albedo[i]);
+            float variance = accumulated && sample_counts[i] >= kMinTemporalSamples ? film.GetMeanLuminanceVariance(i) : -1.0f;
+            float albedo_luminance = Luminance(a);
+            buffers_[0][i] = glm::vec4(glm::vec3(color[i]) / a,
+                                       variance < 0.0f ? -1.0f : variance / (albedo_luminance * albedo_luminance));
+        }
+    });
+
+    // Pixels without a variance estimate use their 3x3 neighborhood's
+    pool.ParallelFor(static_cast<size_t>(height), 4, [&](size_t begin, size_t end) {
+        for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y) {
+            for (int x = 0; x < width; ++x) {
+                size_t p = static_cast<size_t>(y) * width + x;
+                glm::vec4 center = buffers_[0][p];
+                if (center.w < 0.0f) {
+                    float sum = 0.0f;
+                    float sum2 = 0.0f;
+                    int count = 0;
+                    for (int qy = std::max(y - 1, 0); qy <= std::min(y + 1, height - 1); ++qy) {
+                        for (int qx = std::max(x - 1, 0); qx <= std::min(x + 1, width - 1); ++qx) {
+                            size_t q = static_cast<size_t>(qy) * width + qx;
+                            if (entity_ids[q] == entity_ids[p]) {
+                                float l = Luminance(glm::vec3(buffers_[0][q]));
+                                sum += l;
+                                sum2 += l * l;
+                                ++count;
+                            }
+                        }
+                    }
+                    float mean = sum / static_cast<float>(count);
+                    center.w = std::max(sum2 / static_cast<float>(count) - mean * mean, 0.0f);
+                }
+                buffers_[1][p] = center;
+            }
+        }
+    });
+
+    int source = 1;
+    for (int iteration = 0; iteration < iterations_; ++iteration) {
+        const int step = 1 << iteration;
+        const std::vector<glm::vec4>& in = buffers_[source];
+        std::vector<glm::vec4>& out = buffers_[1 - source];
+        pool.ParallelFor(static_cast<size_t>(height), 4, [&](size_t begin, size_t end) {
+            for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y) {
+                for (int x = 0; x < width; ++x) {
+                    size_t p = static_cast<size_t>(y) * width + x;
+                    const glm::vec4 center = in[p];
+                    const int32_t id = entity_ids[p];
+                    // The sky is noise free
+                    if (id < 0) {
+                        out[p] = center;
+                        continue;
+                    }
+                    const glm::vec3 normal = glm::vec3(normal_depth[p]);
+                    const float depth = normal_depth[p].w;
+                    const float luminance = Luminance(glm::vec3(center));
+                    // Variance prefiltered by a 3x3 Gaussian, as single-pixel estimates are noisy
+                    float variance = 0.0f;
+                    float variance_weight = 0.0f;
+                    for (int qy = std::max(y - 1, 0); qy <= std::min(y + 1, height - 1); ++qy) {
+                        for (int qx = std::max(x - 1, 0); qx <= std::min(x + 1, width - 1); ++qx) {
+                            size_t q = static_cast<size_t>(qy) * width + qx;
+                            if (entity_ids[q] == id) {
+                                float w = (qx == x ? 0.5f : 0.25f) * (qy == y ? 0.5f : 0.25f);
+                                variance += in[q].w * w;
+                                variance_weight += w;
+                            }
+                        }
+                    }
+                    const float color_scale = 1.0f / (kColorSigma * std::sqrt(variance / variance_weight) + 1e-4f);
+                    const float depth_scale = 1.0f / (kDepthSigma * depth * static_cast<float>(step) + 1e-6f);
+
+                    glm::vec3 color_sum(0.0f);
+                    float variance_sum = 0.0f;
+                    float weight_sum = 0.0f;
+                    for (int dy = -2; dy <= 2; ++dy) {
+                        int qy = y + dy * step;
+                        if (qy < 0 || qy >= height) {
+                            continue;
+                        }
+                        for (int dx = -2; dx <= 2; ++dx) {
+                            int qx = x + dx * step;
+                            if (qx < 0 || qx >= width) {
+                                continue;
+                            }
+                            size_t q = static_cast<size_t>(qy) * width + qx;
+                            if (entity_ids[q] != id) {
+                                continue;
+                            }
+                            const glm::vec4 sample = in[q];
+                            float weight = kKernel[std::abs(dx)] * kKernel[std::abs(dy)];
+                            if (q != p) {
+                                float distance = static_cast<float>(std::max(std::abs(dx), std::abs(dy)));
+                                float exponent = std::abs(Luminance(glm::vec3(sample)) - luminance) * color_scale +
+                                                 std::abs(normal_depth[q].w - depth) * depth_scale / distance;
+                                weight *= NormalWeight(normal, glm::vec3(normal_depth[q])) * std::exp(-exponent);
+                            }
+                            color_sum += glm::vec3(sample) * weight;
+                            variance_sum += sample.w * weight * weight;
+                            weight_sum += weight;
+                        }
+                    }
+                    out[p] = glm::vec4(color_sum / weight_sum, variance_sum / (weight_sum * weight_sum));
+                }
+            }
+        });
+        source = 1 - source;
+    }
+
+    // Remodulate
+    const std::vector<glm::vec4>& result = buffers_[source];
+    pool.ParallelFor(pixel_count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            output_[i] = glm::vec4(glm::vec3(result[i]) * ClampedAlbedo(albedo[i]), 1.0f);
+        }
+    });
+    return output_.data();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "long_march.h"
+#include "CpuFilm.h"
+#include <vector>
+
+// Edge-avoiding à-trous wavelet denoiser for CpuFilm images (Dammertz et al. 2010, with
+// the variance-guided luminance weights of SVGF)
+// The color is divided by the first-hit albedo so texture and material detail is not
+// blurred, then filtered by a 5x5 B-spline kernel whose taps spread out by 2^i in pass i
+// Taps are weighted down across changes of normal, depth and luminance (relative to the
+// estimated noise) and ignored across entity IDs, so edges between objects stay sharp
+class CpuDenoiser {
+public:
+    static constexpr int kDefaultIterations = 5;
+
+    CpuDenoiser() = default;
+
+    // Denoise the film's averaged output if accumulated, otherwise the last frame's color,
+    // and return the result (valid until the next call)
+    const glm::vec4* Denoise(const CpuFilm& film, bool accumulated);
+
+    // Number of à-trous passes; the filter reaches 2^(iterations + 1) pixels
+    void SetIterations(int iterations) { iterations_ = iterations; }
+    int GetIterations() const { return iterations_; }
+
+private:
+    int iterations_ = kDefaultIterations;
+
+    // Demodulated color with its luminance variance in w, ping-ponged between passes
+    std::vector<glm::vec4> buffers_[2];
+    std::vector<glm::vec4> output_;
+};
@@ -0,0 +1,80 @@
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SHORT_MARCH_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+#if defined(SHORT_MARCH_X86)
+void Cpuid(int leaf, int subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for (int i = 0; i < 4; ++i) {
+        regs[i] = static_cast<uint32_t>(info[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+uint64_t ReadXcr0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax = 0;
+    uint32_t edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+CpuFeatures Detect() {
+    CpuFeatures features;
+    uint32_t regs[4];
+    Cpuid(0, 0, regs);
+    const uint32_t max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return features;
+    }
+
+    Cpuid(1, 0, regs);
+    const bool osxsave = (regs[2] >> 27) & 1;
+    features.sse41 = (regs[2] >> 19) & 1;
+    const bool cpu_avx = (regs[2] >> 28) & 1;
+    const bool cpu_fma = (regs[2] >> 12) & 1;
+
+    // XMM/YMM state (bits 1, 2) and opmask/ZMM state (bits 5, 6, 7) enabled by the OS
+    const uint64_t xcr0 = osxsave ? ReadXcr0() : 0;
+    const bool os_avx = (xcr0 & 0x6) == 0x6;
+    const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+    features.avx = cpu_avx && os_avx;
+    features.fma = cpu_fma && os_avx;
+    if (max_leaf >= 7) {
+        Cpuid(7, 0, regs);
+        features.avx2 = features.avx && ((regs[1] >> 5) & 1);
+        features.avx512f = os_avx512 && ((regs[1] >> 16) & 1);
+    }
+    return features;
+}
+#else
+CpuFeatures Detect() {
+    return CpuFeatures();
+}
+#endif
+
+}  // namespace
+
+const CpuFeatures& CpuFeatures::Get() {
+    static const CpuFeatures features = Detect();
+    return features;
+}
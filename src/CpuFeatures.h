@@ -0,0 +1,14 @@
+#pragma once
+
+// Instruction set extensions usable by the CPU backend, detected once via CPUID
+// A feature only counts as available when the OS also saves the matching register state
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false;
+
+    // Detected on first use
+    static const CpuFeatures& Get();
+};
@@ -0,0 +1,309 @@
+#include "CpuFilm.h"
+#include "CpuFeatures.h"
+#include "FilmKernels.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static_assert(sizeof(glm::vec4) == 4 * sizeof(float), "film kernels read glm::vec4 as four floats");
+
+namespace {
+
+struct FilmKernel {
+    void (*accumulate)(const float* color, float* accumulated, size_t count);
+    void (*accumulate_compensated)(const float* color, float* accumulated, float* compensation, size_t count);
+    void (*develop_counts)(const float* accumulated, const int32_t* samples, float* output, size_t pixel_count);
+};
+
+// Relative noise is measured against at least this luminance, so dark pixels are not
+// sampled forever chasing a tiny absolute error
+constexpr float kMinNoiseLuminance = 0.05f;
+
+// History is rejected where the reprojected depth differs by more than this fraction
+constexpr float kReprojectionDepthTolerance = 0.05f;
+
+FilmKernel SelectKernel() {
+#if defined(SHORT_MARCH_X86_SIMD)
+    if (CpuFeatures::Get().avx) {
+        return FilmKernel{ FilmAccumulateAvx, FilmAccumulateCompensatedAvx, FilmDevelopCountsAvx };
+    }
+#endif
+    return FilmKernel{ FilmAccumulateScalar, FilmAccumulateCompensatedScalar, FilmDevelopCountsScalar };
+}
+
+const FilmKernel& GetKernel() {
+    static const FilmKernel kernel = SelectKernel();
+    return kernel;
+}
+
+}  // namespace
+
+void FilmAccumulateScalar(const float* color, float* accumulated, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        accumulated[i] += color[i];
+    }
+}
+
+void FilmAccumulateCompensatedScalar(const float* color, float* accumulated, float* compensation, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        float y = color[i] - compensation[i];
+        float t = accumulated[i] + y;
+        compensation[i] = (t - accumulated[i]) - y;
+        accumulated[i] = t;
+    }
+}
+
+void FilmDevelopCountsScalar(const float* accumulated, const int32_t* samples, float* output, size_t pixel_count) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        float scale = samples[i] > 0 ? 1.0f / static_cast<float>(samples[i]) : 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            output[i * 4 + c] = accumulated[i * 4 + c] * scale;
+        }
+    }
+}
+
+CpuFilm::CpuFilm(int width, int height)
+    : width_(0)
+    , height_(0)
+    , sample_count_(0) {
+    Resize(width, height);
+}
+
+void CpuFilm::Reset() {
+    std::fill(accumulated_color_.begin(), accumulated_color_.end(), glm::vec4(0.0f));
+    std::fill(accumulated_samples_.begin(), accumulated_samples_.end(), 0);
+    std::fill(compensation_.begin(), compensation_.end(), glm::vec4(0.0f));
+    std::fill(output_.begin(), output_.end(), glm::vec4(0.0f));
+
+    std::fill(luminance_mean_.begin(), luminance_mean_.end(), 0.0f);
+    std::fill(luminance_m2_.begin(), luminance_m2_.end(), 0.0f);
+    std::fill(tile_noise_.begin(), tile_noise_.end(), std::numeric_limits<float>::infinity());
+    noise_level_ = 0.0f;
+    ClearConvergence();
+
+    sample_count_ = 0;
+    output_stale_ = false;
+    reprojecting_ = false;
+    grassland::LogInfo("Film accumulation reset");
+}
+
+void CpuFilm::AccumulatePixels(size_t first, size_t count) {
+    if (reprojecting_) {
+        ReprojectPixels(first, count);
+    }
+    if (precision_ == FilmPrecision::kCompensated) {
+        GetKernel().accumulate_compensated(&color_[first].x, &accumulated_color_[first].x, &compensation_[first].x, count * 4);
+    } else {
+        GetKernel().accumulate(&color_[first].x, &accumulated_color_[first].x, count * 4);
+    }
+    for (size_t i = first; i < first + count; ++i) {
+        int32_t samples = ++accumulated_samples_[i];
+        float luminance = glm::dot(glm::vec3(color_[i]), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        float delta = luminance - luminance_mean_[i];
+        luminance_mean_[i] += delta / static_cast<float>(samples);
+        luminance_m2_[i] += delta * (luminance - luminance_mean_[i]);
+    }
+}
+
+void CpuFilm::SetPrecision(FilmPrecision precision) {
+    if (precision == precision_) {
+        return;
+    }
+    if (precision == FilmPrecision::kCompensated) {
+        compensation_.assign(accumulated_color_.size(), glm::vec4(0.0f));
+    } else {
+        FoldCompensation();
+        compensation_.clear();
+        compensation_.shrink_to_fit();
+    }
+    precision_ = precision;
+}
+
+void CpuFilm::FoldCompensation() {
+    if (compensation_.empty()) {
+        return;
+    }
+    ThreadPool::Global().ParallelFor(compensation_.size(), 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            accumulated_color_[i] = accumulated_color_[i] - compensation_[i];
+            compensation_[i] = glm::vec4(0.0f);
+        }
+    });
+}
+
+void CpuFilm::Reproject(const CameraObject& previous, const CameraObject& current) {
+    // History is moved between pixels and rescaled, which the compensation would not follow
+    FoldCompensation();
+
+    // The accumulation becomes the history every pixel of the next frame starts from
+    size_t pixel_count = color_.size();
+    history_color_.resize(pixel_count);
+    history_samples_.resize(pixel_count);
+    history_luminance_mean_.resize(pixel_count);
+    history_luminance_m2_.resize(pixel_count);
+    history_color_.swap(accumulated_color_);
+    history_samples_.swap(accumulated_samples_);
+    history_luminance_mean_.swap(luminance_mean_);
+    history_luminance_m2_.swap(luminance_m2_);
+    history_entity_ids_ = entity_ids_;
+    history_depth_.resize(pixel_count);
+    ThreadPool::Global().ParallelFor(pixel_count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            history_depth_[i] = normal_depth_[i].w;
+        }
+    });
+
+    current_camera_ = current;
+    previous_world_to_camera_ = glm::inverse(previous.camera_to_world);
+    previous_camera_to_screen_ = glm::inverse(previous.screen_to_camera);
+    previous_origin_ = glm::vec3(previous.camera_to_world[3]);
+    reprojecting_ = true;
+    output_stale_ = true;
+    ClearConvergence();
+}
+
+void CpuFilm::ReprojectPixels(size_t first, size_t count) {
+    const glm::vec3 origin = glm::vec3(current_camera_.camera_to_world[3]);
+    for (size_t i = first; i < first + count; ++i) {
+        // The first hit, along the ray through the pixel center, or the sky direction
+        glm::vec2 film_position(static_cast<float>(i % width_) + 0.5f, static_cast<float>(i / width_) + 0.5f);
+        glm::vec3 direction = GetCameraRayDirection(current_camera_, film_position, width_, height_);
+        bool sky = entity_ids_[i] < 0;
+        glm::vec3 position = origin + direction * normal_depth_[i].w;
+        glm::vec4 point = sky ? glm::vec4(direction, 0.0f) : glm::vec4(position, 1.0f);
+
+        glm::vec2 previous_position;
+        int32_t samples = 0;
+        size_t j = 0;
+        if (ProjectToFilm(previous_world_to_camera_, previous_camera_to_screen_, point, width_, height_, previous_position) &&
+            previous_position.x >= 0.0f && previous_position.y >= 0.0f &&
+            previous_position.x < static_cast<float>(width_) && previous_position.y < static_cast<float>(height_)) {
+            j = static_cast<size_t>(previous_position.y) * width_ + static_cast<size_t>(previous_position.x);
+            samples = history_samples_[j];
+            // Disocclusion: another surface was seen there, or the same one at another depth
+            if (history_entity_ids_[j] != entity_ids_[i]) {
+                samples = 0;
+            } else if (!sky) {
+                float depth = glm::length(position - previous_origin_);
+                if (std::abs(history_depth_[j] - depth) > kReprojectionDepthTolerance * depth) {
+                    samples = 0;
+                }
+            }
+        }
+
+        if (samples == 0) {
+            accumulated_color_[i] = glm::vec4(0.0f);
+            accumulated_samples_[i] = 0;
+            luminance_mean_[i] = 0.0f;
+            luminance_m2_[i] = 0.0f;
+            continue;
+        }
+        // Weight the history as at most kMaxHistoryLength samples
+        int32_t kept = std::min(samples, kMaxHistoryLength);
+        float scale = static_cast<float>(kept) / static_cast<float>(samples);
+        accumulated_color_[i] = history_color_[j] * scale;
+        accumulated_samples_[i] = kept;
+        luminance_mean_[i] = history_luminance_mean_[j];
+        luminance_m2_[i] = history_luminance_m2_[j] * scale;
+    }
+}
+
+size_t CpuFilm::UpdateConvergence(float threshold, int min_samples) {
+    min_samples = std::max(min_samples, 2);
+    ThreadPool::Global().ParallelFor(tile_converged_.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            if (tile_converged_[tile]) {
+                continue;
+            }
+            int x0 = static_cast<int>(tile % tiles_x_) * kTileSize;
+            int y0 = static_cast<int>(tile / tiles_x_) * kTileSize;
+            int x1 = std::min(x0 + kTileSize, width_);
+            int y1 = std::min(y0 + kTileSize, height_);
+
+            float noise_sum = 0.0f;
+            bool enough_samples = true;
+            for (int y = y0; y < y1 && enough_samples; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    size_t pixel = static_cast<size_t>(y) * width_ + x;
+                    int32_t samples = accumulated_samples_[pixel];
+                    if (samples < min_samples) {
+                        enough_samples = false;
+                        break;
+                    }
+                    float variance = luminance_m2_[pixel] / static_cast<float>(samples - 1);
+                    float standard_error = std::sqrt(variance / static_cast<float>(samples));
+                    noise_sum += standard_error / std::max(luminance_mean_[pixel], kMinNoiseLuminance);
+                }
+            }
+            if (!enough_samples) {
+                tile_noise_[tile] = std::numeric_limits<float>::infinity();
+                continue;
+            }
+            tile_noise_[tile] = noise_sum / static_cast<float>((x1 - x0) * (y1 - y0));
+            tile_converged_[tile] = tile_noise_[tile] <= threshold;
+        }
+    });
+
+    active_tile_count_ = 0;
+    noise_level_ = 0.0f;
+    for (size_t tile = 0; tile < tile_converged_.size(); ++tile) {
+        active_tile_count_ += tile_converged_[tile] ? 0 : 1;
+        noise_level_ = std::max(noise_level_, tile_noise_[tile]);
+    }
+    return active_tile_count_;
+}
+
+void CpuFilm::ClearConvergence() {
+    if (active_tile_count_ == tile_converged_.size()) {
+        return;
+    }
+    std::fill(tile_converged_.begin(), tile_converged_.end(), 0);
+    active_tile_count_ = tile_converged_.size();
+}
+
+void CpuFilm::DevelopToOutput() const {
+    if (!output_stale_ || sample_count_ == 0) {
+        return;
+    }
+    // Per-pixel counts: with adaptive sampling converged tiles stop receiving samples
+    const FilmKernel& kernel = GetKernel();
+    ThreadPool::Global().ParallelFor(output_.size(), 16384, [&](size_t begin, size_t end) {
+        kernel.develop_counts(&accumulated_color_[begin].x, &accumulated_samples_[begin], &output_[begin].x, end - begin);
+    });
+    output_stale_ = false;
+}
+
+void CpuFilm::Resize(int width, int height) {
+    if (width == width_ && height == height_) {
+        return;
+    }
+
+    width_ = width;
+    height_ = height;
+
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    color_.assign(pixel_count, glm::vec4(0.0f));
+    entity_ids_.assign(pixel_count, -1);
+    albedo_.assign(pixel_count, glm::vec3(1.0f));
+    normal_depth_.assign(pixel_count, glm::vec4(0.0f));
+    accumulated_color_.assign(pixel_count, glm::vec4(0.0f));
+    accumulated_samples_.assign(pixel_count, 0);
+    output_.assign(pixel_count, glm::vec4(0.0f));
+    if (precision_ == FilmPrecision::kCompensated) {
+        compensation_.assign(pixel_count, glm::vec4(0.0f));
+    }
+    luminance_mean_.assign(pixel_count, 0.0f);
+    luminance_m2_.assign(pixel_count, 0.0f);
+    tiles_x_ = (width_ + kTileSize - 1) / kTileSize;
+    tiles_y_ = (height_ + kTileSize - 1) / kTileSize;
+    tile_converged_.assign(static_cast<size_t>(tiles_x_) * tiles_y_, 0);
+    tile_noise_.assign(tile_converged_.size(), std::numeric_limits<float>::infinity());
+    active_tile_count_ = tile_converged_.size();
+    noise_level_ = 0.0f;
+    sample_count_ = 0;
+    output_stale_ = false;
+
+    grassland::LogInfo("Film resized to {}x{}", width, height);
+}
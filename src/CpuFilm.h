@@ -0,0 +1,160 @@
+#pragma once
+#include "long_march.h"
+#include "Camera.h"
+#include <vector>
+
+// How CpuFilm sums samples
+enum class FilmPrecision {
+    kFloat,        // Plain float sums, as the GPU film
+    kCompensated,  // Kahan summation, for renders of many thousands of samples per pixel
+};
+
+// CPU-side counterpart of Film for the CPU ray tracing backend
+// Holds the same buffers the shader writes (output, entity ID, accumulated color/samples)
+// as plain arrays so the renderer can write them directly
+// The buffers persist across frames; the averaged output is only recomputed when it
+// is read after new samples arrived
+// For adaptive sampling it also tracks the variance of every pixel's luminance and
+// marks kTileSize x kTileSize tiles as converged once their noise is low enough
+// The renderer also writes the albedo, normal and depth of each pixel's first hit in the
+// last frame, which guide the denoiser (CpuDenoiser) and temporal reprojection
+class CpuFilm {
+public:
+    static constexpr int kTileSize = 16;
+
+    CpuFilm(int width, int height);
+
+    // Reset accumulation (call when camera moves or scene changes)
+    void Reset();
+
+    // Get current sample count
+    int GetSampleCount() const { return sample_count_; }
+
+    // Increment sample count (ends the frame, including any reprojection)
+    void IncrementSampleCount() { sample_count_++; output_stale_ = true; reprojecting_ = false; }
+
+    // Add the color of pixels [first, first + count) to their sums, sample counts and
+    // luminance statistics; threads may accumulate disjoint ranges concurrently
+    void AccumulatePixels(size_t first, size_t count);
+
+    // With float sums, once a pixel's sum is about 2^24 times a sample the sample is
+    // rounded away and the image stops converging; compensated summation keeps the
+    // rounding error per channel and feeds it back into the next addition
+    // Switching keeps the accumulated samples
+    void SetPrecision(FilmPrecision precision);
+    FilmPrecision GetPrecision() const { return precision_; }
+
+    // Keep the accumulated samples when the camera moves from previous to current: in
+    // the next frame each pixel starts from the history of the pixel its first hit was
+    // seen through in the previous view, unless the entity ID or depth there shows the
+    // point was hidden or off screen. History is capped at kMaxHistoryLength samples so
+    // stale shading fades while the view keeps changing
+    // Every tile becomes active; call before rendering the frame
+    void Reproject(const CameraObject& previous, const CameraObject& current);
+
+    // Re-evaluate the tiles that are still active: a tile converges once all its pixels
+    // have min_samples samples and its noise is at most threshold
+    // Noise is the standard error of a pixel's mean luminance relative to that
+    // luminance, averaged over the tile; returns the number of active tiles left
+    size_t UpdateConvergence(float threshold, int min_samples);
+
+    // Make every tile active again, keeping the samples (e.g. while the view changes)
+    void ClearConvergence();
+
+    // Convergence mask: one entry per tile, row-major, non-zero once converged
+    const std::vector<uint8_t>& GetConvergenceMask() const { return tile_converged_; }
+    bool IsTileConverged(size_t tile) const { return tile_converged_[tile] != 0; }
+    size_t GetActiveTileCount() const { return active_tile_count_; }
+    size_t GetTileCount() const { return tile_converged_.size(); }
+    int GetTileCountX() const { return tiles_x_; }
+
+    // Highest tile noise at the last UpdateConvergence
+    float GetNoiseLevel() const { return noise_level_; }
+
+    // Variance of the mean luminance of a pixel's accumulated samples (the squared
+    // standard error), or -1 while it has fewer than two samples
+    float GetMeanLuminanceVariance(size_t pixel) const {
+        int32_t samples = accumulated_samples_[pixel];
+        return samples < 2 ? -1.0f : luminance_m2_[pixel] / (static_cast<float>(samples) * static_cast<float>(samples - 1));
+    }
+
+    // Convert accumulated data to final output image (divide by per-pixel sample counts)
+    // Optional: GetOutputData develops on demand, and either is free without new samples
+    void DevelopToOutput() const;
+
+    // Resize the film (call when window resizes)
+    void Resize(int width, int height);
+
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+
+    // Immediate color of the last frame (space1 in the shader)
+    glm::vec4* GetColorData() { return color_.data(); }
+    const glm::vec4* GetColorData() const { return color_.data(); }
+
+    // Entity ID per pixel, -1 for sky (space5)
+    int32_t* GetEntityIdData() { return entity_ids_.data(); }
+    const int32_t* GetEntityIdData() const { return entity_ids_.data(); }
+
+    // Base color of the first hit of the last frame, 1 for sky
+    glm::vec3* GetAlbedoData() { return albedo_.data(); }
+    const glm::vec3* GetAlbedoData() const { return albedo_.data(); }
+
+    // World-space shading normal (xyz) and distance from the camera (w) of the first hit
+    // of the last frame; zero for sky
+    glm::vec4* GetNormalDepthData() { return normal_depth_.data(); }
+    const glm::vec4* GetNormalDepthData() const { return normal_depth_.data(); }
+
+    // Sum of all samples (space6)
+    glm::vec4* GetAccumulatedColorData() { return accumulated_color_.data(); }
+    const glm::vec4* GetAccumulatedColorData() const { return accumulated_color_.data(); }
+
+    // Samples per pixel (space7)
+    int32_t* GetAccumulatedSamplesData() { return accumulated_samples_.data(); }
+    const int32_t* GetAccumulatedSamplesData() const { return accumulated_samples_.data(); }
+
+    // Averaged result, developed first if samples were added since it was last read
+    const glm::vec4* GetOutputData() const { DevelopToOutput(); return output_.data(); }
+
+private:
+    int width_;
+    int height_;
+    int sample_count_; // Number of accumulated samples
+
+    std::vector<glm::vec4> color_;
+    std::vector<int32_t> entity_ids_;
+    std::vector<glm::vec3> albedo_;
+    std::vector<glm::vec4> normal_depth_;
+    std::vector<glm::vec4> accumulated_color_;
+    std::vector<int32_t> accumulated_samples_;
+    FilmPrecision precision_ = FilmPrecision::kFloat;
+    std::vector<glm::vec4> compensation_;  // Kahan compensation of accumulated_color_
+    mutable std::vector<glm::vec4> output_;
+    mutable bool output_stale_ = false;
+
+    // Running mean and sum of squared deviations of each pixel's luminance (Welford)
+    std::vector<float> luminance_mean_;
+    std::vector<float> luminance_m2_;
+    // Reprojection: the accumulation of the previous view and its guides
+    static constexpr int32_t kMaxHistoryLength = 16;
+    void ReprojectPixels(size_t first, size_t count);
+    void FoldCompensation();  // Add the compensation into the sums and clear it
+    bool reprojecting_ = false;
+    CameraObject current_camera_{};
+    glm::mat4 previous_world_to_camera_{ 1.0f };
+    glm::mat4 previous_camera_to_screen_{ 1.0f };
+    glm::vec3 previous_origin_{ 0.0f };
+    std::vector<glm::vec4> history_color_;
+    std::vector<int32_t> history_samples_;
+    std::vector<float> history_luminance_mean_;
+    std::vector<float> history_luminance_m2_;
+    std::vector<int32_t> history_entity_ids_;
+    std::vector<float> history_depth_;
+
+    int tiles_x_ = 0;
+    int tiles_y_ = 0;
+    std::vector<uint8_t> tile_converged_;
+    std::vector<float> tile_noise_;
+    size_t active_tile_count_ = 0;
+    float noise_level_ = 0.0f;
+};
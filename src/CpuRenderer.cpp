@@ -0,0 +1,386 @@
+#include "CpuRenderer.h"
+#include "Bsdf.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// The fixed light of the old placeholder shading, now a sun with physical irradiance
+const glm::vec3 kSunDirection = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+const glm::vec3 kSunIrradiance = glm::vec3(2.0f);
+
+constexpr float kRayEpsilon = 0.001f;  // t_min of every ray, as for primary rays
+
+// Light reaching the camera after bounces is clamped to this, so rare paths such as the
+// sun seen through a glossy reflection from a diffuse surface do not become fireflies
+constexpr float kMaxIndirectRadiance = 4.0f;
+
+// Weight of a strategy with pdf a against one with pdf b (power heuristic, beta = 2)
+float PowerHeuristic(float a, float b) {
+    float a2 = a * a;
+    float b2 = b * b;
+    return a2 + b2 > 0.0f ? a2 / (a2 + b2) : 0.0f;
+}
+
+}  // namespace
+
+void CpuRenderer::Render(const Scene& scene, const CameraObject& camera, CpuFilm* film) const {
+    const int width = film->GetWidth();
+    const int height = film->GetHeight();
+    const std::vector<ShadingInstance> instances = GetShadingInstances(scene);
+    const ShadingContext context{ scene.GetCpuTLAS(), scene.GetMaterials(), instances, GetSceneBounds(scene.GetCpuTLAS()) };
+    const CpuTlas& tlas = context.tlas;
+
+    glm::vec4* output = film->GetColorData();
+    int32_t* entity_id_output = film->GetEntityIdData();
+
+    const int tiles_x = (width + kTileSize - 1) / kTileSize;
+    const int tiles_y = (height + kTileSize - 1) / kTileSize;
+    std::vector<uint32_t> tile_order = MortonTileOrder(tiles_x, tiles_y);
+    if (film->GetActiveTileCount() < film->GetTileCount()) {
+        tile_order.erase(std::remove_if(tile_order.begin(), tile_order.end(),
+                                        [film](uint32_t tile) { return film->IsTileConverged(tile); }),
+                         tile_order.end());
+    }
+
+    // Add a tile's colors to the running sums, a row at a time
+    auto accumulate_tile = [&](uint32_t tile) {
+        TileRect rect = GetTileRect(tile, tiles_x, width, height);
+        for (int y = rect.y0; y < rect.y1; ++y) {
+            film->AccumulatePixels(static_cast<size_t>(y) * width + rect.x0, rect.x1 - rect.x0);
+        }
+    };
+
+    if (path_scheduling_ == PathScheduling::kWavefront) {
+        // Consecutive tiles in Morton order form one batch of paths
+        size_t batch_count = (tile_order.size() + kWavefrontTiles - 1) / kWavefrontTiles;
+        ThreadPool::Global().ParallelFor(batch_count, 1, [&](size_t begin, size_t end) {
+            uint64_t ray_count = 0;
+            for (size_t batch = begin; batch < end; ++batch) {
+                size_t first = batch * kWavefrontTiles;
+                size_t count = std::min<size_t>(kWavefrontTiles, tile_order.size() - first);
+                RenderWavefront(context, camera, film, &tile_order[first], count, tiles_x, ray_count);
+                for (size_t i = first; i < first + count; ++i) {
+                    accumulate_tile(tile_order[i]);
+                }
+            }
+            ray_count_ += ray_count;
+        });
+        return;
+    }
+
+    ThreadPool::Global().ParallelFor(tile_order.size(), 1, [&](size_t begin, size_t end) {
+        RayPacket packet;
+        PacketHits hits;
+        std::vector<Sampler> samplers;  // Of the packet's pixels, continued by their paths
+        samplers.reserve(RayPacket::kMaxRays);
+        uint64_t ray_count = 0;
+        for (size_t i = begin; i < end; ++i) {
+            TileRect rect = GetTileRect(tile_order[i], tiles_x, width, height);
+
+            // Primary rays of each block share the camera origin and are traced as one packet
+            for (int y0 = rect.y0; y0 < rect.y1; y0 += kPacketSize) {
+                for (int x0 = rect.x0; x0 < rect.x1; x0 += kPacketSize) {
+                    samplers.clear();
+                    GeneratePrimaryPacket(camera, *film, x0, y0, std::min(kPacketSize, rect.x1 - x0),
+                                          std::min(kPacketSize, rect.y1 - y0), packet, samplers);
+                    hits.Reset(packet.GetRayCount(), kRayTMax);
+                    tlas.IntersectPacket(packet, hits);
+                    ray_count += packet.GetRayCount();
+
+                    for (int py = 0; py < packet.height; ++py) {
+                        for (int px = 0; px < packet.width; ++px) {
+                            int index = py * packet.width + px;
+                            RayPayload payload;
+                            payload.color = glm::vec3(0.0f);
+                            payload.hit = false;
+                            payload.instance_id = 0;
+
+                            HitRecord hit = hits.GetHit(index);
+                            Ray ray = packet.GetRay(index, kRayTMax);
+                            if (hit.IsHit()) {
+                                ClosestHitMain(context, ray, hit, samplers[index], payload, ray_count);
+                                payload.instance_id = hit.instance_id;
+                            } else {
+                                MissMain(ray, payload);
+                            }
+
+                            size_t pixel = static_cast<size_t>(y0 + py) * width + x0 + px;
+                            WriteGuides(context, ray, hit, film, pixel);
+                            output[pixel] = glm::vec4(payload.color, 1.0f);
+                            entity_id_output[pixel] = payload.hit ? static_cast<int32_t>(payload.instance_id) : -1;
+                        }
+                    }
+                }
+            }
+            accumulate_tile(tile_order[i]);
+        }
+        ray_count_ += ray_count;
+    });
+}
+
+void CpuRenderer::GeneratePrimaryPacket(const CameraObject& camera, const CpuFilm& film, int x0, int y0,
+                                        int block_width, int block_height, RayPacket& packet,
+                                        std::vector<Sampler>& samplers) const {
+    const int width = film.GetWidth();
+    const int height = film.GetHeight();
+    const int32_t* sample_counts = film.GetAccumulatedSamplesData();
+
+    packet.origin = glm::vec3(camera.camera_to_world * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    packet.t_min = kRayEpsilon;
+    packet.width = block_width;
+    packet.height = block_height;
+    const glm::vec2 block_corners[4] = {
+        glm::vec2(x0, y0), glm::vec2(x0 + block_width, y0),
+        glm::vec2(x0 + block_width, y0 + block_height), glm::vec2(x0, y0 + block_height)
+    };
+    for (int c = 0; c < 4; ++c) {
+        packet.corner_directions[c] = RayGenDirection(camera, block_corners[c], width, height);
+    }
+    for (int j = 0; j < block_height; ++j) {
+        for (int i = 0; i < block_width; ++i) {
+            int x = x0 + i;
+            int y = y0 + j;
+            samplers.emplace_back(sampler_type_, x, y, static_cast<uint32_t>(sample_counts[static_cast<size_t>(y) * width + x]));
+            glm::vec2 film_position = glm::vec2(x, y) + samplers.back().Get2D();
+            glm::vec3 direction = RayGenDirection(camera, film_position, width, height);
+            int index = j * block_width + i;
+            packet.direction_x[index] = direction.x;
+            packet.direction_y[index] = direction.y;
+            packet.direction_z[index] = direction.z;
+        }
+    }
+}
+
+CpuRenderer::TileRect CpuRenderer::GetTileRect(uint32_t tile, int tiles_x, int width, int height) {
+    TileRect rect;
+    rect.x0 = static_cast<int>(tile % tiles_x) * kTileSize;
+    rect.y0 = static_cast<int>(tile / tiles_x) * kTileSize;
+    rect.x1 = std::min(rect.x0 + kTileSize, width);
+    rect.y1 = std::min(rect.y0 + kTileSize, height);
+    return rect;
+}
+
+std::vector<uint32_t> CpuRenderer::MortonTileOrder(int tiles_x, int tiles_y) {
+    // Walk the Morton curve of the enclosing power-of-two square and keep the tiles inside
+    uint32_t side = 1;
+    while (side < static_cast<uint32_t>(std::max(tiles_x, tiles_y))) {
+        side *= 2;
+    }
+    std::vector<uint32_t> order;
+    order.reserve(static_cast<size_t>(tiles_x) * tiles_y);
+    for (uint64_t code = 0; code < static_cast<uint64_t>(side) * side; ++code) {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        for (uint32_t bit = 0; (1u << bit) < side; ++bit) {
+            x |= static_cast<uint32_t>((code >> (2 * bit)) & 1) << bit;
+            y |= static_cast<uint32_t>((code >> (2 * bit + 1)) & 1) << bit;
+        }
+        if (x < static_cast<uint32_t>(tiles_x) && y < static_cast<uint32_t>(tiles_y)) {
+            order.push_back(y * tiles_x + x);
+        }
+    }
+    return order;
+}
+
+glm::vec3 CpuRenderer::RayGenDirection(const CameraObject& camera, glm::vec2 film_position, int width, int height) {
+    return GetCameraRayDirection(camera, film_position, width, height);
+}
+
+void CpuRenderer::MissMain(const Ray& ray, RayPayload& payload) {
+    payload.color = SkyRadiance(ray.direction);
+    payload.hit = false;
+    payload.instance_id = kInvalidId;
+}
+
+void CpuRenderer::ClosestHitMain(const ShadingContext& context, const Ray& ray, const HitRecord& hit,
+                                 Sampler& sampler, RayPayload& payload, uint64_t& ray_count) {
+    payload.hit = true;
+    payload.color = TracePath(context, ray, hit, sampler, ray_count);
+}
+
+glm::vec3 CpuRenderer::SkyRadiance(const glm::vec3& direction) {
+    // Sky gradient
+    float t = 0.5f * (glm::normalize(direction).y + 1.0f);
+    return glm::mix(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.5f, 0.7f, 1.0f), t);
+}
+
+std::vector<CpuRenderer::ShadingInstance> CpuRenderer::GetShadingInstances(const Scene& scene) {
+    const std::vector<std::shared_ptr<Entity>>& entities = scene.GetEntities();
+    std::vector<ShadingInstance> instances(entities.size());
+    for (size_t i = 0; i < entities.size(); ++i) {
+        const Entity& entity = *entities[i];
+        if (!entity.IsValid() || !entity.GetMeshAsset()) {
+            continue;
+        }
+        instances[i].mesh = &entity.GetMeshAsset()->GetData();
+        instances[i].normal_to_world = glm::transpose(glm::inverse(glm::mat3(entity.GetTransform())));
+    }
+    return instances;
+}
+
+CpuRenderer::SurfacePoint CpuRenderer::GetSurfacePoint(const ShadingContext& context, const Ray& ray, const HitRecord& hit) {
+    const ShadingInstance& instance = context.instances[hit.instance_id];
+    const MeshData& mesh = *instance.mesh;
+    const uint32_t* triangle = mesh.indices + static_cast<size_t>(hit.primitive_id) * 3;
+    const glm::vec3& p0 = mesh.positions[triangle[0]];
+    const glm::vec3& p1 = mesh.positions[triangle[1]];
+    const glm::vec3& p2 = mesh.positions[triangle[2]];
+
+    SurfacePoint surface;
+    surface.position = ray.origin + ray.direction * hit.t;
+    surface.geometric_normal = glm::normalize(instance.normal_to_world * glm::cross(p1 - p0, p2 - p0));
+    surface.shading_normal = surface.geometric_normal;
+    if (mesh.normals) {
+        glm::vec3 n = mesh.normals[triangle[0]] * (1.0f - hit.u - hit.v) +
+                      mesh.normals[triangle[1]] * hit.u + mesh.normals[triangle[2]] * hit.v;
+        n = instance.normal_to_world * n;
+        float length2 = glm::dot(n, n);
+        if (length2 > 0.0f) {
+            surface.shading_normal = n / std::sqrt(length2);
+        }
+    }
+
+    // Surfaces are two-sided: face both normals toward the incoming ray, and keep the
+    // shading normal on the geometric side so interpolation cannot flip the hemisphere
+    if (glm::dot(surface.geometric_normal, ray.direction) > 0.0f) {
+        surface.geometric_normal = -surface.geometric_normal;
+    }
+    if (glm::dot(surface.shading_normal, surface.geometric_normal) < 0.0f) {
+        surface.shading_normal = -surface.shading_normal;
+    }
+    return surface;
+}
+
+glm::vec3 CpuRenderer::TracePath(const ShadingContext& context, Ray ray, HitRecord hit, Sampler& sampler, uint64_t& ray_count) {
+    glm::vec3 radiance(0.0f);
+    glm::vec3 throughput(1.0f);
+    PathVertex vertex;
+    for (int depth = 0;; ++depth) {
+        ShadeVertex(context, ray, hit, depth, sampler, throughput, vertex);
+        for (int i = 0; i < vertex.shadow_count; ++i) {
+            ++ray_count;
+            if (!context.tlas.Occluded(vertex.shadow_rays[i])) {
+                AddRadiance(radiance, vertex.shadow_radiance[i], depth);
+            }
+        }
+        if (!vertex.continues) {
+            break;
+        }
+
+        ray = vertex.next;
+        hit = HitRecord();
+        ++ray_count;
+        if (!context.tlas.Intersect(ray, hit)) {
+            AddRadiance(radiance, throughput * EscapedRadiance(ray, vertex.bsdf_pdf, vertex.sky_pdf), depth);
+            break;
+        }
+    }
+    return radiance;
+}
+
+void CpuRenderer::ShadeVertex(const ShadingContext& context, const Ray& ray, const HitRecord& hit, int depth,
+                              Sampler& sampler, glm::vec3& throughput, PathVertex& vertex) {
+    vertex.shadow_count = 0;
+    vertex.continues = false;
+
+    const SurfacePoint surface = GetSurfacePoint(context, ray, hit);
+    const ShadingFrame frame(surface.shading_normal);
+    const Bsdf bsdf(context.materials[hit.instance_id]);
+    const glm::vec3 wo = frame.ToLocal(-ray.direction);
+    if (wo.z <= 0.0f) {
+        return;
+    }
+
+    Ray next;
+    next.origin = surface.position;
+    next.t_min = kRayEpsilon;
+    next.t_max = kRayTMax;
+
+    // Next-event estimation of the sun (a delta light, so no MIS)
+    glm::vec3 sun = frame.ToLocal(kSunDirection);
+    if (sun.z > 0.0f && glm::dot(surface.geometric_normal, kSunDirection) > 0.0f) {
+        float pdf;
+        glm::vec3 f = bsdf.Evaluate(wo, sun, pdf);
+        if (pdf > 0.0f) {
+            next.direction = kSunDirection;
+            vertex.shadow_rays[vertex.shadow_count] = next;
+            vertex.shadow_radiance[vertex.shadow_count++] = throughput * f * kSunIrradiance * sun.z;
+        }
+    }
+
+    // Next-event estimation of the sky, sampled cosine-weighted around the normal and
+    // combined with the BSDF samples that escape to the sky (EscapedRadiance)
+    glm::vec3 sky = Bsdf::SampleCosineHemisphere(sampler.Get2D());
+    next.direction = frame.ToWorld(sky);
+    if (glm::dot(surface.geometric_normal, next.direction) > 0.0f) {
+        float bsdf_pdf;
+        glm::vec3 f = bsdf.Evaluate(wo, sky, bsdf_pdf);
+        float light_pdf = sky.z * (1.0f / kPi);
+        if (bsdf_pdf > 0.0f) {
+            vertex.shadow_rays[vertex.shadow_count] = next;
+            vertex.shadow_radiance[vertex.shadow_count++] =
+                throughput * f * SkyRadiance(next.direction) * (sky.z / light_pdf * PowerHeuristic(light_pdf, bsdf_pdf));
+        }
+    }
+
+    // Continue the path with a BSDF sample
+    float lobe_u = sampler.Get1D();
+    glm::vec2 direction_u = sampler.Get2D();
+    float survival_u = sampler.Get1D();
+    Bsdf::Sample sample;
+    if (depth >= kMaxBounces || !bsdf.SampleDirection(wo, lobe_u, direction_u, sample)) {
+        return;
+    }
+    next.direction = frame.ToWorld(sample.wi);
+    if (glm::dot(surface.geometric_normal, next.direction) <= 0.0f) {
+        return;
+    }
+    throughput *= sample.f * (sample.wi.z / sample.pdf);
+
+    // Russian roulette once paths are long enough that most carry little energy
+    if (depth + 1 >= kRussianRouletteDepth) {
+        float survival = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), 0.95f);
+        if (survival_u >= survival) {
+            return;
+        }
+        throughput /= survival;
+    }
+
+    vertex.continues = true;
+    vertex.next = next;
+    vertex.bsdf_pdf = sample.pdf;
+    vertex.sky_pdf = sample.wi.z * (1.0f / kPi);
+}
+
+glm::vec3 CpuRenderer::EscapedRadiance(const Ray& ray, float bsdf_pdf, float sky_pdf) {
+    return SkyRadiance(ray.direction) * PowerHeuristic(bsdf_pdf, sky_pdf);
+}
+
+void CpuRenderer::AddRadiance(glm::vec3& radiance, const glm::vec3& contribution, int depth) {
+    float peak = std::max(contribution.x, std::max(contribution.y, contribution.z));
+    radiance += depth > 0 && peak > kMaxIndirectRadiance ? contribution * (kMaxIndirectRadiance / peak) : contribution;
+}
+
+void CpuRenderer::WriteGuides(const ShadingContext& context, const Ray& ray, const HitRecord& hit, CpuFilm* film, size_t pixel) {
+    if (!hit.IsHit()) {
+        film->GetAlbedoData()[pixel] = glm::vec3(1.0f);
+        film->GetNormalDepthData()[pixel] = glm::vec4(0.0f);
+        return;
+    }
+    SurfacePoint surface = GetSurfacePoint(context, ray, hit);
+    film->GetAlbedoData()[pixel] = context.materials[hit.instance_id].base_color;
+    film->GetNormalDepthData()[pixel] = glm::vec4(surface.shading_normal, hit.t);
+}
+
+Aabb CpuRenderer::GetSceneBounds(const CpuTlas& tlas) {
+    Aabb bounds;
+    for (const CpuInstance& instance : tlas.GetInstances()) {
+        bounds.Expand(instance.world_bounds);
+    }
+    return bounds;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "long_march.h"
+#include "Camera.h"
+#include "CpuFilm.h"
+#include "Material.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Sampler.h"
+#include "Scene.h"
+#include <atomic>
+
+// How CpuRenderer schedules the paths of a frame
+enum class PathScheduling {
+    kPerPixel,   // Each pixel's path is traced to its end before the next pixel starts
+    kWavefront,  // Batches of paths advance together, one bounce at a time, through ray queues
+};
+
+// CPU ray tracing backend
+// Runs the logic of RayGenMain/MissMain/ClosestHitMain from shader.hlsl over
+// the scene's CPU acceleration structures on all cores
+// Closest hits are shaded by a path tracer: the materials' GGX metallic-roughness
+// BSDF (Bsdf.h) on interpolated mesh normals, lit by the sky gradient and a sun, with
+// next-event estimation of both, MIS against BSDF sampling and Russian roulette
+class CpuRenderer {
+public:
+    CpuRenderer() = default;
+
+    // Equivalent of CmdDispatchRays(film width, film height, 1)
+    // Tiles the film marked as converged are skipped (adaptive sampling)
+    void Render(const Scene& scene, const CameraObject& camera, CpuFilm* film) const;
+
+    // Rays traced by all Render calls so far (for throughput reporting)
+    uint64_t GetRayCount() const { return ray_count_.load(); }
+
+    // Sequence the position of each primary ray inside its pixel is drawn from; sample i
+    // of a pixel is the pixel's i-th accumulated sample, so every frame adds new points
+    void SetSamplerType(SamplerType type) { sampler_type_ = type; }
+    SamplerType GetSamplerType() const { return sampler_type_; }
+
+    // The wavefront schedule keeps the rays of kWavefrontTiles tiles in queues per stage
+    // (shade, shadow, extend), sorts shading by material and rays by direction octant and
+    // origin, and traces each queue in that order for coherent memory access
+    void SetPathScheduling(PathScheduling scheduling) { path_scheduling_ = scheduling; }
+    PathScheduling GetPathScheduling() const { return path_scheduling_; }
+
+private:
+    static constexpr int kMaxBounces = 8;
+    static constexpr int kRussianRouletteDepth = 3;  // Bounces before paths may be terminated
+    static constexpr int kWavefrontTiles = 16;       // Tiles whose paths form one wavefront batch
+    static constexpr float kRayTMax = 10000.0f;
+
+    struct TileRect {
+        int x0, y0, x1, y1;
+    };
+
+    // Same fields as RayPayload in the shader
+    struct RayPayload {
+        glm::vec3 color;
+        bool hit;
+        uint32_t instance_id;
+    };
+
+    // Mesh and normal transform of each instance, indexed by instance custom index
+    struct ShadingInstance {
+        const MeshData* mesh = nullptr;
+        glm::mat3 normal_to_world;
+    };
+
+    // Everything shading reads during one Render call
+    struct ShadingContext {
+        const CpuTlas& tlas;
+        const std::vector<Material>& materials;
+        const std::vector<ShadingInstance>& instances;
+        Aabb bounds;  // Of all instances, for sorting rays by origin
+    };
+
+    // Result of shading one path vertex: the shadow rays of next-event estimation with the
+    // radiance each delivers if unoccluded, and the ray continuing the path, if any
+    struct PathVertex {
+        Ray shadow_rays[2];
+        glm::vec3 shadow_radiance[2];
+        int shadow_count = 0;
+        bool continues = false;
+        Ray next;
+        float bsdf_pdf = 0.0f;  // Of next, for MIS if it escapes to the sky
+        float sky_pdf = 0.0f;   // Of next under the sky's light sampling
+    };
+
+    // World-space hit point with normals facing the incoming ray
+    struct SurfacePoint {
+        glm::vec3 position;
+        glm::vec3 geometric_normal;
+        glm::vec3 shading_normal;
+    };
+
+    // Normalized primary ray direction through a point of the film (pixel (x, y) covers
+    // [x, x + 1) x [y, y + 1)), as computed in RayGenMain
+    static glm::vec3 RayGenDirection(const CameraObject& camera, glm::vec2 film_position, int width, int height);
+    static void MissMain(const Ray& ray, RayPayload& payload);
+    static void ClosestHitMain(const ShadingContext& context, const Ray& ray, const HitRecord& hit,
+                               Sampler& sampler, RayPayload& payload, uint64_t& ray_count);
+
+    static glm::vec3 SkyRadiance(const glm::vec3& direction);
+    static std::vector<ShadingInstance> GetShadingInstances(const Scene& scene);
+    static SurfacePoint GetSurfacePoint(const ShadingContext& context, const Ray& ray, const HitRecord& hit);
+
+    static Aabb GetSceneBounds(const CpuTlas& tlas);
+
+    // Albedo, normal and depth of a primary ray's hit (or miss) for the denoiser
+    static void WriteGuides(const ShadingContext& context, const Ray& ray, const HitRecord& hit, CpuFilm* film, size_t pixel);
+    static TileRect GetTileRect(uint32_t tile, int tiles_x, int width, int height);
+
+    // Jittered primary rays of a block of pixels, appending their samplers
+    void GeneratePrimaryPacket(const CameraObject& camera, const CpuFilm& film, int x0, int y0,
+                               int block_width, int block_height, RayPacket& packet,
+                               std::vector<Sampler>& samplers) const;
+
+    // Radiance arriving along ray, which hit the scene at hit; counts the rays it traces
+    static glm::vec3 TracePath(const ShadingContext& context, Ray ray, HitRecord hit, Sampler& sampler, uint64_t& ray_count);
+
+    // Shade the vertex at hit: queue next-event estimation and sample the next ray,
+    // updating throughput (shared by both schedules)
+    static void ShadeVertex(const ShadingContext& context, const Ray& ray, const HitRecord& hit, int depth,
+                            Sampler& sampler, glm::vec3& throughput, PathVertex& vertex);
+
+    // Sky reached by a BSDF-sampled ray, MIS-weighted against sky sampling
+    static glm::vec3 EscapedRadiance(const Ray& ray, float bsdf_pdf, float sky_pdf);
+
+    // Add light found at a vertex of the given depth (clamped after the first bounce)
+    static void AddRadiance(glm::vec3& radiance, const glm::vec3& contribution, int depth);
+
+    // Path trace the pixels of tiles with the wavefront schedule (CpuRendererWavefront.cpp),
+    // writing their color and entity ID
+    void RenderWavefront(const ShadingContext& context, const CameraObject& camera, CpuFilm* film,
+                         const uint32_t* tiles, size_t tile_count, int tiles_x, uint64_t& ray_count) const;
+
+    // Tile indices (y * tiles_x + x) in Morton order, so the contiguous runs of tiles
+    // each thread renders and steals stay compact on screen
+    static std::vector<uint32_t> MortonTileOrder(int tiles_x, int tiles_y);
+
+    static constexpr int kTileSize = CpuFilm::kTileSize;   // Same tiles as the film's convergence mask
+    static constexpr int kPacketSize = 8;   // Primary rays are traced in kPacketSize x kPacketSize packets
+
+    SamplerType sampler_type_ = SamplerType::kSobol;
+    PathScheduling path_scheduling_ = PathScheduling::kPerPixel;
+    mutable std::atomic<uint64_t> ray_count_{ 0 };
+};
@@ -0,0 +1,249 @@
+#include "CpuRenderer.h"
+
+#include <algorithm>
+
+// Wavefront schedule of CpuRenderer: instead of following one path to its end, all paths
+// of a batch of tiles advance one bounce per wave through three stages
+//   shade:  vertices sorted by material, each producing shadow rays and an extension ray
+//   shadow: shadow rays sorted by direction octant and origin, tested for occlusion
+//   extend: extension rays sorted the same way, intersected to give the next vertices
+// Rays are kept in structure-of-arrays queues, and sorting lets consecutive traversals
+// touch the same BVH nodes and triangles while they are still in cache
+
+namespace {
+
+// Rays waiting for one stage, with the path each belongs to
+struct RayQueue {
+    std::vector<float> origin_x, origin_y, origin_z;
+    std::vector<float> direction_x, direction_y, direction_z;
+    std::vector<float> t_min, t_max;
+    std::vector<uint32_t> path;
+    std::vector<glm::vec3> radiance;  // Shadow rays: light delivered if unoccluded
+
+    size_t Size() const { return path.size(); }
+
+    void Clear() {
+        for (std::vector<float>* v : { &origin_x, &origin_y, &origin_z, &direction_x, &direction_y, &direction_z, &t_min, &t_max }) {
+            v->clear();
+        }
+        path.clear();
+        radiance.clear();
+    }
+
+    void Push(const Ray& ray, uint32_t path_index) {
+        origin_x.push_back(ray.origin.x);
+        origin_y.push_back(ray.origin.y);
+        origin_z.push_back(ray.origin.z);
+        direction_x.push_back(ray.direction.x);
+        direction_y.push_back(ray.direction.y);
+        direction_z.push_back(ray.direction.z);
+        t_min.push_back(ray.t_min);
+        t_max.push_back(ray.t_max);
+        path.push_back(path_index);
+    }
+
+    Ray GetRay(size_t i) const {
+        Ray ray;
+        ray.origin = glm::vec3(origin_x[i], origin_y[i], origin_z[i]);
+        ray.direction = glm::vec3(direction_x[i], direction_y[i], direction_z[i]);
+        ray.t_min = t_min[i];
+        ray.t_max = t_max[i];
+        return ray;
+    }
+};
+
+// Per-thread storage of one batch, kept between batches and frames to avoid reallocation
+struct WavefrontState {
+    // Paths, one per pixel of the batch (index = order of their primary rays)
+    std::vector<size_t> pixel;
+    std::vector<Sampler> samplers;
+    std::vector<glm::vec3> throughput;
+    std::vector<glm::vec3> radiance;
+    std::vector<Ray> rays;
+    std::vector<HitRecord> hits;
+    std::vector<float> bsdf_pdf;
+    std::vector<float> sky_pdf;
+    std::vector<uint32_t> active;  // Paths with a vertex to shade this wave
+    std::vector<uint32_t> next_active;
+
+    RayQueue shadow_queue;
+    RayQueue extend_queue;
+    std::vector<uint64_t> sort_items;  // key << 32 | index
+    std::vector<uint64_t> sort_scratch;
+
+    RayPacket packet;
+    PacketHits packet_hits;
+};
+
+// Spread the low 9 bits of v to every third bit
+uint32_t SpreadBits9(uint32_t v) {
+    v &= 0x1FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Direction octant in the top bits, then the Morton code of the origin in the scene
+// bounds at 9 bits per axis, so rays sorted by key leave nearby points in similar directions
+uint32_t RaySortKey(const RayQueue& queue, size_t i, const glm::vec3& lower, const glm::vec3& scale) {
+    uint32_t octant = (queue.direction_x[i] < 0.0f ? 1u : 0u) | (queue.direction_y[i] < 0.0f ? 2u : 0u) |
+                      (queue.direction_z[i] < 0.0f ? 4u : 0u);
+    glm::vec3 cell = (glm::vec3(queue.origin_x[i], queue.origin_y[i], queue.origin_z[i]) - lower) * scale;
+    cell = glm::min(glm::max(cell, glm::vec3(0.0f)), glm::vec3(511.0f));
+    uint32_t morton = SpreadBits9(static_cast<uint32_t>(cell.x)) | (SpreadBits9(static_cast<uint32_t>(cell.y)) << 1) |
+                      (SpreadBits9(static_cast<uint32_t>(cell.z)) << 2);
+    return (octant << 27) | morton;
+}
+
+// Stable LSD radix sort of items by their upper 32 bits, skipping bytes all keys share
+void RadixSortByKey(std::vector<uint64_t>& items, std::vector<uint64_t>& scratch) {
+    scratch.resize(items.size());
+    for (int shift = 32; shift < 64; shift += 8) {
+        size_t offsets[256] = {};
+        for (uint64_t item : items) {
+            ++offsets[(item >> shift) & 0xFF];
+        }
+        if (offsets[(items.front() >> shift) & 0xFF] == items.size()) {
+            continue;
+        }
+        size_t sum = 0;
+        for (size_t& offset : offsets) {
+            size_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (uint64_t item : items) {
+            scratch[offsets[(item >> shift) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
+
+// Order in which to trace a queue's rays, as sorted items
+void SortQueue(const RayQueue& queue, const Aabb& bounds, WavefrontState& state) {
+    state.sort_items.clear();
+    if (queue.Size() == 0) {
+        return;
+    }
+    glm::vec3 scale = 512.0f / glm::max(bounds.Extent(), glm::vec3(1e-20f));
+    for (size_t i = 0; i < queue.Size(); ++i) {
+        state.sort_items.push_back((static_cast<uint64_t>(RaySortKey(queue, i, bounds.lower, scale)) << 32) | i);
+    }
+    RadixSortByKey(state.sort_items, state.sort_scratch);
+}
+
+}  // namespace
+
+void CpuRenderer::RenderWavefront(const ShadingContext& context, const CameraObject& camera, CpuFilm* film,
+                                  const uint32_t* tiles, size_t tile_count, int tiles_x, uint64_t& ray_count) const {
+    thread_local WavefrontState state;
+    const int width = film->GetWidth();
+    const int height = film->GetHeight();
+    glm::vec4* output = film->GetColorData();
+    int32_t* entity_id_output = film->GetEntityIdData();
+
+    // Generate: primary rays of each block are still traced as one packet; misses are
+    // final, hits become the first vertices of the batch's paths
+    state.pixel.clear();
+    state.samplers.clear();
+    state.rays.clear();
+    state.hits.clear();
+    state.active.clear();
+    for (size_t t = 0; t < tile_count; ++t) {
+        TileRect rect = GetTileRect(tiles[t], tiles_x, width, height);
+        for (int y0 = rect.y0; y0 < rect.y1; y0 += kPacketSize) {
+            for (int x0 = rect.x0; x0 < rect.x1; x0 += kPacketSize) {
+                GeneratePrimaryPacket(camera, *film, x0, y0, std::min(kPacketSize, rect.x1 - x0),
+                                      std::min(kPacketSize, rect.y1 - y0), state.packet, state.samplers);
+                state.packet_hits.Reset(state.packet.GetRayCount(), kRayTMax);
+                context.tlas.IntersectPacket(state.packet, state.packet_hits);
+                ray_count += state.packet.GetRayCount();
+
+                for (int index = 0; index < state.packet.GetRayCount(); ++index) {
+                    size_t pixel = static_cast<size_t>(y0 + index / state.packet.width) * width + x0 + index % state.packet.width;
+                    uint32_t path = static_cast<uint32_t>(state.pixel.size());
+                    HitRecord hit = state.packet_hits.GetHit(index);
+                    state.pixel.push_back(pixel);
+                    state.rays.push_back(state.packet.GetRay(index, kRayTMax));
+                    state.hits.push_back(hit);
+                    WriteGuides(context, state.rays.back(), hit, film, pixel);
+                    if (hit.IsHit()) {
+                        state.active.push_back(path);
+                        entity_id_output[pixel] = static_cast<int32_t>(hit.instance_id);
+                    } else {
+                        RayPayload payload;
+                        MissMain(state.rays.back(), payload);
+                        output[pixel] = glm::vec4(payload.color, 1.0f);
+                        entity_id_output[pixel] = -1;
+                    }
+                }
+            }
+        }
+    }
+    const size_t path_count = state.pixel.size();
+    state.throughput.assign(path_count, glm::vec3(1.0f));
+    state.radiance.assign(path_count, glm::vec3(0.0f));
+    state.bsdf_pdf.assign(path_count, 0.0f);
+    state.sky_pdf.assign(path_count, 0.0f);
+
+    PathVertex vertex;
+    for (int depth = 0; !state.active.empty(); ++depth) {
+        // Shade: vertices grouped by material (materials are indexed by instance)
+        state.sort_items.clear();
+        for (uint32_t path : state.active) {
+            state.sort_items.push_back((static_cast<uint64_t>(state.hits[path].instance_id) << 32) | path);
+        }
+        RadixSortByKey(state.sort_items, state.sort_scratch);
+        state.shadow_queue.Clear();
+        state.extend_queue.Clear();
+        for (uint64_t item : state.sort_items) {
+            uint32_t path = static_cast<uint32_t>(item);
+            ShadeVertex(context, state.rays[path], state.hits[path], depth, state.samplers[path], state.throughput[path], vertex);
+            for (int i = 0; i < vertex.shadow_count; ++i) {
+                state.shadow_queue.Push(vertex.shadow_rays[i], path);
+                state.shadow_queue.radiance.push_back(vertex.shadow_radiance[i]);
+            }
+            if (vertex.continues) {
+                state.extend_queue.Push(vertex.next, path);
+                state.bsdf_pdf[path] = vertex.bsdf_pdf;
+                state.sky_pdf[path] = vertex.sky_pdf;
+            }
+        }
+
+        // Shadow: next-event estimation
+        SortQueue(state.shadow_queue, context.bounds, state);
+        for (uint64_t item : state.sort_items) {
+            size_t i = static_cast<uint32_t>(item);
+            if (!context.tlas.Occluded(state.shadow_queue.GetRay(i))) {
+                AddRadiance(state.radiance[state.shadow_queue.path[i]], state.shadow_queue.radiance[i], depth);
+            }
+        }
+        ray_count += state.shadow_queue.Size();
+
+        // Extend: find the next vertices; rays escaping to the sky end their paths
+        SortQueue(state.extend_queue, context.bounds, state);
+        state.next_active.clear();
+        for (uint64_t item : state.sort_items) {
+            size_t i = static_cast<uint32_t>(item);
+            uint32_t path = state.extend_queue.path[i];
+            state.rays[path] = state.extend_queue.GetRay(i);
+            state.hits[path] = HitRecord();
+            if (context.tlas.Intersect(state.rays[path], state.hits[path])) {
+                state.next_active.push_back(path);
+            } else {
+                AddRadiance(state.radiance[path],
+                            state.throughput[path] * EscapedRadiance(state.rays[path], state.bsdf_pdf[path], state.sky_pdf[path]), depth);
+            }
+        }
+        ray_count += state.extend_queue.Size();
+        state.active.swap(state.next_active);
+    }
+
+    for (size_t path = 0; path < path_count; ++path) {
+        if (entity_id_output[state.pixel[path]] >= 0) {
+            output[state.pixel[path]] = glm::vec4(state.radiance[path], 1.0f);
+        }
+    }
+}
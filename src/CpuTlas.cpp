@@ -0,0 +1,332 @@
+#include "CpuTlas.h"
+
+#include <algorithm>
+#include <limits>
+
+CpuInstance CpuTlas::MakeInstance(const Bvh* blas, const glm::mat4x3& transform, uint32_t custom_index) {
+    CpuInstance instance;
+    instance.blas = blas;
+    instance.object_to_world = transform;
+    instance.world_to_object = glm::mat4x3(glm::inverse(glm::mat4(transform)));
+    instance.custom_index = custom_index;
+
+    // World bounds from the eight transformed corners of the object bounds
+    const Aabb& local = blas->GetBounds();
+    instance.world_bounds = Aabb();
+    if (local.IsEmpty()) {
+        return instance;
+    }
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 p(
+            (corner & 1) ? local.upper.x : local.lower.x,
+            (corner & 2) ? local.upper.y : local.lower.y,
+            (corner & 4) ? local.upper.z : local.lower.z);
+        instance.world_bounds.Expand(TransformPoint(transform, p));
+    }
+    return instance;
+}
+
+void CpuTlas::Build(std::vector<CpuInstance> instances) {
+    // Instances of empty meshes can never be hit
+    instances.erase(std::remove_if(instances.begin(), instances.end(),
+        [](const CpuInstance& instance) { return instance.world_bounds.IsEmpty(); }), instances.end());
+
+    // Same binned SAH builder as the BLAS, over instance world bounds; instances are then
+    // stored in leaf order so each leaf covers a contiguous range of them
+    std::vector<uint32_t> order;
+    Bvh::BuildHierarchy(instances.size(), [&](size_t i) { return instances[i].world_bounds; },
+                        kMaxLeafSize, nodes_, order);
+    instances_.clear();
+    instances_.reserve(instances.size());
+    for (uint32_t index : order) {
+        instances_.push_back(instances[index]);
+    }
+
+    parents_.assign(nodes_.size(), 0);
+    leaf_of_slot_.assign(instances_.size(), 0);
+    area_sum_ = 0.0;
+    for (uint32_t node_index = 0; node_index < nodes_.size(); ++node_index) {
+        const BvhNode& node = nodes_[node_index];
+        area_sum_ += node.bounds.HalfArea();
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                leaf_of_slot_[i] = node_index;
+            }
+        } else {
+            parents_[node.offset] = node_index;
+            parents_[node.offset + 1] = node_index;
+        }
+    }
+    slot_of_index_.clear();
+    for (uint32_t slot = 0; slot < instances_.size(); ++slot) {
+        uint32_t custom_index = instances_[slot].custom_index;
+        if (custom_index >= slot_of_index_.size()) {
+            slot_of_index_.resize(custom_index + 1, kInvalidSlot);
+        }
+        slot_of_index_[custom_index] = slot;
+    }
+    pending_leaves_.clear();
+    built_sah_cost_ = GetSahCost();
+}
+
+bool CpuTlas::SetInstanceTransform(uint32_t custom_index, const glm::mat4x3& transform) {
+    if (custom_index >= slot_of_index_.size() || slot_of_index_[custom_index] == kInvalidSlot) {
+        return false;
+    }
+    uint32_t slot = slot_of_index_[custom_index];
+    instances_[slot] = MakeInstance(instances_[slot].blas, transform, custom_index);
+    pending_leaves_.push_back(leaf_of_slot_[slot]);
+    return true;
+}
+
+bool CpuTlas::Refit() {
+    if (pending_leaves_.empty()) {
+        return false;
+    }
+    auto set_bounds = [&](uint32_t node_index, const Aabb& bounds) {
+        Aabb& current = nodes_[node_index].bounds;
+        if (current.lower == bounds.lower && current.upper == bounds.upper) {
+            return false;
+        }
+        area_sum_ += static_cast<double>(bounds.HalfArea()) - current.HalfArea();
+        current = bounds;
+        return true;
+    };
+
+    // Walk up from each moved leaf, stopping as soon as a node's bounds come out unchanged
+    for (uint32_t leaf : pending_leaves_) {
+        const BvhNode& node = nodes_[leaf];
+        Aabb bounds;
+        for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+            bounds.Expand(instances_[i].world_bounds);
+        }
+        uint32_t node_index = leaf;
+        bool changed = set_bounds(node_index, bounds);
+        while (changed && node_index != 0) {
+            node_index = parents_[node_index];
+            const BvhNode& parent = nodes_[node_index];
+            Aabb merged = nodes_[parent.offset].bounds;
+            merged.Expand(nodes_[parent.offset + 1].bounds);
+            changed = set_bounds(node_index, merged);
+        }
+    }
+    pending_leaves_.clear();
+
+    if (GetSahCost() <= built_sah_cost_ * kRebuildThreshold) {
+        return false;
+    }
+    Build(std::move(instances_));
+    return true;
+}
+
+float CpuTlas::GetSahCost() const {
+    if (nodes_.empty()) {
+        return 0.0f;
+    }
+    return static_cast<float>(area_sum_ / std::max(nodes_[0].bounds.HalfArea(), 1e-20f));
+}
+
+bool CpuTlas::Intersect(const Ray& ray, HitRecord& hit) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+    const float infinity = std::numeric_limits<float>::infinity();
+    glm::vec3 inv_direction = SafeInverse(ray.direction);
+    auto box_distance = [&](const BvhNode& node) {
+        return IntersectAabb(node.bounds, ray.origin, inv_direction, ray.t_min, std::min(ray.t_max, hit.t));
+    };
+
+    StackEntry stack[kStackSize];
+    int stack_size = 0;
+    if (box_distance(nodes_[0]) != infinity) {
+        stack[stack_size++] = StackEntry{ 0, ray.t_min };
+    }
+    bool found = false;
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.t > hit.t) {
+            continue;
+        }
+        const BvhNode* node = &nodes_[entry.node];
+
+        // Descend to the nearer child, pushing the farther one
+        while (!node->IsLeaf()) {
+            float t_left = box_distance(nodes_[node->offset]);
+            float t_right = box_distance(nodes_[node->offset + 1]);
+            uint32_t near_index = node->offset;
+            uint32_t far_index = node->offset + 1;
+            if (t_right < t_left) {
+                std::swap(t_left, t_right);
+                std::swap(near_index, far_index);
+            }
+            if (t_left == infinity) {
+                node = nullptr;
+                break;
+            }
+            if (t_right != infinity) {
+                stack[stack_size++] = StackEntry{ far_index, t_right };
+            }
+            node = &nodes_[near_index];
+        }
+        if (!node) {
+            continue;
+        }
+        for (uint32_t i = node->offset; i < node->offset + node->count; ++i) {
+            if (IntersectInstance(instances_[i], ray, hit)) {
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+bool CpuTlas::Occluded(const Ray& ray) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+    const float infinity = std::numeric_limits<float>::infinity();
+    glm::vec3 inv_direction = SafeInverse(ray.direction);
+    uint32_t stack[kStackSize];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const BvhNode& node = nodes_[stack[--stack_size]];
+        if (IntersectAabb(node.bounds, ray.origin, inv_direction, ray.t_min, ray.t_max) == infinity) {
+            continue;
+        }
+        if (!node.IsLeaf()) {
+            stack[stack_size++] = node.offset + 1;
+            stack[stack_size++] = node.offset;
+            continue;
+        }
+        for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+            if (OccludedInstance(instances_[i], ray)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CpuTlas::IntersectPacket(const RayPacket& packet, PacketHits& hits) const {
+    const int count = packet.GetRayCount();
+    RayFrustum frustum;
+    if (!RayFrustum::Build(packet, frustum)) {
+        for (int i = 0; i < count; ++i) {
+            HitRecord hit;
+            if (Intersect(packet.GetRay(i, hits.t[i]), hit)) {
+                hits.t[i] = hit.t;
+                hits.u[i] = hit.u;
+                hits.v[i] = hit.v;
+                hits.primitive_id[i] = hit.primitive_id;
+                hits.instance_id[i] = hit.instance_id;
+            }
+        }
+        return;
+    }
+    if (nodes_.empty()) {
+        return;
+    }
+
+    // Nodes are culled against the frustum and the farthest pending hit, and visited
+    // nearest first by squared distance from the shared origin
+    float max_t = *std::max_element(hits.t, hits.t + count);
+    auto reach2 = [&]() {
+        float reach = max_t * frustum.max_direction_length;
+        return reach * reach;
+    };
+    auto distance2 = [&](const Aabb& box) {
+        glm::vec3 offset = glm::max(glm::max(box.lower - packet.origin, packet.origin - box.upper), glm::vec3(0.0f));
+        return glm::dot(offset, offset);
+    };
+
+    StackEntry stack[kStackSize];
+    int stack_size = 0;
+    if (frustum.Overlaps(nodes_[0].bounds, packet.origin, max_t)) {
+        stack[stack_size++] = StackEntry{ 0, 0.0f };
+    }
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.t > reach2()) {
+            continue;
+        }
+        const BvhNode* node = &nodes_[entry.node];
+        while (node && !node->IsLeaf()) {
+            const BvhNode& left = nodes_[node->offset];
+            const BvhNode& right = nodes_[node->offset + 1];
+            bool hit_left = frustum.Overlaps(left.bounds, packet.origin, max_t);
+            bool hit_right = frustum.Overlaps(right.bounds, packet.origin, max_t);
+            if (hit_left && hit_right) {
+                float d_left = distance2(left.bounds);
+                float d_right = distance2(right.bounds);
+                if (d_left <= d_right) {
+                    stack[stack_size++] = StackEntry{ node->offset + 1, d_right };
+                    node = &left;
+                } else {
+                    stack[stack_size++] = StackEntry{ node->offset, d_left };
+                    node = &right;
+                }
+            } else if (hit_left) {
+                node = &left;
+            } else if (hit_right) {
+                node = &right;
+            } else {
+                node = nullptr;
+            }
+        }
+        if (!node) {
+            continue;
+        }
+        for (uint32_t i = node->offset; i < node->offset + node->count; ++i) {
+            IntersectPacketInstance(instances_[i], packet, hits);
+        }
+        max_t = *std::max_element(hits.t, hits.t + count);
+    }
+}
+
+bool CpuTlas::IntersectInstance(const CpuInstance& instance, const Ray& ray, HitRecord& hit) {
+    // Object-space ray; the direction is not renormalized so t stays in world units
+    Ray object_ray;
+    object_ray.origin = TransformPoint(instance.world_to_object, ray.origin);
+    object_ray.direction = TransformVector(instance.world_to_object, ray.direction);
+    object_ray.t_min = ray.t_min;
+    object_ray.t_max = std::min(ray.t_max, hit.t);
+    if (!instance.blas->Intersect(object_ray, hit)) {
+        return false;
+    }
+    hit.instance_id = instance.custom_index;
+    return true;
+}
+
+bool CpuTlas::OccludedInstance(const CpuInstance& instance, const Ray& ray) {
+    Ray object_ray;
+    object_ray.origin = TransformPoint(instance.world_to_object, ray.origin);
+    object_ray.direction = TransformVector(instance.world_to_object, ray.direction);
+    object_ray.t_min = ray.t_min;
+    object_ray.t_max = ray.t_max;
+    return instance.blas->Occluded(object_ray);
+}
+
+void CpuTlas::IntersectPacketInstance(const CpuInstance& instance, const RayPacket& packet, PacketHits& hits) {
+    RayPacket object_packet = packet.Transformed(instance.world_to_object);
+    RayFrustum object_frustum;
+    if (RayFrustum::Build(object_packet, object_frustum)) {
+        instance.blas->IntersectPacket(object_packet, object_frustum, hits, instance.custom_index);
+    } else {
+        IntersectPacketRays(instance, object_packet, hits);
+    }
+}
+
+void CpuTlas::IntersectPacketRays(const CpuInstance& instance, const RayPacket& object_packet, PacketHits& hits) {
+    const int count = object_packet.GetRayCount();
+    for (int i = 0; i < count; ++i) {
+        HitRecord hit;
+        if (instance.blas->Intersect(object_packet.GetRay(i, hits.t[i]), hit)) {
+            hits.t[i] = hit.t;
+            hits.u[i] = hit.u;
+            hits.v[i] = hit.v;
+            hits.primitive_id[i] = hit.primitive_id;
+            hits.instance_id[i] = instance.custom_index;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "long_march.h"
+#include "Bvh.h"
+#include "RayPacket.h"
+#include <vector>
+
+// One placement of a BLAS in the CPU top-level structure (mirrors RayTracingInstance)
+struct CpuInstance {
+    const Bvh* blas;
+    glm::mat4x3 object_to_world;
+    glm::mat4x3 world_to_object;
+    Aabb world_bounds;
+    uint32_t custom_index;  // instanceCustomIndex, used for material lookup
+};
+
+// CPU top-level acceleration structure over entity instances
+// A binary BVH over the instances' world bounds; rays reaching a leaf are transformed
+// into object space and traverse the instance's BLAS, which instances of the same
+// mesh share, so memory grows with unique meshes rather than with placements
+// Moving a few instances refits the node bounds above them instead of rebuilding;
+// once refitting has inflated the tree's SAH cost past kRebuildThreshold times its
+// cost after the last build, the tree is rebuilt
+class CpuTlas {
+public:
+    static constexpr uint32_t kMaxLeafSize = 1;
+    static constexpr float kRebuildThreshold = 1.5f;
+
+    CpuTlas() = default;
+
+    // Create an instance from a BLAS and its affine transform
+    static CpuInstance MakeInstance(const Bvh* blas, const glm::mat4x3& transform, uint32_t custom_index);
+
+    void Build(std::vector<CpuInstance> instances);
+
+    // Move the instance with this custom index; node bounds are updated by Refit()
+    // Returns false if there is no such instance
+    bool SetInstanceTransform(uint32_t custom_index, const glm::mat4x3& transform);
+
+    // Refit the nodes above instances moved since the last Build/Refit, in O(moved * depth)
+    // Rebuilds instead when the tree has degraded too far; returns true in that case
+    bool Refit();
+
+    // Expected traversal cost relative to the root (sum of node areas over root area)
+    float GetSahCost() const;
+
+    // Closest hit over all instances; fills hit.instance_id with the custom index
+    bool Intersect(const Ray& ray, HitRecord& hit) const;
+
+    // Any hit over all instances
+    bool Occluded(const Ray& ray) const;
+
+    // Closest hits for a shared-origin packet (hits.t holds each ray's t_max on entry)
+    // Coherent packets are traced together against each BLAS; packets too divergent to
+    // bound with a frustum fall back to tracing their rays one by one
+    void IntersectPacket(const RayPacket& packet, PacketHits& hits) const;
+
+    // Instances in leaf order (not the order passed to Build)
+    const std::vector<CpuInstance>& GetInstances() const { return instances_; }
+    size_t GetInstanceCount() const { return instances_.size(); }
+    size_t GetNodeCount() const { return nodes_.size(); }
+
+private:
+    static constexpr int kStackSize = Bvh::kMaxDepth + 1;
+    static constexpr uint32_t kInvalidSlot = 0xFFFFFFFFu;
+
+    struct StackEntry {
+        uint32_t node;
+        float t;  // Entry distance, to skip nodes beyond a hit found since the push
+    };
+
+    static bool IntersectInstance(const CpuInstance& instance, const Ray& ray, HitRecord& hit);
+    static bool OccludedInstance(const CpuInstance& instance, const Ray& ray);
+    static void IntersectPacketInstance(const CpuInstance& instance, const RayPacket& packet, PacketHits& hits);
+    static void IntersectPacketRays(const CpuInstance& instance, const RayPacket& object_packet, PacketHits& hits);
+
+    std::vector<CpuInstance> instances_;
+    std::vector<BvhNode> nodes_;
+
+    // Refit bookkeeping
+    std::vector<uint32_t> parents_;         // Parent of each node (root: itself)
+    std::vector<uint32_t> leaf_of_slot_;    // Leaf node holding each instance
+    std::vector<uint32_t> slot_of_index_;   // Instance slot by custom index
+    std::vector<uint32_t> pending_leaves_;  // Leaves whose instances moved
+    double area_sum_ = 0.0;
+    float built_sah_cost_ = 0.0f;
+};
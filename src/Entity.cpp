@@ -11,26 +11,14 @@ Entity::Entity(const std::string& obj_file_path,
 }
 
 Entity::~Entity() {
-    blas_.reset();
-    index_buffer_.reset();
-    vertex_buffer_.reset();
+    mesh_.reset();
 }
 
 bool Entity::LoadMesh(const std::string& obj_file_path) {
-    // Try to load the OBJ file
-    std::string full_path = grassland::FindAssetFile(obj_file_path);
-    
-    if (mesh_.LoadObjFile(full_path) != 0) {
-        grassland::LogError("Failed to load mesh from: {}", obj_file_path);
-        mesh_loaded_ = false;
-        return false;
-    }
-
-    grassland::LogInfo("Successfully loaded mesh: {} ({} vertices, {} indices)", 
-                       obj_file_path, mesh_.NumVertices(), mesh_.NumIndices());
-    
-    mesh_loaded_ = true;
-    return true;
+    // Parsed once per file; entities loading the same OBJ share the result
+    mesh_ = MeshRegistry::Global().Load(obj_file_path);
+    mesh_loaded_ = mesh_ != nullptr;
+    return mesh_loaded_;
 }
 
 void Entity::BuildBLAS(grassland::graphics::Core* core) {
@@ -38,28 +26,13 @@ void Entity::BuildBLAS(grassland::graphics::Core* core) {
         grassland::LogError("Cannot build BLAS: mesh not loaded");
         return;
     }
-
-    // Create vertex buffer
-    size_t vertex_buffer_size = mesh_.NumVertices() * sizeof(glm::vec3);
-    core->CreateBuffer(vertex_buffer_size, 
-                      grassland::graphics::BUFFER_TYPE_DYNAMIC, 
-                      &vertex_buffer_);
-    vertex_buffer_->UploadData(mesh_.Positions(), vertex_buffer_size);
-
-    // Create index buffer
-    size_t index_buffer_size = mesh_.NumIndices() * sizeof(uint32_t);
-    core->CreateBuffer(index_buffer_size, 
-                      grassland::graphics::BUFFER_TYPE_DYNAMIC, 
-                      &index_buffer_);
-    index_buffer_->UploadData(mesh_.Indices(), index_buffer_size);
-
-    // Build BLAS
-    core->CreateBottomLevelAccelerationStructure(
-        vertex_buffer_.get(), 
-        index_buffer_.get(), 
-        sizeof(glm::vec3), 
-        &blas_);
-
-    grassland::LogInfo("Built BLAS for entity");
+    mesh_->BuildBLAS(core);
 }
 
+void Entity::BuildCpuBLAS() {
+    if (!mesh_loaded_) {
+        grassland::LogError("Cannot build CPU BLAS: mesh not loaded");
+        return;
+    }
+    mesh_->BuildCpuBLAS();
+}
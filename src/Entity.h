@@ -1,8 +1,11 @@
 #pragma once
 #include "long_march.h"
 #include "Material.h"
+#include "MeshRegistry.h"
 
 // Entity represents a mesh instance with a material and transform
+// The mesh, its buffers and its BLASes come from the MeshRegistry and are shared
+// with every other entity using the same OBJ file
 class Entity {
 public:
     Entity(const std::string& obj_file_path, 
@@ -11,35 +14,45 @@ public:
 
     ~Entity();
 
-    // Load mesh from OBJ file
+    // Load mesh from OBJ file (through the global MeshRegistry)
     bool LoadMesh(const std::string& obj_file_path);
 
     // Getters
-    grassland::graphics::Buffer* GetVertexBuffer() const { return vertex_buffer_.get(); }
-    grassland::graphics::Buffer* GetIndexBuffer() const { return index_buffer_.get(); }
+    grassland::graphics::Buffer* GetVertexBuffer() const { return mesh_ ? mesh_->GetVertexBuffer() : nullptr; }
+    grassland::graphics::Buffer* GetIndexBuffer() const { return mesh_ ? mesh_->GetIndexBuffer() : nullptr; }
     const Material& GetMaterial() const { return material_; }
     const glm::mat4& GetTransform() const { return transform_; }
-    grassland::graphics::AccelerationStructure* GetBLAS() const { return blas_.get(); }
-
-    // Setters
-    void SetMaterial(const Material& material) { material_ = material; }
-    void SetTransform(const glm::mat4& transform) { transform_ = transform; }
-
-    // Create BLAS for this entity's mesh
+    grassland::graphics::AccelerationStructure* GetBLAS() const { return mesh_ ? mesh_->GetBLAS() : nullptr; }
+    const Bvh* GetCpuBLAS() const { return mesh_ ? mesh_->GetCpuBLAS() : nullptr; }
+    size_t GetVertexCount() const { return mesh_ ? mesh_->NumVertices() : 0; }
+    size_t GetIndexCount() const { return mesh_ ? mesh_->NumIndices() : 0; }
+    const std::shared_ptr<MeshAsset>& GetMeshAsset() const { return mesh_; }
+
+    // Setters; changes are flagged so Scene::UpdateInstances only touches what changed
+    void SetMaterial(const Material& material) { material_ = material; material_dirty_ = true; }
+    void SetTransform(const glm::mat4& transform) { transform_ = transform; transform_dirty_ = true; }
+
+    // Dirty flags, cleared by the scene once it has applied the changes
+    bool IsTransformDirty() const { return transform_dirty_; }
+    bool IsMaterialDirty() const { return material_dirty_; }
+    void ClearDirty() { transform_dirty_ = false; material_dirty_ = false; }
+
+    // Create BLAS for this entity's mesh (once per shared mesh)
     void BuildBLAS(grassland::graphics::Core* core);
 
+    // Create the CPU BVH for this entity's mesh (CPU ray tracing backend, once per shared mesh)
+    void BuildCpuBLAS();
+
     // Check if mesh is loaded
     bool IsValid() const { return mesh_loaded_; }
 
 private:
-    grassland::Mesh<float> mesh_;
+    std::shared_ptr<MeshAsset> mesh_;
     Material material_;
     glm::mat4 transform_;
 
-    std::unique_ptr<grassland::graphics::Buffer> vertex_buffer_;
-    std::unique_ptr<grassland::graphics::Buffer> index_buffer_;
-    std::unique_ptr<grassland::graphics::AccelerationStructure> blas_;
-
     bool mesh_loaded_;
+    bool transform_dirty_ = false;
+    bool material_dirty_ = false;
 };
 
@@ -0,0 +1,250 @@
+#include "ExrWriter.h"
+#include "StbZlib.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace {
+
+constexpr uint8_t kMagic[4] = { 0x76, 0x2F, 0x31, 0x01 };
+constexpr uint32_t kVersion = 2;
+constexpr uint32_t kTiledFlag = 0x200;
+
+// Values of the header's enumerations
+constexpr int32_t kExrHalf = 1;
+constexpr int32_t kExrFloat = 2;
+constexpr uint8_t kNoCompression = 0;
+constexpr uint8_t kZipCompression = 3;
+constexpr uint8_t kIncreasingY = 0;
+
+constexpr int kZipQuality = 8;
+
+// EXR stores channels sorted by name; film components in that order
+constexpr int kChannelsWithAlpha[4] = { 3, 2, 1, 0 };  // A, B, G, R
+constexpr int kChannelsWithoutAlpha[3] = { 2, 1, 0 };  // B, G, R
+constexpr const char* kChannelNames = "RGBA";
+
+// Little-endian serialization (EXR files are little-endian)
+template <typename T>
+void Push(std::vector<uint8_t>& out, T value) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void PushString(std::vector<uint8_t>& out, const char* text) {
+    out.insert(out.end(), text, text + std::strlen(text) + 1);
+}
+
+// Attribute header: name, type name and value size; the value follows
+void PushAttribute(std::vector<uint8_t>& out, const char* name, const char* type, int32_t size) {
+    PushString(out, name);
+    PushString(out, type);
+    Push(out, size);
+}
+
+void PushBox(std::vector<uint8_t>& out, const char* name, int width, int height) {
+    PushAttribute(out, name, "box2i", 16);
+    Push<int32_t>(out, 0);
+    Push<int32_t>(out, 0);
+    Push<int32_t>(out, width - 1);
+    Push<int32_t>(out, height - 1);
+}
+
+std::vector<uint8_t> BuildHeader(int width, int height, const ExrOptions& options) {
+    const int channel_count = options.alpha ? 4 : 3;
+    const int* channels = options.alpha ? kChannelsWithAlpha : kChannelsWithoutAlpha;
+    std::vector<uint8_t> header(kMagic, kMagic + 4);
+    Push<uint32_t>(header, kVersion | (options.tile_size > 0 ? kTiledFlag : 0));
+
+    // Per channel: name, pixel type, pLinear and 3 reserved bytes, x and y sampling
+    PushAttribute(header, "channels", "chlist", channel_count * 18 + 1);
+    for (int c = 0; c < channel_count; ++c) {
+        header.push_back(static_cast<uint8_t>(kChannelNames[channels[c]]));
+        header.push_back(0);
+        Push<int32_t>(header, options.pixel_type == ExrPixelType::kHalf ? kExrHalf : kExrFloat);
+        Push<uint32_t>(header, 0);
+        Push<int32_t>(header, 1);
+        Push<int32_t>(header, 1);
+    }
+    header.push_back(0);
+
+    PushAttribute(header, "compression", "compression", 1);
+    header.push_back(options.compression == ExrCompression::kZip ? kZipCompression : kNoCompression);
+    PushBox(header, "dataWindow", width, height);
+    PushBox(header, "displayWindow", width, height);
+    PushAttribute(header, "lineOrder", "lineOrder", 1);
+    header.push_back(kIncreasingY);
+    PushAttribute(header, "pixelAspectRatio", "float", 4);
+    Push(header, 1.0f);
+    PushAttribute(header, "screenWindowCenter", "v2f", 8);
+    Push(header, 0.0f);
+    Push(header, 0.0f);
+    PushAttribute(header, "screenWindowWidth", "float", 4);
+    Push(header, 1.0f);
+    if (options.tile_size > 0) {
+        // Tile width and height, then level mode ONE_LEVEL with rounding mode ROUND_DOWN
+        PushAttribute(header, "tiles", "tiledesc", 9);
+        Push<uint32_t>(header, static_cast<uint32_t>(options.tile_size));
+        Push<uint32_t>(header, static_cast<uint32_t>(options.tile_size));
+        header.push_back(0);
+    }
+    header.push_back(0);
+    return header;
+}
+
+// Pixel data of a rectangle in EXR's layout: line by line, each line holding the
+// rectangle's values of one channel after another
+void PackPixels(const glm::vec4* pixels, int width, int x0, int y0, int x1, int y1, const ExrOptions& options,
+                std::vector<uint8_t>& out) {
+    const int channel_count = options.alpha ? 4 : 3;
+    const int* channels = options.alpha ? kChannelsWithAlpha : kChannelsWithoutAlpha;
+    const size_t value_size = options.pixel_type == ExrPixelType::kHalf ? 2 : 4;
+    out.resize(static_cast<size_t>(x1 - x0) * (y1 - y0) * channel_count * value_size);
+    uint8_t* dst = out.data();
+    for (int y = y0; y < y1; ++y) {
+        const glm::vec4* row = pixels + static_cast<size_t>(y) * width;
+        for (int c = 0; c < channel_count; ++c) {
+            const int component = channels[c];
+            if (options.pixel_type == ExrPixelType::kHalf) {
+                for (int x = x0; x < x1; ++x, dst += 2) {
+                    uint16_t half = ExrWriter::FloatToHalf(row[x][component]);
+                    std::memcpy(dst, &half, 2);
+                }
+            } else {
+                for (int x = x0; x < x1; ++x, dst += 4) {
+                    float value = row[x][component];
+                    std::memcpy(dst, &value, 4);
+                }
+            }
+        }
+    }
+}
+
+// EXR's ZIP compression: the bytes are split into their even- and odd-indexed halves and
+// delta coded, which turns the similar high bytes of neighbouring values into runs, then
+// deflated; false if that does not make the data smaller (it is then stored raw)
+bool CompressZip(const std::vector<uint8_t>& raw, std::vector<uint8_t>& scratch, std::vector<uint8_t>& compressed) {
+    scratch.resize(raw.size());
+    const size_t half = (raw.size() + 1) / 2;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        scratch[(i & 1) ? half + i / 2 : i / 2] = raw[i];
+    }
+    for (size_t i = scratch.size() - 1; i > 0; --i) {
+        scratch[i] = static_cast<uint8_t>(scratch[i] - scratch[i - 1] + 128);
+    }
+    int zlib_size = 0;
+    std::unique_ptr<unsigned char, decltype(&std::free)> zlib(
+        stbi_zlib_compress(scratch.data(), static_cast<int>(scratch.size()), &zlib_size, kZipQuality), &std::free);
+    if (!zlib || static_cast<size_t>(zlib_size) >= raw.size()) {
+        return false;
+    }
+    compressed.assign(zlib.get(), zlib.get() + zlib_size);
+    return true;
+}
+
+}  // namespace
+
+uint16_t ExrWriter::FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude >= 0x7F800000) {
+        // Infinity stays infinity, NaN stays a (quiet) NaN
+        return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+    }
+    if (magnitude >= 0x477FF000) {
+        // 65520 and above round past the largest half (65504)
+        return sign | 0x7C00;
+    }
+    if (magnitude >= 0x38800000) {
+        // Normal: rebias the exponent and round the mantissa to 10 bits, ties to even
+        uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+        return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+    }
+    if (magnitude < 0x33000000) {
+        // Below half the smallest subnormal (2^-25)
+        return sign;
+    }
+    // Subnormal: the mantissa with its implicit bit, in units of 2^-24
+    const uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+    const int shift = 126 - static_cast<int>(magnitude >> 23);
+    uint32_t result = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1))) {
+        ++result;
+    }
+    return sign | static_cast<uint16_t>(result);
+}
+
+std::vector<uint8_t> ExrWriter::Encode(const glm::vec4* pixels, int width, int height, const ExrOptions& options,
+                                       ThreadPool& pool) {
+    if (width <= 0 || height <= 0 || options.tile_size < 0) {
+        grassland::LogError("Cannot encode a {}x{} EXR with tile size {}", width, height, options.tile_size);
+        return {};
+    }
+    const bool tiled = options.tile_size > 0;
+    const int block_width = tiled ? options.tile_size : width;
+    const int block_height = tiled ? options.tile_size : (options.compression == ExrCompression::kZip ? kZipScanlines : 1);
+    const int blocks_x = (width + block_width - 1) / block_width;
+    const int blocks_y = (height + block_height - 1) / block_height;
+    const size_t block_count = static_cast<size_t>(blocks_x) * blocks_y;
+
+    // Chunks in the order of the offset table (tiles row by row); each starts with its
+    // tile coordinates and level (tiled) or first line, then the size of its data
+    std::vector<std::vector<uint8_t>> chunks(block_count);
+    pool.ParallelFor(block_count, 1, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> raw, scratch, compressed;
+        for (size_t b = begin; b < end; ++b) {
+            const int bx = static_cast<int>(b % blocks_x);
+            const int by = static_cast<int>(b / blocks_x);
+            const int x0 = bx * block_width;
+            const int y0 = by * block_height;
+            PackPixels(pixels, width, x0, y0, std::min(x0 + block_width, width), std::min(y0 + block_height, height), options, raw);
+            const bool zipped = options.compression == ExrCompression::kZip && CompressZip(raw, scratch, compressed);
+            const std::vector<uint8_t>& data = zipped ? compressed : raw;
+
+            std::vector<uint8_t>& chunk = chunks[b];
+            chunk.reserve(data.size() + 20);
+            if (tiled) {
+                Push<int32_t>(chunk, bx);
+                Push<int32_t>(chunk, by);
+                Push<int32_t>(chunk, 0);
+                Push<int32_t>(chunk, 0);
+            } else {
+                Push<int32_t>(chunk, y0);
+            }
+            Push<int32_t>(chunk, static_cast<int32_t>(data.size()));
+            chunk.insert(chunk.end(), data.begin(), data.end());
+        }
+    });
+
+    std::vector<uint8_t> exr = BuildHeader(width, height, options);
+    uint64_t offset = exr.size() + block_count * sizeof(uint64_t);
+    for (const std::vector<uint8_t>& chunk : chunks) {
+        Push<uint64_t>(exr, offset);
+        offset += chunk.size();
+    }
+    exr.reserve(offset);
+    for (const std::vector<uint8_t>& chunk : chunks) {
+        exr.insert(exr.end(), chunk.begin(), chunk.end());
+    }
+    return exr;
+}
+
+bool ExrWriter::Write(const std::string& path, const glm::vec4* pixels, int width, int height, const ExrOptions& options,
+                     ThreadPool& pool) {
+    std::vector<uint8_t> exr = Encode(pixels, width, height, options, pool);
+    if (exr.empty()) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(exr.data()), static_cast<std::streamsize>(exr.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "long_march.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+enum class ExrPixelType {
+    kHalf,   // 16-bit float, enough for display-referred compositing
+    kFloat,  // 32-bit float, the film's full precision
+};
+
+enum class ExrCompression {
+    kNone,
+    kZip,  // Byte-delta coded and deflated blocks of 16 scanlines (or whole tiles)
+};
+
+struct ExrOptions {
+    ExrPixelType pixel_type = ExrPixelType::kHalf;
+    ExrCompression compression = ExrCompression::kZip;
+    int tile_size = 0;   // 0: scanline file, otherwise tiled with square tiles of this size
+    bool alpha = false;  // Write the A channel next to R, G and B
+};
+
+// OpenEXR writer for linear HDR film data (single part, single resolution level)
+// Scanline blocks or tiles are independent chunks located through the file's offset
+// table, so they are converted and compressed in parallel on a ThreadPool (the global
+// one unless the caller passes its own), and a tiled file's chunks could be produced
+// in any order
+class ExrWriter {
+public:
+    // EXR file of width * height RGBA pixels, rows stored top to bottom
+    static std::vector<uint8_t> Encode(const glm::vec4* pixels, int width, int height, const ExrOptions& options = {},
+                                       ThreadPool& pool = ThreadPool::Global());
+
+    // Encode and write to path; returns false if the file cannot be written
+    static bool Write(const std::string& path, const glm::vec4* pixels, int width, int height, const ExrOptions& options = {},
+                      ThreadPool& pool = ThreadPool::Global());
+
+    // Nearest half-precision float, rounding to even (infinity beyond the half range)
+    static uint16_t FloatToHalf(float value);
+
+private:
+    static constexpr int kZipScanlines = 16;  // Lines per chunk of ZIP compressed scanline files
+};
@@ -1,4 +1,5 @@
 #include "Film.h"
+#include "ToneMapper.h"
 
 Film::Film(grassland::graphics::Core* core, int width, int height)
     : core_(core)
@@ -31,6 +32,10 @@ void Film::CreateImages() {
     core_->CreateImage(width_, height_, 
                       grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT,
                       &output_image_);
+
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    accumulated_staging_.assign(pixel_count, glm::vec4(0.0f));
+    output_staging_.assign(pixel_count, glm::vec4(0.0f));
 }
 
 void Film::Reset() {
@@ -43,30 +48,28 @@ void Film::Reset() {
     core_->SubmitCommandContext(cmd_context.get());
     
     sample_count_ = 0;
+    output_stale_ = false;
     grassland::LogInfo("Film accumulation reset");
 }
 
-void Film::DevelopToOutput() {
+void Film::DevelopToOutput() const {
     // This would ideally be done in a compute shader for efficiency
-    // For now, we'll do it on the CPU (simple but potentially slow)
+    // For now, we'll do it on the CPU, on all cores and with SIMD
     
-    if (sample_count_ == 0) {
+    if (!output_stale_ || sample_count_ == 0) {
         return;
     }
 
-    // Download accumulated color and samples
-    size_t color_size = width_ * height_ * sizeof(float) * 4;
-    std::vector<float> accumulated_colors(width_ * height_ * 4);
-    accumulated_color_image_->DownloadData(accumulated_colors.data());
+    // Download accumulated color
+    accumulated_color_image_->DownloadData(accumulated_staging_.data());
 
-    // Divide by sample count to get average
-    std::vector<float> output_colors(width_ * height_ * 4);
-    for (int i = 0; i < width_ * height_ * 4; i++) {
-        output_colors[i] = accumulated_colors[i] / static_cast<float>(sample_count_);
-    }
+    // Divide by sample count to get average, then tone map for display
+    ToneMapper::Apply(tone_mapping_, accumulated_staging_.data(), output_staging_.data(), width_, height_,
+                      1.0f / static_cast<float>(sample_count_));
 
     // Upload to output image
-    output_image_->UploadData(output_colors.data());
+    output_image_->UploadData(output_staging_.data());
+    output_stale_ = false;
 }
 
 void Film::Resize(int width, int height) {
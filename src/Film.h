@@ -1,8 +1,11 @@
 #pragma once
 #include "long_march.h"
+#include "ToneMapper.h"
 
 // Film class for accumulating ray tracing samples over time
 // Used for progressive rendering when camera is stationary
+// The output image is developed on the CPU through persistent staging buffers, and
+// only when it is requested after new samples arrived
 class Film {
 public:
     Film(grassland::graphics::Core* core, int width, int height);
@@ -17,17 +20,21 @@ public:
     // Get the sample count image (for shader)
     grassland::graphics::Image* GetAccumulatedSamplesImage() const { return accumulated_samples_image_.get(); }
     
-    // Get the final output image (averaged result)
-    grassland::graphics::Image* GetOutputImage() const { return output_image_.get(); }
+    // Get the final output image (averaged result), developed first if it is out of date
+    grassland::graphics::Image* GetOutputImage() const { DevelopToOutput(); return output_image_.get(); }
 
     // Get current sample count
     int GetSampleCount() const { return sample_count_; }
 
     // Increment sample count
-    void IncrementSampleCount() { sample_count_++; }
+    void IncrementSampleCount() { sample_count_++; output_stale_ = true; }
 
     // Convert accumulated data to final output image (divide by sample count)
-    void DevelopToOutput();
+    // Optional: GetOutputImage develops on demand, and either is free without new samples
+    void DevelopToOutput() const;
+
+    // Tone mapping applied when developing the output image (the accumulation stays linear)
+    void SetToneMapping(const ToneMapSettings& settings) { tone_mapping_ = settings; output_stale_ = true; }
 
     // Resize the film (call when window resizes)
     void Resize(int width, int height);
@@ -50,6 +57,12 @@ private:
     // Final output image (accumulated_color / accumulated_samples)
     std::unique_ptr<grassland::graphics::Image> output_image_;
 
+    // Host copies of the accumulated and output colors, kept across frames
+    mutable std::vector<glm::vec4> accumulated_staging_;
+    mutable std::vector<glm::vec4> output_staging_;
+    mutable bool output_stale_ = false;
+    ToneMapSettings tone_mapping_;
+
     void CreateImages();
 };
 
@@ -0,0 +1,48 @@
+// Compiled with AVX (see src/CMakeLists.txt); only reached after CpuFeatures reports support
+#include "FilmKernels.h"
+
+#if defined(SHORT_MARCH_X86_SIMD)
+#include <immintrin.h>
+
+void FilmAccumulateAvx(const float* color, float* accumulated, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 sum0 = _mm256_add_ps(_mm256_loadu_ps(accumulated + i), _mm256_loadu_ps(color + i));
+        __m256 sum1 = _mm256_add_ps(_mm256_loadu_ps(accumulated + i + 8), _mm256_loadu_ps(color + i + 8));
+        _mm256_storeu_ps(accumulated + i, sum0);
+        _mm256_storeu_ps(accumulated + i + 8, sum1);
+    }
+    for (; i < count; ++i) {
+        accumulated[i] += color[i];
+    }
+}
+
+void FilmAccumulateCompensatedAvx(const float* color, float* accumulated, float* compensation, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_loadu_ps(accumulated + i);
+        __m256 y = _mm256_sub_ps(_mm256_loadu_ps(color + i), _mm256_loadu_ps(compensation + i));
+        __m256 t = _mm256_add_ps(sum, y);
+        _mm256_storeu_ps(compensation + i, _mm256_sub_ps(_mm256_sub_ps(t, sum), y));
+        _mm256_storeu_ps(accumulated + i, t);
+    }
+    FilmAccumulateCompensatedScalar(color + i, accumulated + i, compensation + i, count - i);
+}
+
+void FilmDevelopCountsAvx(const float* accumulated, const int32_t* samples, float* output, size_t pixel_count) {
+    // Two RGBA pixels per register, each scaled by its own reciprocal count
+    auto reciprocal = [](int32_t count) { return count > 0 ? 1.0f / static_cast<float>(count) : 0.0f; };
+    size_t i = 0;
+    for (; i + 2 <= pixel_count; i += 2) {
+        __m256 scale = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(reciprocal(samples[i]))),
+                                            _mm_set1_ps(reciprocal(samples[i + 1])), 1);
+        _mm256_storeu_ps(output + i * 4, _mm256_mul_ps(_mm256_loadu_ps(accumulated + i * 4), scale));
+    }
+    for (; i < pixel_count; ++i) {
+        float scale = reciprocal(samples[i]);
+        for (int c = 0; c < 4; ++c) {
+            output[i * 4 + c] = accumulated[i * 4 + c] * scale;
+        }
+    }
+}
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Film accumulation and development kernels over flat RGBA float arrays; the AVX
+// ones live in a translation unit compiled with AVX and are only called after
+// CpuFeatures confirms support
+
+// accumulated[i] += color[i]
+void FilmAccumulateScalar(const float* color, float* accumulated, size_t count);
+// accumulated[i] += color[i] by Kahan summation; compensation[i] carries the low-order
+// bits each addition rounded off, so long sums of small samples do not stall
+void FilmAccumulateCompensatedScalar(const float* color, float* accumulated, float* compensation, size_t count);
+// RGBA pixel i: output[i] = accumulated[i] / samples[i] (0 without samples)
+void FilmDevelopCountsScalar(const float* accumulated, const int32_t* samples, float* output, size_t pixel_count);
+
+#if defined(SHORT_MARCH_X86_SIMD)
+void FilmAccumulateAvx(const float* color, float* accumulated, size_t count);
+void FilmAccumulateCompensatedAvx(const float* color, float* accumulated, float* compensation, size_t count);
+void FilmDevelopCountsAvx(const float* accumulated, const int32_t* samples, float* output, size_t pixel_count);
+#endif
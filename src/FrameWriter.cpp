@@ -0,0 +1,177 @@
+#include "FrameWriter.h"
+#include "PfmWriter.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <filesystem>
+
+FrameWriter::FrameWriter(const std::string& path, int width, int height, const FrameWriterOptions& options)
+    : path_(path),
+      width_(width),
+      height_(height),
+      options_(options),
+      y4m_(std::filesystem::path(path).extension() == ".y4m"),
+      pool_(2),
+      encoder_(&FrameWriter::EncoderLoop, this) {
+}
+
+FrameWriter::~FrameWriter() {
+    Finish();
+}
+
+std::vector<glm::vec4> FrameWriter::AcquireBuffer() {
+    std::vector<glm::vec4> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_buffers_.empty()) {
+            buffer = std::move(free_buffers_.back());
+            free_buffers_.pop_back();
+        }
+    }
+    buffer.resize(static_cast<size_t>(width_) * height_);
+    return buffer;
+}
+
+bool FrameWriter::Push(std::vector<glm::vec4> frame) {
+    auto wait_start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    frame_taken_.wait(lock, [this]() { return queue_.size() < options_.queue_capacity || failed_; });
+    stall_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+    if (failed_ || finishing_) {
+        return false;
+    }
+    queue_.push_back(std::move(frame));
+    frame_queued_.notify_one();
+    return true;
+}
+
+bool FrameWriter::Finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finishing_ = true;
+    }
+    frame_queued_.notify_one();
+    if (encoder_.joinable()) {
+        encoder_.join();
+    }
+    if (y4m_file_.is_open()) {
+        y4m_file_.close();
+    }
+    return !failed_;
+}
+
+int FrameWriter::GetFramesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_written_;
+}
+
+std::string FrameWriter::GetFramePath(const std::string& pattern, int index) {
+    std::string path = pattern;
+    size_t first = path.find('#');
+    if (first == std::string::npos) {
+        std::filesystem::path file(pattern);
+        path = (file.parent_path() / file.stem()).string() + "_####" + file.extension().string();
+        first = path.rfind("_####") + 1;
+    }
+    const size_t last = path.find_first_not_of('#', first);
+    const size_t digits = (last == std::string::npos ? path.size() : last) - first;
+    std::string number = std::to_string(index);
+    if (number.size() < digits) {
+        number.insert(0, digits - number.size(), '0');
+    }
+    return path.replace(first, digits, number);
+}
+
+void FrameWriter::EncoderLoop() {
+    for (int index = 0;; ++index) {
+        std::vector<glm::vec4> frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frame_queued_.wait(lock, [this]() { return !queue_.empty() || finishing_; });
+            if (queue_.empty()) {
+                return;
+            }
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        bool written = WriteFrame(frame, index);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (written) {
+                ++frames_written_;
+            } else {
+                // Nothing after a missing frame is usable, so stop taking frames
+                failed_ = true;
+                queue_.clear();
+            }
+            if (free_buffers_.size() <= options_.queue_capacity) {
+                free_buffers_.push_back(std::move(frame));
+            }
+        }
+        frame_taken_.notify_one();
+        if (!written) {
+            return;
+        }
+    }
+}
+
+bool FrameWriter::WriteFrame(const std::vector<glm::vec4>& frame, int index) {
+    if (y4m_) {
+        return WriteY4mFrame(frame);
+    }
+    const std::string path = GetFramePath(path_, index);
+    const std::string extension = std::filesystem::path(path).extension().string();
+    bool saved = false;
+    if (extension == ".exr") {
+        saved = ExrWriter::Write(path, frame.data(), width_, height_, options_.exr, pool_);
+    } else if (extension == ".pfm") {
+        saved = PfmWriter::Write(path, frame.data(), width_, height_, pool_);
+    } else {
+        rgba_.resize(frame.size() * 4);
+        ToneMapper::Quantize(options_.tone_mapping, frame.data(), rgba_.data(), width_, height_, 1.0f, pool_);
+        saved = PngWriter::Write(path, rgba_.data(), width_, height_, 4, options_.png_compression, pool_);
+    }
+    if (!saved) {
+        grassland::LogError("Failed to write frame {}: {}", index, path);
+    }
+    return saved;
+}
+
+bool FrameWriter::WriteY4mFrame(const std::vector<glm::vec4>& frame) {
+    if (!y4m_file_.is_open()) {
+        // Blocks until a reader opens the other end when the path is a named pipe
+        y4m_file_.open(path_, std::ios::binary | std::ios::trunc);
+        y4m_file_ << "YUV4MPEG2 W" << width_ << " H" << height_ << " F" << options_.fps
+                  << ":1 Ip A1:1 C444 XCOLORRANGE=LIMITED\n";
+    }
+
+    // Tone mapped 8-bit RGB to BT.709 limited-range Y, Cb and Cr planes; players decode
+    // them as gamma-encoded R'G'B', so the frames are always encoded, whatever srgb says
+    ToneMapSettings tone_mapping = options_.tone_mapping;
+    tone_mapping.srgb = true;
+    const size_t pixel_count = frame.size();
+    rgba_.resize(pixel_count * 4);
+    planes_.resize(pixel_count * 3);
+    ToneMapper::Quantize(tone_mapping, frame.data(), rgba_.data(), width_, height_, 1.0f, pool_);
+    pool_.ParallelFor(static_cast<size_t>(height_), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin * width_; i < end * width_; ++i) {
+            const float r = rgba_[i * 4];
+            const float g = rgba_[i * 4 + 1];
+            const float b = rgba_[i * 4 + 2];
+            planes_[i] = static_cast<uint8_t>(16.5f + (219.0f / 255.0f) * (0.2126f * r + 0.7152f * g + 0.0722f * b));
+            planes_[pixel_count + i] =
+                static_cast<uint8_t>(128.5f + (224.0f / 255.0f) * (-0.1146f * r - 0.3854f * g + 0.5f * b));
+            planes_[2 * pixel_count + i] =
+                static_cast<uint8_t>(128.5f + (224.0f / 255.0f) * (0.5f * r - 0.4542f * g - 0.0458f * b));
+        }
+    });
+    y4m_file_ << "FRAME\n";
+    y4m_file_.write(reinterpret_cast<const char*>(planes_.data()), static_cast<std::streamsize>(planes_.size()));
+    y4m_file_.flush();
+    if (!y4m_file_) {
+        grassland::LogError("Failed to write video frame: {}", path_);
+        return false;
+    }
+    return true;
+}
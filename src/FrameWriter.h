@@ -0,0 +1,83 @@
+#pragma once
+#include "long_march.h"
+#include "ExrWriter.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+#include "ToneMapper.h"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FrameWriterOptions {
+    int fps = 30;                  // Y4M frame rate
+    size_t queue_capacity = 4;     // Frames waiting for the encoder before Push blocks
+    ToneMapSettings tone_mapping;  // PNG and Y4M frames; Y4M is always sRGB encoded
+    PngCompression png_compression = PngCompression::kDefault;
+    ExrOptions exr;
+};
+
+// Streams the frames of an animation out while the next ones render: Push hands a frame
+// to an encoder thread through a bounded queue and only blocks when the encoder falls
+// queue_capacity frames behind, so memory stays bounded however long the animation is
+// The encoder splits a frame with one helper of its own instead of the global
+// ThreadPool, which is busy rendering the next frame
+// The path is either an image sequence, whose run of '#' becomes the zero-padded frame
+// number ("frames/shot_####.png"; .exr and .pfm frames keep the linear radiance), or a
+// .y4m file (8-bit 4:4:4 BT.709 video, always sRGB encoded since players expect
+// gamma-encoded values), which may be a named pipe read by a video encoder
+class FrameWriter {
+public:
+    FrameWriter(const std::string& path, int width, int height, const FrameWriterOptions& options);
+    // Finishes the frames still queued
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Buffer of width * height colors to fill with the next frame; pass it to Push
+    std::vector<glm::vec4> AcquireBuffer();
+
+    // Queue the next frame; false once a frame failed to write (the rest are dropped)
+    bool Push(std::vector<glm::vec4> frame);
+
+    // Wait until every queued frame is written; false if any failed
+    bool Finish();
+
+    int GetFramesWritten() const;
+    // Time Push spent waiting for the encoder, i.e. encoding that did not overlap rendering
+    double GetStallSeconds() const { return stall_seconds_; }
+
+    // Path of a frame of an image sequence: the first run of '#' in pattern replaced by
+    // the zero-padded index, or "_####" added before the extension if there is none
+    static std::string GetFramePath(const std::string& pattern, int index);
+
+private:
+    void EncoderLoop();
+    bool WriteFrame(const std::vector<glm::vec4>& frame, int index);
+    bool WriteY4mFrame(const std::vector<glm::vec4>& frame);
+
+    std::string path_;
+    int width_;
+    int height_;
+    FrameWriterOptions options_;
+    bool y4m_;
+    std::ofstream y4m_file_;  // Opened by the encoder, so a pipe's reader may attach late
+    std::vector<uint8_t> rgba_;
+    std::vector<uint8_t> planes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable frame_queued_;
+    std::condition_variable frame_taken_;
+    std::deque<std::vector<glm::vec4>> queue_;
+    std::vector<std::vector<glm::vec4>> free_buffers_;
+    bool finishing_ = false;
+    bool failed_ = false;
+    int frames_written_ = 0;
+    double stall_seconds_ = 0.0;
+    ThreadPool pool_;      // The encoder thread and one helper
+    std::thread encoder_;  // Last, so everything it uses exists when it starts
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file
+// The pages are shared with the OS file cache, so data is read straight out of
+// the mapping without copying it into the process
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map the file; returns false if it cannot be opened or is empty
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return data_ != nullptr; }
+    const uint8_t* GetData() const { return data_; }
+    size_t GetSize() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+};
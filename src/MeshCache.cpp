@@ -0,0 +1,226 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+constexpr char kMagic[8] = { 'S', 'M', 'M', 'E', 'S', 'H', '\0', '\0' };
+constexpr uint32_t kVersion = 2;
+constexpr uint64_t kAlignment = 64;  // Bvh8Node alignment, also a cache line
+
+uint64_t AlignUp(uint64_t offset) {
+    return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// Size and modification time identify the source the cache was made from
+bool GetSourceStamp(const std::string& source_path, uint64_t& size, int64_t& time) {
+    std::error_code error;
+    size = std::filesystem::file_size(source_path, error);
+    if (error) {
+        return false;
+    }
+    auto write_time = std::filesystem::last_write_time(source_path, error);
+    if (error) {
+        return false;
+    }
+    time = static_cast<int64_t>(write_time.time_since_epoch().count());
+    return true;
+}
+
+}  // namespace
+
+struct MeshCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    // Sizes of the stored structs; a cache from a build with other layouts is rejected
+    uint32_t triangle_size;
+    uint32_t wide_node_size;
+    uint64_t source_size;
+    int64_t source_time;
+    uint64_t content_hash;
+
+    // Section offsets from the start of the file (0: absent)
+    uint64_t num_vertices;
+    uint64_t num_indices;
+    uint64_t positions;
+    uint64_t normals;
+    uint64_t tex_coords;
+    uint64_t indices;
+    uint64_t triangle_count;
+    uint64_t triangles;
+    uint64_t wide_node_count;
+    uint64_t wide_nodes;
+
+    Aabb bvh_bounds;
+    BvhBuildStats bvh_stats;
+};
+
+std::string MeshCache::GetCachePath(const std::string& source_path) {
+    return source_path + ".smcache";
+}
+
+bool MeshCache::Open(const std::string& source_path) {
+    header_ = nullptr;
+    uint64_t source_size = 0;
+    int64_t source_time = 0;
+    if (!GetSourceStamp(source_path, source_size, source_time) || !file_.Open(GetCachePath(source_path))) {
+        return false;
+    }
+
+    const uint64_t file_size = file_.GetSize();
+    const Header* header = reinterpret_cast<const Header*>(file_.GetData());
+    if (file_size < sizeof(Header) ||
+        std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->version != kVersion ||
+        header->header_size != sizeof(Header) ||
+        header->triangle_size != sizeof(BvhTriangle) ||
+        header->wide_node_size != sizeof(Bvh8Node) ||
+        header->source_size != source_size ||
+        header->source_time != source_time) {
+        file_.Close();
+        return false;
+    }
+
+    // Every present section must lie inside the file
+    auto section_fits = [file_size](uint64_t offset, uint64_t count, uint64_t element_size) {
+        return offset == 0 || (offset % kAlignment == 0 && offset <= file_size &&
+                               count <= (file_size - offset) / element_size);
+    };
+    if (header->positions == 0 || header->indices == 0 ||
+        !section_fits(header->positions, header->num_vertices, sizeof(glm::vec3)) ||
+        !section_fits(header->normals, header->num_vertices, sizeof(glm::vec3)) ||
+        !section_fits(header->tex_coords, header->num_vertices, sizeof(glm::vec2)) ||
+        !section_fits(header->indices, header->num_indices, sizeof(uint32_t)) ||
+        !section_fits(header->triangles, header->triangle_count, sizeof(BvhTriangle)) ||
+        !section_fits(header->wide_nodes, header->wide_node_count, sizeof(Bvh8Node))) {
+        file_.Close();
+        return false;
+    }
+    header_ = header;
+    return true;
+}
+
+bool MeshCache::Write(const std::string& source_path, uint64_t content_hash, const MeshData& mesh, const Bvh* bvh) {
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.header_size = sizeof(Header);
+    header.triangle_size = sizeof(BvhTriangle);
+    header.wide_node_size = sizeof(Bvh8Node);
+    if (!GetSourceStamp(source_path, header.source_size, header.source_time)) {
+        return false;
+    }
+    header.content_hash = content_hash;
+    header.num_vertices = mesh.num_vertices;
+    header.num_indices = mesh.num_indices;
+
+    // Lay out the sections, each aligned
+    struct Section {
+        uint64_t* offset;
+        const void* data;
+        uint64_t size;
+    };
+    BvhData bvh_data;
+    if (bvh) {
+        bvh_data = bvh->GetData();
+        header.triangle_count = bvh_data.triangle_count;
+        header.wide_node_count = bvh_data.wide_node_count;
+        header.bvh_bounds = bvh_data.bounds;
+        header.bvh_stats = bvh_data.stats;
+    }
+    Section sections[] = {
+        { &header.positions, mesh.positions, mesh.num_vertices * sizeof(glm::vec3) },
+        { &header.normals, mesh.normals, mesh.normals ? mesh.num_vertices * sizeof(glm::vec3) : 0 },
+        { &header.tex_coords, mesh.tex_coords, mesh.tex_coords ? mesh.num_vertices * sizeof(glm::vec2) : 0 },
+        { &header.indices, mesh.indices, mesh.num_indices * sizeof(uint32_t) },
+        { &header.triangles, bvh_data.triangles, bvh_data.triangle_count * sizeof(BvhTriangle) },
+        { &header.wide_nodes, bvh_data.wide_nodes, bvh_data.wide_node_count * sizeof(Bvh8Node) },
+    };
+    uint64_t offset = AlignUp(sizeof(Header));
+    for (Section& section : sections) {
+        if (!section.data || section.size == 0) {
+            continue;
+        }
+        *section.offset = offset;
+        offset = AlignUp(offset + section.size);
+    }
+    if (header.positions == 0 || header.indices == 0) {
+        return false;
+    }
+
+    // Write to a temporary file and rename it over the old cache, so a failed write
+    // leaves the old one intact (the caller must have unmapped it)
+    std::string cache_path = GetCachePath(source_path);
+    std::string temp_path = cache_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        const char padding[kAlignment] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        uint64_t written = sizeof(Header);
+        for (const Section& section : sections) {
+            if (*section.offset == 0) {
+                continue;
+            }
+            file.write(padding, static_cast<std::streamsize>(*section.offset - written));
+            file.write(static_cast<const char*>(section.data), static_cast<std::streamsize>(section.size));
+            written = *section.offset + section.size;
+        }
+        file.write(padding, static_cast<std::streamsize>(offset - written));
+        if (!file) {
+            file.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t MeshCache::GetContentHash() const {
+    return header_->content_hash;
+}
+
+MeshData MeshCache::GetMesh() const {
+    const uint8_t* base = file_.GetData();
+    MeshData mesh;
+    mesh.num_vertices = header_->num_vertices;
+    mesh.num_indices = header_->num_indices;
+    mesh.positions = reinterpret_cast<const glm::vec3*>(base + header_->positions);
+    mesh.indices = reinterpret_cast<const uint32_t*>(base + header_->indices);
+    if (header_->normals) {
+        mesh.normals = reinterpret_cast<const glm::vec3*>(base + header_->normals);
+    }
+    if (header_->tex_coords) {
+        mesh.tex_coords = reinterpret_cast<const glm::vec2*>(base + header_->tex_coords);
+    }
+    return mesh;
+}
+
+bool MeshCache::HasBvh() const {
+    return header_->triangles != 0 && header_->wide_nodes != 0;
+}
+
+BvhData MeshCache::GetBvh() const {
+    const uint8_t* base = file_.GetData();
+    BvhData data;
+    data.bounds = header_->bvh_bounds;
+    data.stats = header_->bvh_stats;
+    data.triangles = reinterpret_cast<const BvhTriangle*>(base + header_->triangles);
+    data.triangle_count = header_->triangle_count;
+    data.wide_nodes = reinterpret_cast<const Bvh8Node*>(base + header_->wide_nodes);
+    data.wide_node_count = header_->wide_node_count;
+    return data;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "long_march.h"
+#include "Bvh.h"
+#include "MappedFile.h"
+#include <string>
+
+// Mesh arrays as used for buffer upload and BVH builds; normals and tex_coords may be null
+struct MeshData {
+    const glm::vec3* positions = nullptr;
+    const glm::vec3* normals = nullptr;
+    const glm::vec2* tex_coords = nullptr;
+    const uint32_t* indices = nullptr;
+    size_t num_vertices = 0;
+    size_t num_indices = 0;
+};
+
+// Binary cache of a parsed OBJ and, once built, its CPU BVH, written next to the
+// source as "<file>.smcache"
+// Later runs memory-map it and use the arrays in place: every section is 64-byte
+// aligned and stored in the layout the buffers and BVH traversal read
+// A cache is ignored once the source's size or modification time changes, or if
+// it was written by a build with different struct layouts
+class MeshCache {
+public:
+    static std::string GetCachePath(const std::string& source_path);
+
+    // Map the cache of source_path; false if it is missing, stale or incompatible
+    bool Open(const std::string& source_path);
+
+    // Write the cache of source_path (bvh may be null); false on I/O errors
+    // Replaces an existing cache, which must not be mapped at the time
+    static bool Write(const std::string& source_path, uint64_t content_hash, const MeshData& mesh, const Bvh* bvh);
+
+    uint64_t GetContentHash() const;
+    MeshData GetMesh() const;
+    bool HasBvh() const;
+    BvhData GetBvh() const;
+    size_t GetSize() const { return file_.GetSize(); }
+
+private:
+    struct Header;
+
+    MappedFile file_;
+    const Header* header_ = nullptr;
+};
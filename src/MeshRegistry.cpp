@@ -0,0 +1,233 @@
+#include "MeshRegistry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+bool MeshAsset::LoadObj(const char* text, size_t size) {
+    if (!ObjLoader::Parse(text, size, mesh_)) {
+        return false;
+    }
+    UseParsedMesh();
+    return true;
+}
+
+void MeshAsset::UseParsedMesh() {
+    data_ = MeshData();
+    data_.positions = mesh_.positions.data();
+    data_.normals = mesh_.normals.empty() ? nullptr : mesh_.normals.data();
+    data_.tex_coords = mesh_.tex_coords.empty() ? nullptr : mesh_.tex_coords.data();
+    data_.indices = mesh_.indices.data();
+    data_.num_vertices = mesh_.positions.size();
+    data_.num_indices = mesh_.indices.size();
+}
+
+void MeshAsset::AttachCache(std::unique_ptr<MeshCache> cache) {
+    cache_ = std::move(cache);
+    data_ = cache_->GetMesh();
+    if (cache_->HasBvh()) {
+        cpu_blas_ = std::make_unique<Bvh>();
+        cpu_blas_->Attach(cache_->GetBvh());
+    }
+}
+
+void MeshAsset::WriteCache() {
+    if (cache_) {
+        // The new cache is renamed over the mapped one, which Windows refuses: copy the
+        // mesh out and unmap it first
+        mesh_.positions.assign(data_.positions, data_.positions + data_.num_vertices);
+        if (data_.normals) {
+            mesh_.normals.assign(data_.normals, data_.normals + data_.num_vertices);
+        }
+        if (data_.tex_coords) {
+            mesh_.tex_coords.assign(data_.tex_coords, data_.tex_coords + data_.num_vertices);
+        }
+        mesh_.indices.assign(data_.indices, data_.indices + data_.num_indices);
+        cache_.reset();
+        UseParsedMesh();
+    }
+    if (!MeshCache::Write(source_path_, content_hash_, data_, cpu_blas_.get())) {
+        grassland::LogWarning("Could not write mesh cache {}", MeshCache::GetCachePath(source_path_));
+    }
+}
+
+void MeshAsset::BuildBLAS(grassland::graphics::Core* core) {
+    if (blas_) {
+        return;
+    }
+
+    // Create vertex buffer
+    size_t vertex_buffer_size = data_.num_vertices * sizeof(glm::vec3);
+    core->CreateBuffer(vertex_buffer_size,
+                      grassland::graphics::BUFFER_TYPE_DYNAMIC,
+                      &vertex_buffer_);
+    vertex_buffer_->UploadData(data_.positions, vertex_buffer_size);
+
+    // Create index buffer
+    size_t index_buffer_size = data_.num_indices * sizeof(uint32_t);
+    core->CreateBuffer(index_buffer_size,
+                      grassland::graphics::BUFFER_TYPE_DYNAMIC,
+                      &index_buffer_);
+    index_buffer_->UploadData(data_.indices, index_buffer_size);
+
+    // Build BLAS
+    core->CreateBottomLevelAccelerationStructure(
+        vertex_buffer_.get(),
+        index_buffer_.get(),
+        sizeof(glm::vec3),
+        &blas_);
+
+    grassland::LogInfo("Built BLAS for mesh: {}", path_);
+}
+
+void MeshAsset::BuildCpuBLAS() {
+    std::lock_guard<std::mutex> lock(cpu_blas_mutex_);
+    if (cpu_blas_) {
+        return;
+    }
+
+    // Positions are tightly packed float3, the same layout uploaded to the vertex buffer
+    cpu_blas_ = std::make_unique<Bvh>();
+    cpu_blas_->Build(data_.positions, data_.indices, data_.num_indices / 3);
+
+    const BvhBuildStats& stats = cpu_blas_->GetBuildStats();
+    grassland::LogInfo("Built CPU BLAS for mesh {} in {:.1f} ms ({} triangles, {} nodes, {} BVH8 nodes, SAH cost {:.2f}, depth {}, leaf sizes {})",
+                       path_, stats.build_time_ms, cpu_blas_->GetTriangleCount(), stats.node_count, stats.wide_node_count,
+                       stats.sah_cost, stats.max_depth, stats.LeafHistogramString());
+
+    // Later runs map the BVH instead of building it
+    WriteCache();
+}
+
+std::shared_ptr<MeshAsset> MeshRegistry::Load(const std::string& obj_file_path) {
+    std::string full_path = grassland::FindAssetFile(obj_file_path);
+    std::promise<std::shared_ptr<MeshAsset>> result;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (auto asset = by_path_[full_path].lock()) {
+            return asset;
+        }
+        // Another thread is loading this file: wait for its result
+        auto loading = loading_.find(full_path);
+        if (loading != loading_.end()) {
+            std::shared_future<std::shared_ptr<MeshAsset>> future = loading->second;
+            lock.unlock();
+            return future.get();
+        }
+        loading_[full_path] = result.get_future().share();
+    }
+
+    auto asset = LoadFile(obj_file_path, full_path);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loading_.erase(full_path);
+    }
+    result.set_value(asset);
+    return asset;
+}
+
+std::shared_ptr<MeshAsset> MeshRegistry::LoadFile(const std::string& obj_file_path, const std::string& full_path) {
+    // An up-to-date cache provides the content hash and the mesh without parsing;
+    // otherwise map the OBJ, which is hashed and then parsed in place
+    auto cache = std::make_unique<MeshCache>();
+    MappedFile source;
+    uint64_t hash = 0;
+    if (cache->Open(full_path)) {
+        hash = cache->GetContentHash();
+    } else {
+        cache.reset();
+        if (!source.Open(full_path)) {
+            grassland::LogError("Failed to load mesh from: {}", obj_file_path);
+            return nullptr;
+        }
+        hash = HashContents(source.GetData(), source.GetSize());
+    }
+
+    // Not loaded under this path: identical contents under another path are shared too
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto asset = by_hash_[hash].lock()) {
+            by_path_[full_path] = asset;
+            grassland::LogInfo("Reusing mesh {} for {} (same contents)", asset->GetPath(), obj_file_path);
+            return asset;
+        }
+    }
+
+    // Map or parse outside the lock so other loads are not held up
+    auto asset = std::make_shared<MeshAsset>(obj_file_path, full_path, hash);
+    if (cache) {
+        size_t cache_size = cache->GetSize();
+        asset->AttachCache(std::move(cache));
+        grassland::LogInfo("Mapped mesh cache for {} ({} vertices, {} indices, {}{:.1f} MB)",
+                           obj_file_path, asset->NumVertices(), asset->NumIndices(),
+                           asset->GetCpuBLAS() ? "with CPU BVH, " : "", cache_size / (1024.0 * 1024.0));
+    } else {
+        auto start_time = std::chrono::steady_clock::now();
+        if (!asset->LoadObj(reinterpret_cast<const char*>(source.GetData()), source.GetSize())) {
+            grassland::LogError("Failed to load mesh from: {}", obj_file_path);
+            return nullptr;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        grassland::LogInfo("Successfully loaded mesh: {} ({} vertices, {} indices, {:.1f} ms, {:.0f} MB/s)",
+                           obj_file_path, asset->NumVertices(), asset->NumIndices(), seconds * 1000.0,
+                           source.GetSize() / (1024.0 * 1024.0) / std::max(seconds, 1e-9));
+        source.Close();
+        // The CPU BVH build writes the cache with the BVH in it, so writing it here too
+        // would only store the mesh twice
+        if (!builds_cpu_bvh_) {
+            asset->WriteCache();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto existing = by_hash_[hash].lock()) {
+        // Another thread finished loading the same mesh first
+        by_path_[full_path] = existing;
+        return existing;
+    }
+    by_path_[full_path] = asset;
+    by_hash_[hash] = asset;
+    return asset;
+}
+
+size_t MeshRegistry::GetMeshCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = by_path_.begin(); it != by_path_.end();) {
+        it = it->second.expired() ? by_path_.erase(it) : std::next(it);
+    }
+    size_t count = 0;
+    for (auto it = by_hash_.begin(); it != by_hash_.end();) {
+        if (it->second.expired()) {
+            it = by_hash_.erase(it);
+        } else {
+            ++count;
+            ++it;
+        }
+    }
+    return count;
+}
+
+MeshRegistry& MeshRegistry::Global() {
+    static MeshRegistry registry;
+    return registry;
+}
+
+uint64_t MeshRegistry::HashContents(const uint8_t* data, size_t size) {
+    // FNV-1a style over 8-byte words (with a final mix), fast enough not to slow
+    // down the parser it runs before
+    uint64_t hash = 14695981039346656037ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    hash ^= hash >> 32;
+    hash *= 0xd6e8feb86659fd93ull;
+    hash ^= hash >> 32;
+    return hash;
+}
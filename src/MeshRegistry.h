@@ -0,0 +1,101 @@
+#pragma once
+#include "long_march.h"
+#include "Bvh.h"
+#include "MeshCache.h"
+#include "ObjLoader.h"
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// One mesh and everything built from it (GPU buffers and BLAS, CPU BVH)
+// Shared by all entities that load the same OBJ file
+// The mesh arrays are either parsed from the OBJ or used in place from its
+// memory-mapped MeshCache, which can also carry the prebuilt CPU BVH
+class MeshAsset {
+public:
+    // path is the name the mesh was requested by, source_path the resolved file
+    MeshAsset(const std::string& path, const std::string& source_path, uint64_t content_hash)
+        : path_(path), source_path_(source_path), content_hash_(content_hash) {}
+
+    // Parse the OBJ source text
+    bool LoadObj(const char* text, size_t size);
+
+    // Use a mapped cache in place (mesh arrays and, if stored, the CPU BVH)
+    void AttachCache(std::unique_ptr<MeshCache> cache);
+
+    // Store the mesh and, once built, the CPU BVH for the next run
+    // A mapped cache is replaced, so the mesh is copied into memory first
+    void WriteCache();
+
+    const std::string& GetPath() const { return path_; }
+    uint64_t GetContentHash() const { return content_hash_; }
+    const MeshData& GetData() const { return data_; }
+    size_t NumVertices() const { return data_.num_vertices; }
+    size_t NumIndices() const { return data_.num_indices; }
+    bool IsCached() const { return cache_ != nullptr; }
+
+    grassland::graphics::Buffer* GetVertexBuffer() const { return vertex_buffer_.get(); }
+    grassland::graphics::Buffer* GetIndexBuffer() const { return index_buffer_.get(); }
+    grassland::graphics::AccelerationStructure* GetBLAS() const { return blas_.get(); }
+    const Bvh* GetCpuBLAS() const { return cpu_blas_.get(); }
+
+    // Upload the mesh and build its BLAS; no-op once built
+    void BuildBLAS(grassland::graphics::Core* core);
+
+    // Build the CPU BVH for the mesh; no-op once built
+    // Safe to call from several loader threads at once, which wait for one build
+    void BuildCpuBLAS();
+
+private:
+    // Point data_ at the arrays of mesh_
+    void UseParsedMesh();
+
+    std::string path_;
+    std::string source_path_;
+    uint64_t content_hash_;
+    MeshData data_;
+    ObjMesh mesh_;                        // Parsed OBJ (empty when loaded from the cache)
+    std::unique_ptr<MeshCache> cache_;    // Mapped cache backing data_ (and the CPU BVH)
+
+    std::unique_ptr<grassland::graphics::Buffer> vertex_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> index_buffer_;
+    std::unique_ptr<grassland::graphics::AccelerationStructure> blas_;
+    std::unique_ptr<Bvh> cpu_blas_;
+    std::mutex cpu_blas_mutex_;
+};
+
+// MeshRegistry hands out one MeshAsset per mesh, so entities placing the same
+// OBJ parse it, upload it and build its acceleration structures only once
+// Lookups go by path first, then by a hash of the file contents so copies of a
+// file under another name are shared too; assets are freed with their last entity
+// Meshes with an up-to-date MeshCache are mapped instead of parsed, and take their
+// content hash from it without reading the OBJ
+// Load may be called from several threads; concurrent loads of one file parse it once
+class MeshRegistry {
+public:
+    // Load (or reuse) the mesh at obj_file_path; nullptr if it cannot be loaded
+    std::shared_ptr<MeshAsset> Load(const std::string& obj_file_path);
+
+    // Number of meshes currently alive
+    size_t GetMeshCount();
+
+    // Whether every loaded mesh goes on to get a CPU BVH, whose build writes the cache;
+    // otherwise the cache is written once the OBJ is parsed. Set before loading
+    void SetBuildsCpuBvh(bool builds_cpu_bvh) { builds_cpu_bvh_ = builds_cpu_bvh; }
+
+    // Process-wide registry used by Entity
+    static MeshRegistry& Global();
+
+private:
+    std::shared_ptr<MeshAsset> LoadFile(const std::string& obj_file_path, const std::string& full_path);
+    static uint64_t HashContents(const uint8_t* data, size_t size);
+
+    std::mutex mutex_;
+    bool builds_cpu_bvh_ = false;
+    std::unordered_map<std::string, std::weak_ptr<MeshAsset>> by_path_;
+    std::unordered_map<uint64_t, std::weak_ptr<MeshAsset>> by_hash_;
+    // Files being loaded by some thread, so other threads wait instead of loading them too
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<MeshAsset>>> loading_;
+};
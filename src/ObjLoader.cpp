@@ -0,0 +1,468 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kChunkSize = 1 << 20;  // Bytes of text per parallel chunk
+constexpr int32_t kMissing = INT32_MIN;
+
+// Face corner as written; relative bits mark indices counted back from the end of the chunk's
+// elements so far, which are only resolved once the counts of earlier chunks are known
+struct Corner {
+    int32_t v;
+    int32_t vt;
+    int32_t vn;
+    uint32_t relative;  // Bit 0: v, bit 1: vt, bit 2: vn
+};
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> tex_coords;
+    std::vector<Corner> corners;  // Three per triangle
+    const char* error = nullptr;  // First malformed line, if any
+};
+
+constexpr double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool IsDigit(char c) {
+    return static_cast<unsigned>(c - '0') < 10u;
+}
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// [sign] digits [. digits] [(e|E) [sign] digits]
+// Up to 19 significant digits are accumulated exactly and scaled by one exact power of
+// ten, so the result is correctly rounded for the usual OBJ numbers; other spellings
+// (inf, nan, huge exponents) go through strtod
+const char* ParseFloat(const char* p, const char* end, float& out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    const char* digits_start = p;
+    for (; p < end && IsDigit(*p); ++p) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        for (; p < end && IsDigit(*p); ++p) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (p == digits_start || (p == digits_start + 1 && *digits_start == '.')) {
+        // No digits: let strtod decide (inf, nan) on a terminated copy
+        char buffer[64];
+        size_t length = 0;
+        for (const char* q = start; q < end && !IsSpace(*q) && *q != '\n' && length + 1 < sizeof(buffer); ++q) {
+            buffer[length++] = *q;
+        }
+        buffer[length] = '\0';
+        char* parse_end = nullptr;
+        out = std::strtof(buffer, &parse_end);
+        return parse_end == buffer ? nullptr : start + (parse_end - buffer);
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exponent_negative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exponent_negative = *q == '-';
+            ++q;
+        }
+        if (q < end && IsDigit(*q)) {
+            int value = 0;
+            for (; q < end && IsDigit(*q); ++q) {
+                value = std::min(value * 10 + (*q - '0'), 100000);
+            }
+            exponent += exponent_negative ? -value : value;
+            p = q;
+        }
+    }
+
+    double value = static_cast<double>(mantissa);
+    if (exponent >= 0 && exponent <= 22) {
+        value *= kPow10[exponent];
+    } else if (exponent < 0 && exponent >= -22) {
+        value /= kPow10[-exponent];
+    } else if (mantissa != 0) {
+        value *= std::pow(10.0, exponent);
+    }
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+const char* ParseInt(const char* p, const char* end, int32_t& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p >= end || !IsDigit(*p)) {
+        return nullptr;
+    }
+    const char* digits_start = p;
+    int64_t value = 0;
+    for (; p < end && IsDigit(*p); ++p) {
+        value = value * 10 + (*p - '0');
+    }
+    if (p - digits_start > 10 || value > INT32_MAX) {
+        return nullptr;
+    }
+    out = static_cast<int32_t>(negative ? -value : value);
+    return p;
+}
+
+// OBJ indices are 1-based, or negative to count back from the latest element
+// Relative indices are stored against the chunk's own element count
+inline bool ResolveIndex(int32_t written, size_t local_count, int32_t& index, uint32_t& relative, uint32_t bit) {
+    if (written > 0) {
+        index = written - 1;
+        return true;
+    }
+    if (written < 0) {
+        index = static_cast<int32_t>(local_count) + written;
+        relative |= bit;
+        return true;
+    }
+    return false;
+}
+
+// Parse "v[/vt][/vn]"; returns nullptr if malformed
+const char* ParseCorner(const char* p, const char* end, const Chunk& chunk, Corner& corner) {
+    corner = Corner{ kMissing, kMissing, kMissing, 0 };
+    int32_t written = 0;
+    p = ParseInt(p, end, written);
+    if (!p || !ResolveIndex(written, chunk.positions.size(), corner.v, corner.relative, 1u)) {
+        return nullptr;
+    }
+    if (p < end && *p == '/') {
+        ++p;
+        if (p < end && *p != '/') {
+            p = ParseInt(p, end, written);
+            if (!p || !ResolveIndex(written, chunk.tex_coords.size(), corner.vt, corner.relative, 2u)) {
+                return nullptr;
+            }
+        }
+        if (p < end && *p == '/') {
+            ++p;
+            p = ParseInt(p, end, written);
+            if (!p || !ResolveIndex(written, chunk.normals.size(), corner.vn, corner.relative, 4u)) {
+                return nullptr;
+            }
+        }
+    }
+    return p;
+}
+
+// Parse floats into the first `count` components of out; extra values (e.g. w) are skipped
+bool ParseFloats(const char* p, const char* end, float* out, int required, int count) {
+    for (int i = 0; i < count; ++i) {
+        p = SkipSpaces(p, end);
+        if (p >= end) {
+            return i >= required;
+        }
+        p = ParseFloat(p, end, out[i]);
+        if (!p) {
+            return i >= required;
+        }
+    }
+    return true;
+}
+
+void ParseChunk(Chunk& chunk) {
+    const char* line = chunk.begin;
+    const size_t estimated_lines = static_cast<size_t>(chunk.end - chunk.begin) / 32;
+    chunk.positions.reserve(estimated_lines / 3);
+    chunk.corners.reserve(estimated_lines * 2);
+
+    Corner polygon[2];
+    while (line < chunk.end) {
+        const char* line_end = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(chunk.end - line)));
+        if (!line_end) {
+            line_end = chunk.end;
+        }
+        const char* p = SkipSpaces(line, line_end);
+        if (line_end - p >= 2 && IsSpace(p[1]) && (*p == 'v' || *p == 'f')) {
+            if (*p == 'v') {
+                float xyz[3] = { 0.0f, 0.0f, 0.0f };
+                if (!ParseFloats(p + 2, line_end, xyz, 3, 3)) {
+                    chunk.error = line;
+                    return;
+                }
+                chunk.positions.emplace_back(xyz[0], xyz[1], xyz[2]);
+            } else {
+                // Polygon: fan of triangles around the first corner
+                p += 2;
+                int corner_count = 0;
+                for (;;) {
+                    p = SkipSpaces(p, line_end);
+                    if (p >= line_end) {
+                        break;
+                    }
+                    Corner corner;
+                    p = ParseCorner(p, line_end, chunk, corner);
+                    if (!p) {
+                        chunk.error = line;
+                        return;
+                    }
+                    if (corner_count < 2) {
+                        polygon[corner_count] = corner;
+                    } else {
+                        chunk.corners.push_back(polygon[0]);
+                        chunk.corners.push_back(polygon[1]);
+                        chunk.corners.push_back(corner);
+                        polygon[1] = corner;
+                    }
+                    ++corner_count;
+                }
+                if (corner_count < 3) {
+                    chunk.error = line;
+                    return;
+                }
+            }
+        } else if (line_end - p >= 3 && p[0] == 'v' && (p[1] == 't' || p[1] == 'n') && IsSpace(p[2])) {
+            float values[3] = { 0.0f, 0.0f, 0.0f };
+            if (p[1] == 't') {
+                if (!ParseFloats(p + 3, line_end, values, 1, 2)) {
+                    chunk.error = line;
+                    return;
+                }
+                chunk.tex_coords.emplace_back(values[0], values[1]);
+            } else {
+                if (!ParseFloats(p + 3, line_end, values, 3, 3)) {
+                    chunk.error = line;
+                    return;
+                }
+                chunk.normals.emplace_back(values[0], values[1], values[2]);
+            }
+        }
+        line = line_end + 1;
+    }
+}
+
+template <typename T>
+void Concatenate(std::vector<Chunk>& chunks, std::vector<T> Chunk::*member, const std::vector<size_t>& offsets,
+                 std::vector<T>& out) {
+    out.resize(offsets.back());
+    ThreadPool::Global().ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::vector<T>& source = chunks[i].*member;
+            std::copy(source.begin(), source.end(), out.begin() + offsets[i]);
+            std::vector<T>().swap(source);
+        }
+    });
+}
+
+}  // namespace
+
+bool ObjLoader::Parse(const char* text, size_t size, ObjMesh& mesh) {
+    mesh = ObjMesh();
+    ThreadPool& pool = ThreadPool::Global();
+
+    // Line-aligned chunks: each boundary moves forward to just after a newline
+    std::vector<Chunk> chunks;
+    const char* text_end = text + size;
+    for (const char* begin = text; begin < text_end;) {
+        const char* end = begin + std::min(kChunkSize, static_cast<size_t>(text_end - begin));
+        if (end < text_end) {
+            const char* newline = static_cast<const char*>(std::memchr(end, '\n', static_cast<size_t>(text_end - end)));
+            end = newline ? newline + 1 : text_end;
+        }
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.push_back(std::move(chunk));
+        begin = end;
+    }
+    if (chunks.empty()) {
+        return true;
+    }
+
+    pool.ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ParseChunk(chunks[i]);
+        }
+    });
+    for (const Chunk& chunk : chunks) {
+        if (chunk.error) {
+            size_t line_number = 1 + std::count(text, chunk.error, '\n');
+            grassland::LogError("OBJ parse error at line {}", line_number);
+            return false;
+        }
+    }
+
+    // Element offsets of each chunk
+    const size_t chunk_count = chunks.size();
+    std::vector<size_t> position_offsets(chunk_count + 1, 0);
+    std::vector<size_t> normal_offsets(chunk_count + 1, 0);
+    std::vector<size_t> tex_coord_offsets(chunk_count + 1, 0);
+    std::vector<size_t> corner_offsets(chunk_count + 1, 0);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        position_offsets[i + 1] = position_offsets[i] + chunks[i].positions.size();
+        normal_offsets[i + 1] = normal_offsets[i] + chunks[i].normals.size();
+        tex_coord_offsets[i + 1] = tex_coord_offsets[i] + chunks[i].tex_coords.size();
+        corner_offsets[i + 1] = corner_offsets[i] + chunks[i].corners.size();
+    }
+    const size_t position_count = position_offsets.back();
+    const size_t normal_count = normal_offsets.back();
+    const size_t tex_coord_count = tex_coord_offsets.back();
+    const size_t corner_count = corner_offsets.back();
+    if (position_count > static_cast<size_t>(INT32_MAX) || corner_count > static_cast<size_t>(UINT32_MAX)) {
+        grassland::LogError("OBJ too large ({} vertices, {} face corners)", position_count, corner_count);
+        return false;
+    }
+
+    // Resolve relative indices to global ones in place and check ranges
+    std::atomic<bool> out_of_range{ false };
+    pool.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+        auto resolve = [](int32_t& index, bool relative, size_t offset, size_t count) {
+            if (index == kMissing) {
+                return true;
+            }
+            int64_t global = relative ? static_cast<int64_t>(offset) + index : index;
+            index = static_cast<int32_t>(global);
+            return global >= 0 && global < static_cast<int64_t>(count);
+        };
+        for (size_t i = begin; i < end; ++i) {
+            bool valid = true;
+            for (Corner& corner : chunks[i].corners) {
+                valid &= resolve(corner.v, corner.relative & 1u, position_offsets[i], position_count);
+                valid &= resolve(corner.vt, corner.relative & 2u, tex_coord_offsets[i], tex_coord_count);
+                valid &= resolve(corner.vn, corner.relative & 4u, normal_offsets[i], normal_count);
+            }
+            if (!valid) {
+                out_of_range = true;
+            }
+        }
+    });
+    if (out_of_range) {
+        grassland::LogError("OBJ face references a vertex that does not exist");
+        return false;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> tex_coords;
+    Concatenate(chunks, &Chunk::positions, position_offsets, positions);
+    Concatenate(chunks, &Chunk::normals, normal_offsets, normals);
+    Concatenate(chunks, &Chunk::tex_coords, tex_coord_offsets, tex_coords);
+
+    mesh.indices.resize(corner_count);
+    if (normals.empty() && tex_coords.empty()) {
+        // Positions only: the vertices are the positions
+        pool.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t* indices = mesh.indices.data() + corner_offsets[i];
+                for (const Corner& corner : chunks[i].corners) {
+                    *indices++ = static_cast<uint32_t>(corner.v);
+                }
+            }
+        });
+        mesh.positions = std::move(positions);
+        return true;
+    }
+
+    // Vertex i < position_count takes position i with the first uv/normal pair it is used
+    // with; other pairs for the same position are chained behind it as new vertices
+    struct VertexKey {
+        int32_t tex_coord;
+        int32_t normal;
+        int32_t next;  // Next vertex with the same position, -1: none, kUnused: not seen yet
+    };
+    const int32_t kUnused = kMissing + 1;
+    std::vector<VertexKey> keys(position_count, VertexKey{ kMissing, kMissing, kUnused });
+    std::vector<int32_t> added_positions;  // Position of each vertex past position_count
+    auto vertex_of = [&](const Corner& corner) {
+        int32_t vertex = corner.v;
+        VertexKey* key = &keys[vertex];
+        if (key->next == kUnused) {
+            *key = VertexKey{ corner.vt, corner.vn, -1 };
+            return vertex;
+        }
+        while (key->tex_coord != corner.vt || key->normal != corner.vn) {
+            if (key->next < 0) {
+                int32_t added = static_cast<int32_t>(keys.size());
+                key->next = added;
+                keys.push_back(VertexKey{ corner.vt, corner.vn, -1 });
+                added_positions.push_back(corner.v);
+                return added;
+            }
+            vertex = key->next;
+            key = &keys[vertex];
+        }
+        return vertex;
+    };
+    uint32_t* indices = mesh.indices.data();
+    for (const Chunk& chunk : chunks) {
+        for (const Corner& corner : chunk.corners) {
+            *indices++ = static_cast<uint32_t>(vertex_of(corner));
+        }
+    }
+    chunks.clear();
+
+    const size_t vertex_count = keys.size();
+    mesh.positions.resize(vertex_count);
+    if (!normals.empty()) {
+        mesh.normals.resize(vertex_count);
+    }
+    if (!tex_coords.empty()) {
+        mesh.tex_coords.resize(vertex_count);
+    }
+    pool.ParallelFor(vertex_count, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const VertexKey& key = keys[i];
+            mesh.positions[i] = positions[i < position_count ? i : added_positions[i - position_count]];
+            if (!normals.empty()) {
+                mesh.normals[i] = key.normal == kMissing ? glm::vec3(0.0f) : normals[key.normal];
+            }
+            if (!tex_coords.empty()) {
+                mesh.tex_coords[i] = key.tex_coord == kMissing ? glm::vec2(0.0f) : tex_coords[key.tex_coord];
+            }
+        }
+    });
+    return true;
+}
+
+bool ObjLoader::Load(const std::string& path, ObjMesh& mesh) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    return Parse(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), mesh);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "long_march.h"
+#include <string>
+#include <vector>
+
+// Triangle mesh read from an OBJ file, one vertex per distinct position/uv/normal
+// combination (positions are float3, three indices per triangle)
+// normals and tex_coords are empty when the file has none
+struct ObjMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> tex_coords;
+    std::vector<uint32_t> indices;
+};
+
+// Parallel OBJ parser
+// The text is split into line-aligned chunks that are parsed on the global
+// ThreadPool (lines are found with memchr, numbers with a hand-written parser
+// instead of strtod); the chunks are then concatenated and face corners with
+// distinct uv/normal indices become distinct vertices
+// Supports v/vt/vn and f with any of the v, v/vt, v//vn, v/vt/vn forms, negative
+// (relative) indices and polygons (fan-triangulated); other statements are skipped
+class ObjLoader {
+public:
+    // Parse OBJ text; returns false (with a logged error) on malformed faces
+    static bool Parse(const char* text, size_t size, ObjMesh& mesh);
+
+    // Map and parse an OBJ file
+    static bool Load(const std::string& path, ObjMesh& mesh);
+};
@@ -0,0 +1,35 @@
+#include "PfmWriter.h"
+#include "ThreadPool.h"
+
+#include <fstream>
+#include <vector>
+
+bool PfmWriter::Write(const std::string& path, const glm::vec4* pixels, int width, int height, ThreadPool& pool) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    // A negative scale marks little-endian data
+    std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0";
+    while ((header.size() + 1) % 16 != 0) {
+        header += '0';
+    }
+    header += '\n';
+
+    std::vector<float> data(static_cast<size_t>(width) * height * 3);
+    pool.ParallelFor(static_cast<size_t>(height), 16, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            const glm::vec4* row = pixels + (static_cast<size_t>(height) - 1 - y) * width;
+            float* out = data.data() + y * width * 3;
+            for (int x = 0; x < width; ++x) {
+                out[x * 3 + 0] = row[x].r;
+                out[x * 3 + 1] = row[x].g;
+                out[x * 3 + 2] = row[x].b;
+            }
+        }
+    });
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)));
+    return static_cast<bool>(file);
+}
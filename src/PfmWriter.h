@@ -0,0 +1,16 @@
+#pragma once
+#include "long_march.h"
+#include "ThreadPool.h"
+#include <string>
+
+// Portable float map (.pfm) writer: a short text header followed by raw little-endian
+// RGB floats, rows bottom to top, so readers can memory-map the file and use the
+// pixels in place
+// The header's scale is padded with zeros so the pixel data starts 16-byte aligned
+class PfmWriter {
+public:
+    // Write width * height RGBA pixels (rows top to bottom, alpha dropped) to path; rows
+    // are converted in parallel on pool
+    static bool Write(const std::string& path, const glm::vec4* pixels, int width, int height,
+                      ThreadPool& pool = ThreadPool::Global());
+};
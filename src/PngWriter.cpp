@@ -0,0 +1,371 @@
+#include "PngWriter.h"
+#include "StbZlib.h"
+#include "ThreadPool.h"
+#include "long_march.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+
+namespace {
+
+constexpr uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// stb_image_write's quality (twice the length of its hash chains) per PngCompression;
+// it does not go below 5
+constexpr int kFastQuality = 5;
+constexpr int kDefaultQuality = 8;
+
+enum FilterType {
+    kFilterNone,
+    kFilterSub,
+    kFilterUp,
+    kFilterAverage,
+    kFilterPaeth,
+    kFilterCount,
+};
+
+int PaethPredictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Filter one row of size bytes; prior is the row above (zeros for the first row)
+template <int Type>
+void FilterRow(const uint8_t* row, const uint8_t* prior, size_t size, size_t bpp, uint8_t* out) {
+    for (size_t i = 0; i < size; ++i) {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int b = prior[i];
+        int c = i >= bpp ? prior[i - bpp] : 0;
+        int prediction = Type == kFilterNone      ? 0
+                         : Type == kFilterSub     ? a
+                         : Type == kFilterUp      ? b
+                         : Type == kFilterAverage ? (a + b) / 2
+                                                  : PaethPredictor(a, b, c);
+        out[i] = static_cast<uint8_t>(row[i] - prediction);
+    }
+}
+
+using FilterFunction = void (*)(const uint8_t*, const uint8_t*, size_t, size_t, uint8_t*);
+constexpr FilterFunction kFilters[kFilterCount] = {
+    FilterRow<kFilterNone>, FilterRow<kFilterSub>, FilterRow<kFilterUp>, FilterRow<kFilterAverage>, FilterRow<kFilterPaeth>,
+};
+
+// Estimate of how well a filtered row compresses (smaller is better): the sum of its
+// bytes as signed values, the heuristic of the PNG specification and stb_image_write
+uint32_t FilterCost(const uint8_t* filtered, size_t size) {
+    uint32_t cost = 0;
+    for (size_t i = 0; i < size; ++i) {
+        cost += static_cast<uint32_t>(std::abs(static_cast<int>(static_cast<int8_t>(filtered[i]))));
+    }
+    return cost;
+}
+
+uint32_t ReverseBits(uint32_t value, int count) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < count; ++i) {
+        reversed = (reversed << 1) | ((value >> i) & 1);
+    }
+    return reversed;
+}
+
+// The next count (<= 24) bits of a deflate stream starting at bit, in stream order
+// (deflate fills each byte from its least significant bit); zeros past the end
+uint32_t PeekBits(const uint8_t* data, size_t size, size_t bit, int count) {
+    size_t byte = bit >> 3;
+    uint32_t bits = 0;
+    for (size_t i = 0; i < 4 && byte + i < size; ++i) {
+        bits |= static_cast<uint32_t>(data[byte + i]) << (8 * i);
+    }
+    return (bits >> (bit & 7)) & ((1u << count) - 1);
+}
+
+// Symbol and length of deflate's fixed literal/length Huffman code (RFC 1951 3.2.6),
+// indexed by the next 9 bits of the stream
+struct FixedCode {
+    uint16_t symbol;
+    uint8_t length;
+};
+
+const std::array<FixedCode, 512>& GetFixedCodes() {
+    static const std::array<FixedCode, 512> codes = [] {
+        std::array<FixedCode, 512> table{};
+        auto add = [&table](int first, int last, uint32_t first_code, int length) {
+            for (int symbol = first; symbol <= last; ++symbol) {
+                // Huffman codes are packed starting from their most significant bit
+                uint32_t code = ReverseBits(first_code + static_cast<uint32_t>(symbol - first), length);
+                for (uint32_t rest = 0; rest < (1u << (9 - length)); ++rest) {
+                    table[code | (rest << length)] = { static_cast<uint16_t>(symbol), static_cast<uint8_t>(length) };
+                }
+            }
+        };
+        add(0, 143, 0x30, 8);
+        add(144, 255, 0x190, 9);
+        add(256, 279, 0x00, 7);
+        add(280, 287, 0xC0, 8);
+        return table;
+    }();
+    return codes;
+}
+
+// Bit position just past the end-of-block code of a deflate stream holding one
+// fixed-Huffman block; false if the stream is malformed
+bool FindFixedBlockEnd(const uint8_t* data, size_t size, size_t& end_bit) {
+    static constexpr uint8_t kLengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static constexpr uint8_t kDistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const std::array<FixedCode, 512>& codes = GetFixedCodes();
+    const size_t bit_count = size * 8;
+    size_t bit = 3;  // BFINAL and BTYPE
+    while (bit < bit_count) {
+        FixedCode code = codes[PeekBits(data, size, bit, 9)];
+        bit += code.length;
+        if (code.symbol == 256) {
+            end_bit = bit;
+            return bit <= bit_count;
+        }
+        if (code.symbol > 256) {
+            if (code.symbol > 285) {
+                return false;
+            }
+            bit += kLengthExtraBits[code.symbol - 257];
+            uint32_t distance_code = ReverseBits(PeekBits(data, size, bit, 5), 5);
+            if (distance_code >= 30) {
+                return false;
+            }
+            bit += 5 + kDistanceExtraBits[distance_code];
+        }
+    }
+    return false;
+}
+
+// Turn the deflate stream of stbi_zlib_compress at data[begin, end) into the non-final
+// part of a longer stream: clear BFINAL of its last block and, after a fixed-Huffman
+// block, append an empty stored block so the next part starts on a byte boundary
+bool EndWithSyncFlush(std::vector<uint8_t>& data, size_t begin) {
+    uint8_t* deflate = data.data() + begin;
+    const size_t size = data.size() - begin;
+    if (size == 0) {
+        return false;
+    }
+    if (((deflate[0] >> 1) & 3) == 1) {
+        size_t end_bit = 0;
+        if (!FindFixedBlockEnd(deflate, size, end_bit)) {
+            return false;
+        }
+        deflate[0] &= ~1;
+        // The stored block's header (BFINAL = 0, BTYPE = 00) is 3 zero bits, which the
+        // padding after the end-of-block code provides unless fewer bits are left
+        if ((8 - end_bit % 8) % 8 < 3) {
+            data.push_back(0);
+        }
+        data.insert(data.end(), { 0x00, 0x00, 0xFF, 0xFF });  // LEN = 0, NLEN = ~LEN
+        return true;
+    }
+    // stb falls back to stored blocks when compression does not pay off; those already
+    // end on a byte boundary
+    for (size_t block = 0; block + 5 <= size;) {
+        if (deflate[block] & 1) {
+            deflate[block] &= ~1;
+            return true;
+        }
+        block += 5 + (deflate[block + 1] | (static_cast<size_t>(deflate[block + 2]) << 8));
+    }
+    return false;
+}
+
+// Adler-32 of the concatenation of two byte sequences from their checksums and the
+// second one's length (as zlib's adler32_combine)
+uint32_t CombineAdler32(uint32_t first, uint32_t second, size_t second_size) {
+    constexpr uint32_t kBase = 65521;
+    uint32_t remainder = static_cast<uint32_t>(second_size % kBase);
+    uint32_t sum1 = first & 0xFFFF;
+    uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * sum1) % kBase);
+    sum1 += (second & 0xFFFF) + kBase - 1;
+    sum2 += (first >> 16) + (second >> 16) + kBase - remainder;
+    sum1 %= kBase;
+    sum2 %= kBase;
+    return sum1 | (sum2 << 16);
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void PushBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.insert(out.end(), { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                            static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) });
+}
+
+// Start a chunk with a placeholder length; returns where it starts for EndChunk
+size_t BeginChunk(std::vector<uint8_t>& out, const char* type) {
+    size_t start = out.size();
+    PushBigEndian(out, 0);
+    out.insert(out.end(), type, type + 4);
+    return start;
+}
+
+// Fill in the length and append the CRC of the type and data
+void EndChunk(std::vector<uint8_t>& out, size_t start) {
+    uint32_t length = static_cast<uint32_t>(out.size() - start - 8);
+    for (int i = 0; i < 4; ++i) {
+        out[start + i] = static_cast<uint8_t>(length >> (24 - 8 * i));
+    }
+    PushBigEndian(out, Crc32(out.data() + start + 4, length + 4));
+}
+
+// One strip of rows, compressed into its own IDAT chunk
+struct Strip {
+    std::vector<uint8_t> chunk;
+    uint32_t adler = 1;  // Of the filtered data
+    size_t size = 0;     // Filtered bytes
+    bool valid = false;
+};
+
+void EncodeStrip(const uint8_t* pixels, int width, int channels, int row_begin, int row_end,
+                 PngCompression compression, bool first, bool last, Strip& strip) {
+    const size_t row_bytes = static_cast<size_t>(width) * channels;
+    const size_t bpp = static_cast<size_t>(channels);
+    const std::vector<uint8_t> zero_row(row_bytes, 0);
+    std::vector<uint8_t> filtered((row_bytes + 1) * static_cast<size_t>(row_end - row_begin));
+    std::vector<uint8_t> candidates(compression == PngCompression::kFast ? 0 : row_bytes * kFilterCount);
+    for (int y = row_begin; y < row_end; ++y) {
+        const uint8_t* row = pixels + row_bytes * y;
+        const uint8_t* prior = y > 0 ? row - row_bytes : zero_row.data();
+        uint8_t* out = filtered.data() + (row_bytes + 1) * static_cast<size_t>(y - row_begin);
+        if (compression == PngCompression::kFast) {
+            out[0] = kFilterPaeth;
+            kFilters[kFilterPaeth](row, prior, row_bytes, bpp, out + 1);
+            continue;
+        }
+        int best = kFilterNone;
+        uint32_t best_cost = UINT32_MAX;
+        for (int type = 0; type < kFilterCount; ++type) {
+            uint8_t* candidate = candidates.data() + row_bytes * type;
+            kFilters[type](row, prior, row_bytes, bpp, candidate);
+            uint32_t cost = FilterCost(candidate, row_bytes);
+            if (cost < best_cost) {
+                best = type;
+                best_cost = cost;
+            }
+        }
+        out[0] = static_cast<uint8_t>(best);
+        std::copy_n(candidates.data() + row_bytes * best, row_bytes, out + 1);
+    }
+
+    int zlib_size = 0;
+    std::unique_ptr<unsigned char, decltype(&std::free)> zlib(
+        stbi_zlib_compress(filtered.data(), static_cast<int>(filtered.size()), &zlib_size,
+                           compression == PngCompression::kFast ? kFastQuality : kDefaultQuality),
+        &std::free);
+    if (!zlib || zlib_size < 6) {
+        return;
+    }
+    // zlib stream: 2-byte header, deflate data, big-endian Adler-32
+    const unsigned char* trailer = zlib.get() + zlib_size - 4;
+    strip.adler = (static_cast<uint32_t>(trailer[0]) << 24) | (static_cast<uint32_t>(trailer[1]) << 16) |
+                  (static_cast<uint32_t>(trailer[2]) << 8) | trailer[3];
+    strip.size = filtered.size();
+
+    size_t start = BeginChunk(strip.chunk, "IDAT");
+    if (first) {
+        strip.chunk.insert(strip.chunk.end(), zlib.get(), zlib.get() + 2);
+    }
+    size_t deflate_begin = strip.chunk.size();
+    strip.chunk.insert(strip.chunk.end(), zlib.get() + 2, zlib.get() + zlib_size - 4);
+    if (!last && !EndWithSyncFlush(strip.chunk, deflate_begin)) {
+        return;
+    }
+    EndChunk(strip.chunk, start);
+    strip.valid = true;
+}
+
+}  // namespace
+
+std::vector<uint8_t> PngWriter::Encode(const uint8_t* pixels, int width, int height, int channels,
+                                       PngCompression compression, ThreadPool& pool) {
+    static constexpr uint8_t kColorTypes[5] = { 0, 0, 4, 2, 6 };  // By channel count
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        grassland::LogError("Cannot encode a {}x{} PNG with {} channels", width, height, channels);
+        return {};
+    }
+
+    const size_t filtered_row_bytes = static_cast<size_t>(width) * channels + 1;
+    const int rows_per_strip = static_cast<int>(std::min<size_t>(
+        std::max<size_t>(1, kStripBytes / filtered_row_bytes), static_cast<size_t>(height)));
+    const size_t strip_count = (static_cast<size_t>(height) + rows_per_strip - 1) / rows_per_strip;
+    std::vector<Strip> strips(strip_count);
+    pool.ParallelFor(strip_count, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            int row_begin = static_cast<int>(s) * rows_per_strip;
+            int row_end = std::min(row_begin + rows_per_strip, height);
+            EncodeStrip(pixels, width, channels, row_begin, row_end, compression, s == 0, s + 1 == strip_count, strips[s]);
+        }
+    });
+
+    size_t size = sizeof(kSignature) + 25 + 16 + 12;  // Signature, IHDR, Adler-32 IDAT, IEND
+    uint32_t adler = strips[0].adler;
+    for (size_t s = 0; s < strip_count; ++s) {
+        if (!strips[s].valid) {
+            grassland::LogError("Failed to compress PNG strip {} of {}", s, strip_count);
+            return {};
+        }
+        if (s > 0) {
+            adler = CombineAdler32(adler, strips[s].adler, strips[s].size);
+        }
+        size += strips[s].chunk.size();
+    }
+
+    std::vector<uint8_t> png;
+    png.reserve(size);
+    png.insert(png.end(), kSignature, kSignature + sizeof(kSignature));
+    size_t start = BeginChunk(png, "IHDR");
+    PushBigEndian(png, static_cast<uint32_t>(width));
+    PushBigEndian(png, static_cast<uint32_t>(height));
+    png.insert(png.end(), { 8, kColorTypes[channels], 0, 0, 0 });  // Bit depth, color type, deflate, adaptive filters, no interlace
+    EndChunk(png, start);
+    for (const Strip& strip : strips) {
+        png.insert(png.end(), strip.chunk.begin(), strip.chunk.end());
+    }
+    // The zlib trailer gets an IDAT of its own, so the strips' CRCs need not wait for it
+    start = BeginChunk(png, "IDAT");
+    PushBigEndian(png, adler);
+    EndChunk(png, start);
+    EndChunk(png, BeginChunk(png, "IEND"));
+    return png;
+}
+
+bool PngWriter::Write(const std::string& path, const uint8_t* pixels, int width, int height, int channels,
+                      PngCompression compression, ThreadPool& pool) {
+    std::vector<uint8_t> png = Encode(pixels, width, height, channels, compression, pool);
+    if (png.empty()) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "ThreadPool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Speed / size trade-off of PngWriter
+enum class PngCompression {
+    kFast,     // Paeth filter on every row, shortest match search
+    kDefault,  // Best filter chosen per row and stb_image_write's default match search
+};
+
+// Parallel PNG encoder built on stb_image_write's deflate
+// The image is cut into strips of whole rows (about kStripBytes of filtered data each)
+// that are filtered and compressed independently on a ThreadPool; each strip's
+// deflate data is made non-final and ended with an empty stored block (a sync flush),
+// so concatenated they form one valid zlib stream. Strips become separate IDAT chunks,
+// which lets their CRCs be computed in parallel too, and the strips' Adler-32 checksums
+// are combined at the end
+// Output does not depend on the number of threads; strips do not reference each
+// other's data, which costs a little compression on small images
+class PngWriter {
+public:
+    // PNG file of 8-bit pixels with channels (1-4: gray, gray + alpha, RGB, RGBA)
+    // interleaved components, rows stored top to bottom without padding
+    // Strips run on pool; background encoders pass their own so they stay off the render cores
+    static std::vector<uint8_t> Encode(const uint8_t* pixels, int width, int height, int channels,
+                                       PngCompression compression = PngCompression::kDefault,
+                                       ThreadPool& pool = ThreadPool::Global());
+
+    // Encode and write to path; returns false if the file cannot be written
+    static bool Write(const std::string& path, const uint8_t* pixels, int width, int height, int channels,
+                      PngCompression compression = PngCompression::kDefault, ThreadPool& pool = ThreadPool::Global());
+
+private:
+    static constexpr size_t kStripBytes = 256 * 1024;
+};
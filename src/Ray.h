@@ -0,0 +1,108 @@
+#pragma once
+#include "long_march.h"
+#include <cstdint>
+#include <limits>
+
+// Sentinel used for "no hit" instance and primitive IDs (matches the 0xFFFFFFFF in MissMain)
+constexpr uint32_t kInvalidId = 0xFFFFFFFFu;
+
+// CPU equivalent of the HLSL RayDesc
+struct Ray {
+    glm::vec3 origin;
+    float t_min;
+    glm::vec3 direction;
+    float t_max;
+};
+
+// Closest hit found during CPU traversal
+struct HitRecord {
+    float t;
+    float u;                // Barycentrics, as in BuiltInTriangleIntersectionAttributes
+    float v;
+    uint32_t primitive_id;  // Triangle index within the mesh
+    uint32_t instance_id;   // instanceCustomIndex of the hit instance (kInvalidId on miss)
+
+    HitRecord()
+        : t(std::numeric_limits<float>::infinity())
+        , u(0.0f)
+        , v(0.0f)
+        , primitive_id(kInvalidId)
+        , instance_id(kInvalidId) {}
+
+    bool IsHit() const { return instance_id != kInvalidId; }
+};
+
+// Axis-aligned bounding box
+struct Aabb {
+    glm::vec3 lower;
+    glm::vec3 upper;
+
+    Aabb()
+        : lower(std::numeric_limits<float>::infinity())
+        , upper(-std::numeric_limits<float>::infinity()) {}
+
+    Aabb(const glm::vec3& lo, const glm::vec3& hi)
+        : lower(lo)
+        , upper(hi) {}
+
+    void Expand(const glm::vec3& p) {
+        lower = glm::min(lower, p);
+        upper = glm::max(upper, p);
+    }
+
+    void Expand(const Aabb& other) {
+        lower = glm::min(lower, other.lower);
+        upper = glm::max(upper, other.upper);
+    }
+
+    bool IsEmpty() const { return lower.x > upper.x; }
+
+    glm::vec3 Center() const { return (lower + upper) * 0.5f; }
+
+    glm::vec3 Extent() const { return upper - lower; }
+
+    // Half of the surface area (enough for SAH ratios)
+    float HalfArea() const {
+        if (IsEmpty()) {
+            return 0.0f;
+        }
+        glm::vec3 e = Extent();
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    int LongestAxis() const {
+        glm::vec3 e = Extent();
+        if (e.x >= e.y && e.x >= e.z) return 0;
+        return e.y >= e.z ? 1 : 2;
+    }
+};
+
+// Slab test against a box; returns the entry distance or +inf when missed
+inline float IntersectAabb(const Aabb& box, const glm::vec3& origin, const glm::vec3& inv_direction, float t_min, float t_max) {
+    glm::vec3 t0 = (box.lower - origin) * inv_direction;
+    glm::vec3 t1 = (box.upper - origin) * inv_direction;
+    glm::vec3 t_near = glm::min(t0, t1);
+    glm::vec3 t_far = glm::max(t0, t1);
+    float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, t_min));
+    float exit = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, t_max));
+    return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+// Reciprocal direction with zero components pushed to a huge finite value,
+// so the slab test never computes 0 * inf
+inline glm::vec3 SafeInverse(const glm::vec3& d) {
+    const float big = 1e30f;
+    return glm::vec3(
+        d.x != 0.0f ? 1.0f / d.x : big,
+        d.y != 0.0f ? 1.0f / d.y : big,
+        d.z != 0.0f ? 1.0f / d.z : big);
+}
+
+// Transform helpers for the mat4x3 instance transforms used by the TLAS
+inline glm::vec3 TransformPoint(const glm::mat4x3& m, const glm::vec3& p) {
+    return m * glm::vec4(p, 1.0f);
+}
+
+inline glm::vec3 TransformVector(const glm::mat4x3& m, const glm::vec3& v) {
+    return m * glm::vec4(v, 0.0f);
+}
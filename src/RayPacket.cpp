@@ -0,0 +1,122 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+
+namespace {
+
+// Corner directions are pushed this fraction further away from the packet center
+// before building the planes, so rays on the frustum boundary are never culled by rounding
+constexpr float kFrustumMargin = 0.01f;
+
+// Packets whose corner rays are more than ~60 degrees away from the center ray are
+// treated as divergent; a frustum that wide culls almost nothing
+constexpr float kMinCornerCosine = 0.5f;
+
+}  // namespace
+
+Ray RayPacket::GetRay(int index, float t_max) const {
+    Ray ray;
+    ray.origin = origin;
+    ray.direction = glm::vec3(direction_x[index], direction_y[index], direction_z[index]);
+    ray.t_min = t_min;
+    ray.t_max = t_max;
+    return ray;
+}
+
+RayPacket RayPacket::Transformed(const glm::mat4x3& transform) const {
+    RayPacket result;
+    result.origin = TransformPoint(transform, origin);
+    result.t_min = t_min;
+    result.width = width;
+    result.height = height;
+    const int count = GetRayCount();
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 d = TransformVector(transform, glm::vec3(direction_x[i], direction_y[i], direction_z[i]));
+        result.direction_x[i] = d.x;
+        result.direction_y[i] = d.y;
+        result.direction_z[i] = d.z;
+    }
+    for (int c = 0; c < 4; ++c) {
+        result.corner_directions[c] = TransformVector(transform, corner_directions[c]);
+    }
+    return result;
+}
+
+void PacketHits::Reset(int count, float t_max) {
+    for (int i = 0; i < count; ++i) {
+        t[i] = t_max;
+        u[i] = 0.0f;
+        v[i] = 0.0f;
+        primitive_id[i] = kInvalidId;
+        instance_id[i] = kInvalidId;
+    }
+}
+
+HitRecord PacketHits::GetHit(int index) const {
+    HitRecord hit;
+    if (instance_id[index] != kInvalidId) {
+        hit.t = t[index];
+        hit.u = u[index];
+        hit.v = v[index];
+        hit.primitive_id = primitive_id[index];
+        hit.instance_id = instance_id[index];
+    }
+    return hit;
+}
+
+bool RayFrustum::Build(const RayPacket& packet, RayFrustum& frustum) {
+    if (packet.width < 2 || packet.height < 2) {
+        return false;
+    }
+
+    auto direction = [&](int index) {
+        return glm::vec3(packet.direction_x[index], packet.direction_y[index], packet.direction_z[index]);
+    };
+    const int count = packet.GetRayCount();
+
+    // Directions of a planar block of pixels span the cone of its corners
+    glm::vec3 corners[4];
+    glm::vec3 center(0.0f);
+    for (int c = 0; c < 4; ++c) {
+        corners[c] = glm::normalize(packet.corner_directions[c]);
+        center += corners[c];
+    }
+    center = glm::normalize(center);
+    for (int c = 0; c < 4; ++c) {
+        if (glm::dot(corners[c], center) < kMinCornerCosine) {
+            return false;
+        }
+        corners[c] += (corners[c] - center) * kFrustumMargin;
+    }
+    frustum.spread = std::max(glm::length(corners[0] - corners[2]), glm::length(corners[1] - corners[3]));
+
+    for (int c = 0; c < 4; ++c) {
+        glm::vec3 normal = glm::cross(corners[c], corners[(c + 1) % 4]);
+        if (glm::dot(normal, center) < 0.0f) {
+            normal = -normal;
+        }
+        frustum.planes[c] = glm::vec4(normal, -glm::dot(normal, packet.origin));
+    }
+
+    frustum.max_direction_length = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        frustum.max_direction_length = std::max(frustum.max_direction_length, glm::length(direction(i)));
+    }
+    return true;
+}
+
+bool RayFrustum::Overlaps(const Aabb& box, const glm::vec3& origin, float t_max) const {
+    for (const glm::vec4& plane : planes) {
+        // Corner of the box farthest along the plane normal
+        glm::vec3 p(
+            plane.x >= 0.0f ? box.upper.x : box.lower.x,
+            plane.y >= 0.0f ? box.upper.y : box.lower.y,
+            plane.z >= 0.0f ? box.upper.z : box.lower.z);
+        if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    glm::vec3 offset = glm::max(glm::max(box.lower - origin, origin - box.upper), glm::vec3(0.0f));
+    float reach = t_max * max_direction_length;
+    return glm::dot(offset, offset) <= reach * reach;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Ray.h"
+
+// Up to 64 rays sharing one origin, such as the primary rays of an 8x8 pixel block
+// Directions are stored as structure-of-arrays so leaves test kLanes rays per instruction
+// Rays are laid out row-major over a width x height block; the rays may be jittered
+// inside their pixels, so the frustum used for culling is spanned by the directions
+// through the block's outer corners instead of by the corner rays
+struct RayPacket {
+    static constexpr int kMaxRays = 64;
+    static constexpr int kLanes = 8;
+
+    glm::vec3 origin;
+    float t_min;
+    int width;
+    int height;
+    alignas(32) float direction_x[kMaxRays];
+    alignas(32) float direction_y[kMaxRays];
+    alignas(32) float direction_z[kMaxRays];
+    glm::vec3 corner_directions[4];  // Top-left, top-right, bottom-right, bottom-left
+
+    int GetRayCount() const { return width * height; }
+    Ray GetRay(int index, float t_max) const;
+
+    // Same packet with origin and directions mapped by an affine transform
+    // (directions are not renormalized, so t keeps its meaning)
+    RayPacket Transformed(const glm::mat4x3& transform) const;
+};
+
+// Closest hits of a packet; t starts out as each ray's t_max
+struct PacketHits {
+    alignas(32) float t[RayPacket::kMaxRays];
+    alignas(32) float u[RayPacket::kMaxRays];
+    alignas(32) float v[RayPacket::kMaxRays];
+    alignas(32) uint32_t primitive_id[RayPacket::kMaxRays];
+    alignas(32) uint32_t instance_id[RayPacket::kMaxRays];
+
+    void Reset(int count, float t_max);
+    HitRecord GetHit(int index) const;
+};
+
+// Pyramid through the packet origin that contains every ray of the packet
+// A box outside any of the four planes cannot be hit by any ray
+struct RayFrustum {
+    glm::vec4 planes[4];          // xyz: inward normal, w: offset; inside when dot(n, p) + w >= 0
+    float max_direction_length;   // Longest direction in the packet, to turn distances into t
+    float spread;                 // Width of the packet per unit of distance from the origin
+
+    // Fails when the packet is too small or too wide to bound with four planes
+    static bool Build(const RayPacket& packet, RayFrustum& frustum);
+
+    // Box overlaps the frustum and is closer than t_max along the longest ray
+    bool Overlaps(const Aabb& box, const glm::vec3& origin, float t_max) const;
+};
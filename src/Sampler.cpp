@@ -0,0 +1,332 @@
+#include "Sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t HashCombine(uint32_t seed, uint32_t value) {
+    return Hash(seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+}
+
+uint32_t ReverseBits(uint32_t v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+    v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+// Owen scrambling of a bit-reversed value: a hash in which every bit is flipped depending
+// only on the bits below it, i.e. on the more significant bits of the unreversed value
+// (Laine-Karras permutation with the constants of Burley 2020)
+uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed) {
+    x ^= x * 0x3d20adeau;
+    x += seed;
+    x *= (seed >> 16) | 1;
+    x ^= x * 0x05526c56u;
+    x ^= x * 0x53a22864u;
+    return x;
+}
+
+float ToUnitFloat(uint32_t x) {
+    // Top 24 bits, so the result is exactly representable and strictly below 1
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Primitive polynomials and initial direction numbers of Sobol dimensions 1.. (Joe & Kuo);
+// dimension 0 is the van der Corput sequence
+struct SobolPolynomial {
+    uint32_t degree;
+    uint32_t coefficients;  // Inner coefficients a_1..a_{s-1}, highest first
+    uint32_t m[6];
+};
+
+constexpr SobolPolynomial kSobolPolynomials[Sampler::kTableDimensions - 1] = {
+    { 1, 0, { 1 } },
+    { 2, 1, { 1, 3 } },
+    { 3, 1, { 1, 3, 1 } },
+    { 3, 2, { 1, 1, 1 } },
+    { 4, 1, { 1, 1, 3, 3 } },
+    { 4, 4, { 1, 3, 5, 13 } },
+    { 5, 2, { 1, 1, 5, 5, 17 } },
+    { 5, 4, { 1, 1, 5, 5, 5 } },
+    { 5, 7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6, 1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+};
+
+// Generator matrices as 32 column vectors per dimension, most significant bit first,
+// expanded into the XOR of the columns selected by every byte of the index so a point
+// takes four lookups instead of a 32-step loop with unpredictable branches
+// Index and result are both bit-reversed, which is the order the Owen scrambles before
+// and after the lookup work in, so neither needs reversing in between
+struct SobolTable {
+    uint32_t byte_tables[Sampler::kTableDimensions][4][256];
+
+    SobolTable() {
+        uint32_t matrices[Sampler::kTableDimensions][32];
+        for (int bit = 0; bit < 32; ++bit) {
+            matrices[0][bit] = 1u << (31 - bit);
+        }
+        for (int dimension = 1; dimension < Sampler::kTableDimensions; ++dimension) {
+            const SobolPolynomial& polynomial = kSobolPolynomials[dimension - 1];
+            const uint32_t s = polynomial.degree;
+            uint32_t* v = matrices[dimension];
+            for (uint32_t k = 0; k < s; ++k) {
+                v[k] = polynomial.m[k] << (31 - k);
+            }
+            // v_k = a_1 v_{k-1} ^ ... ^ a_{s-1} v_{k-s+1} ^ v_{k-s} ^ (v_{k-s} >> s)
+            for (uint32_t k = s; k < 32; ++k) {
+                v[k] = v[k - s] ^ (v[k - s] >> s);
+                for (uint32_t j = 1; j < s; ++j) {
+                    if ((polynomial.coefficients >> (s - 1 - j)) & 1) {
+                        v[k] ^= v[k - j];
+                    }
+                }
+            }
+        }
+
+        for (int dimension = 0; dimension < Sampler::kTableDimensions; ++dimension) {
+            for (int byte = 0; byte < 4; ++byte) {
+                for (uint32_t value = 0; value < 256; ++value) {
+                    uint32_t result = 0;
+                    for (int bit = 0; bit < 8; ++bit) {
+                        if ((value >> bit) & 1) {
+                            result ^= matrices[dimension][31 - (byte * 8 + bit)];
+                        }
+                    }
+                    byte_tables[dimension][byte][value] = ReverseBits(result);
+                }
+            }
+        }
+    }
+};
+
+const SobolTable& GetSobolTable() {
+    static const SobolTable* table = new SobolTable();
+    return *table;
+}
+
+// Ranks 0..N-1 of a kBlueNoiseSize^2 mask, by void-and-cluster (Ulichney): each new
+// point goes into the largest void of the points placed so far, so every threshold of
+// the mask is a well spread point set and neighboring values differ strongly
+class BlueNoiseMask {
+public:
+    static constexpr int kSize = Sampler::kBlueNoiseSize;
+    static constexpr int kCount = kSize * kSize;
+
+    uint32_t values[kCount];  // Rank scaled to the full 32-bit range
+
+    BlueNoiseMask() {
+        // Toroidal Gaussian footprint of one point
+        const float sigma = 1.5f;
+        for (int dy = -kRadius; dy <= kRadius; ++dy) {
+            for (int dx = -kRadius; dx <= kRadius; ++dx) {
+                kernel_[(dy + kRadius) * kKernelSide + dx + kRadius] =
+                    std::exp(-static_cast<float>(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            }
+        }
+
+        // Initial pattern of 10% of the cells at hashed positions, then relaxed by moving
+        // the point in the tightest cluster to the largest void until that is a no-op
+        std::vector<int> rank(kCount, -1);
+        std::fill(std::begin(occupied_), std::end(occupied_), false);
+        std::fill(std::begin(energy_), std::end(energy_), 0.0f);
+        int initial = kCount / 10;
+        for (uint32_t i = 0; CountOccupied() < initial; ++i) {
+            int cell = static_cast<int>(Hash(i) % kCount);
+            if (!occupied_[cell]) {
+                Toggle(cell);
+            }
+        }
+        for (int iteration = 0; iteration < kCount; ++iteration) {
+            int cluster = Extreme(true);
+            Toggle(cluster);
+            int void_cell = Extreme(false);
+            Toggle(void_cell);
+            if (void_cell == cluster) {
+                break;
+            }
+        }
+
+        // Ranks below the initial pattern: remove tightest clusters from a copy
+        bool initial_occupied[kCount];
+        float initial_energy[kCount];
+        std::memcpy(initial_occupied, occupied_, sizeof(occupied_));
+        std::memcpy(initial_energy, energy_, sizeof(energy_));
+        for (int r = initial - 1; r >= 0; --r) {
+            int cluster = Extreme(true);
+            Toggle(cluster);
+            rank[cluster] = r;
+        }
+        std::memcpy(occupied_, initial_occupied, sizeof(occupied_));
+        std::memcpy(energy_, initial_energy, sizeof(energy_));
+
+        // Ranks above it: fill the largest voids
+        for (int r = initial; r < kCount; ++r) {
+            int void_cell = Extreme(false);
+            Toggle(void_cell);
+            rank[void_cell] = r;
+        }
+
+        for (int i = 0; i < kCount; ++i) {
+            values[i] = static_cast<uint32_t>((static_cast<uint64_t>(rank[i]) << 32) / kCount);
+        }
+    }
+
+private:
+    static constexpr int kRadius = 6;
+    static constexpr int kKernelSide = 2 * kRadius + 1;
+
+    int CountOccupied() const {
+        return static_cast<int>(std::count(std::begin(occupied_), std::end(occupied_), true));
+    }
+
+    // Adds or removes a point and updates the energy of its neighborhood
+    void Toggle(int cell) {
+        occupied_[cell] = !occupied_[cell];
+        float sign = occupied_[cell] ? 1.0f : -1.0f;
+        int x = cell % kSize;
+        int y = cell / kSize;
+        for (int dy = -kRadius; dy <= kRadius; ++dy) {
+            int row = ((y + dy + kSize) % kSize) * kSize;
+            for (int dx = -kRadius; dx <= kRadius; ++dx) {
+                energy_[row + (x + dx + kSize) % kSize] += sign * kernel_[(dy + kRadius) * kKernelSide + dx + kRadius];
+            }
+        }
+    }
+
+    // Occupied cell with the highest energy (tightest cluster) or empty cell with the
+    // lowest (largest void)
+    int Extreme(bool cluster) const {
+        int best = -1;
+        for (int i = 0; i < kCount; ++i) {
+            if (occupied_[i] != cluster) {
+                continue;
+            }
+            if (best < 0 || (cluster ? energy_[i] > energy_[best] : energy_[i] < energy_[best])) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    float kernel_[kKernelSide * kKernelSide];
+    bool occupied_[kCount];
+    float energy_[kCount];
+};
+
+const BlueNoiseMask& GetBlueNoiseMask() {
+    static const BlueNoiseMask* mask = new BlueNoiseMask();
+    return *mask;
+}
+
+// Generators of the rank-1 lattice: the R_d sequence for kTableDimensions dimensions,
+// alpha_j = phi^-(j + 1) with phi the root of x^(d + 1) = x + 1, in 32-bit fixed point
+struct LatticeTable {
+    uint32_t generators[Sampler::kTableDimensions];
+
+    LatticeTable() {
+        double phi = 2.0;
+        for (int i = 0; i < 32; ++i) {
+            phi = std::pow(1.0 + phi, 1.0 / (Sampler::kTableDimensions + 1));
+        }
+        double alpha = 1.0;
+        for (int j = 0; j < Sampler::kTableDimensions; ++j) {
+            alpha /= phi;
+            generators[j] = static_cast<uint32_t>(std::fmod(alpha, 1.0) * 4294967296.0);
+        }
+    }
+};
+
+const LatticeTable& GetLatticeTable() {
+    static const LatticeTable table;
+    return table;
+}
+
+}  // namespace
+
+Sampler::Sampler(SamplerType type, int pixel_x, int pixel_y, uint32_t sample_index)
+    : type_(type)
+    , pixel_x_(pixel_x)
+    , pixel_y_(pixel_y)
+    , pixel_seed_(HashCombine(Hash(static_cast<uint32_t>(pixel_x)), static_cast<uint32_t>(pixel_y)))
+    , sample_index_(sample_index) {}
+
+float Sampler::Get1D() {
+    const uint32_t dimension = dimension_++;
+    if (type_ == SamplerType::kSobol) {
+        // Dimensions are drawn in order, so the first one of each block shuffles the index
+        if (dimension % kTableDimensions == 0) {
+            shuffled_index_ = ShuffleSobolIndex(sample_index_, static_cast<int>(dimension), pixel_seed_);
+        }
+        return ToUnitFloat(ScrambledSobol(shuffled_index_, static_cast<int>(dimension), pixel_seed_));
+    }
+
+    // Cranley-Patterson rotation of the lattice by the mask value, the mask shifted by a
+    // different offset for every dimension so dimensions stay uncorrelated
+    const BlueNoiseMask& mask = GetBlueNoiseMask();
+    uint32_t shift = Hash(dimension);
+    int x = (pixel_x_ + static_cast<int>(shift & 0xffffu)) & (kBlueNoiseSize - 1);
+    int y = (pixel_y_ + static_cast<int>(shift >> 16)) & (kBlueNoiseSize - 1);
+    uint32_t offset = mask.values[y * kBlueNoiseSize + x];
+    if (dimension >= static_cast<uint32_t>(kTableDimensions)) {
+        offset += Hash(dimension ^ pixel_seed_);
+    }
+    uint32_t generator = GetLatticeTable().generators[dimension % kTableDimensions];
+    return ToUnitFloat(offset + sample_index_ * generator);
+}
+
+glm::vec2 Sampler::Get2D() {
+    float x = Get1D();
+    float y = Get1D();
+    return glm::vec2(x, y);
+}
+
+const char* Sampler::GetTypeName(SamplerType type) {
+    return type == SamplerType::kSobol ? "sobol" : "bluenoise";
+}
+
+bool Sampler::ParseType(const char* name, SamplerType& type) {
+    for (SamplerType candidate : { SamplerType::kSobol, SamplerType::kBlueNoise }) {
+        if (std::strcmp(name, GetTypeName(candidate)) == 0) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Sampler::SobolSample(uint32_t index, int dimension, uint32_t seed) {
+    return ScrambledSobol(ShuffleSobolIndex(index, dimension, seed), dimension, seed);
+}
+
+uint32_t Sampler::ShuffleSobolIndex(uint32_t index, int dimension, uint32_t seed) {
+    // Dimensions come in blocks of kTableDimensions that share one shuffled index, so
+    // they are jointly stratified; each block is an independently scrambled copy
+    const uint32_t block = static_cast<uint32_t>(dimension / kTableDimensions);
+    return LaineKarrasPermutation(ReverseBits(index), HashCombine(seed, block));
+}
+
+uint32_t Sampler::ScrambledSobol(uint32_t shuffled_index, int dimension, uint32_t seed) {
+    const uint32_t(*tables)[256] = GetSobolTable().byte_tables[dimension % kTableDimensions];
+    uint32_t result = tables[0][shuffled_index & 0xff] ^ tables[1][(shuffled_index >> 8) & 0xff] ^
+                      tables[2][(shuffled_index >> 16) & 0xff] ^ tables[3][shuffled_index >> 24];
+    return ReverseBits(LaineKarrasPermutation(result, HashCombine(seed, static_cast<uint32_t>(dimension) + 0x9e3779b9u)));
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "long_march.h"
+#include <cstdint>
+
+// Sample sequences a Sampler can draw from
+enum class SamplerType {
+    kSobol,      // Sobol points with hash-based Owen scrambling, decorrelated per pixel
+    kBlueNoise,  // Rank-1 lattice rotated per pixel by a blue-noise mask
+};
+
+// Low-discrepancy samples in [0, 1) for one pixel sample, one dimension at a time
+// Every consumer (pixel jitter, lens, light and BSDF sampling) takes the next
+// dimensions in a fixed order, so sample i of a pixel is point i of a well
+// stratified sequence and the error of the running average drops faster than with
+// independent random numbers
+// The Sobol direction matrices and the blue-noise mask are built once into tables;
+// drawing a sample is a handful of integer operations and one table lookup
+class Sampler {
+public:
+    // Dimensions with their own Sobol matrix / lattice generator; further dimensions
+    // reuse them with independent scrambles
+    static constexpr int kTableDimensions = 16;
+    static constexpr int kBlueNoiseSize = 64;  // Side of the tiled blue-noise mask
+
+    // Sample sample_index of pixel (pixel_x, pixel_y)
+    Sampler(SamplerType type, int pixel_x, int pixel_y, uint32_t sample_index);
+
+    // Next dimension
+    float Get1D();
+
+    // Next two dimensions, e.g. the position inside the pixel
+    glm::vec2 Get2D();
+
+    const char* GetName() const { return GetTypeName(type_); }
+    static const char* GetTypeName(SamplerType type);
+
+    // Parses "sobol" or "bluenoise"; returns false for anything else
+    static bool ParseType(const char* name, SamplerType& type);
+
+    // Coordinate of point index of the Owen-scrambled Sobol sequence selected by seed
+    // (pixels use a hash of their position), in 32-bit fixed point
+    static uint32_t SobolSample(uint32_t index, int dimension, uint32_t seed);
+
+private:
+    static uint32_t ShuffleSobolIndex(uint32_t index, int dimension, uint32_t seed);
+    static uint32_t ScrambledSobol(uint32_t shuffled_index, int dimension, uint32_t seed);  // Index bit-reversed
+
+    SamplerType type_;
+    int pixel_x_;
+    int pixel_y_;
+    uint32_t pixel_seed_;
+    uint32_t sample_index_;
+    uint32_t shuffled_index_ = 0;  // Sobol index of the current block of dimensions, bit-reversed
+    uint32_t dimension_ = 0;
+};
@@ -1,7 +1,28 @@
 #include "Scene.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Background loads get their own pool with at least one worker: the global pool
+// runs submitted tasks inline when it has none, which would stall the render loop
+ThreadPool& LoadPool() {
+    // The loaders use these, so they are constructed first and outlive the pool
+    ThreadPool::Global();
+    MeshRegistry::Global();
+    static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+}  // namespace
 
 Scene::Scene(grassland::graphics::Core* core)
-    : core_(core) {
+    : core_(core)
+    , pending_(std::make_shared<PendingLoads>()) {
+    // Every mesh of a CPU scene gets a BVH, which goes into its cache
+    MeshRegistry::Global().SetBuildsCpuBvh(core_ == nullptr);
 }
 
 Scene::~Scene() {
@@ -15,16 +36,94 @@ void Scene::AddEntity(std::shared_ptr<Entity> entity) {
     }
 
     // Build BLAS for the entity
-    entity->BuildBLAS(core_);
+    if (core_) {
+        entity->BuildBLAS(core_);
+    } else {
+        entity->BuildCpuBLAS();
+    }
     
     entities_.push_back(entity);
     grassland::LogInfo("Added entity to scene (total: {})", entities_.size());
 }
 
+void Scene::AddEntityAsync(const std::string& obj_file_path, const Material& material, const glm::mat4& transform) {
+    std::shared_ptr<PendingLoads> pending = pending_;
+    {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        ++pending->in_flight;
+    }
+
+    // GPU BLASes are built when the entity is published, on the thread that owns the core
+    bool build_cpu_blas = core_ == nullptr;
+    LoadPool().Submit([pending, build_cpu_blas, obj_file_path, material, transform]() {
+        auto entity = std::make_shared<Entity>(obj_file_path, material, transform);
+        if (entity->IsValid() && build_cpu_blas) {
+            entity->BuildCpuBLAS();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            --pending->in_flight;
+            if (entity->IsValid()) {
+                pending->loaded.push_back(std::move(entity));
+            } else {
+                grassland::LogError("Cannot add invalid entity to scene: {}", obj_file_path);
+            }
+        }
+        pending->finished.notify_all();
+    });
+}
+
+size_t Scene::PublishLoadedEntities(size_t max_count) {
+    std::vector<std::shared_ptr<Entity>> batch;
+    size_t still_loading = 0;
+    {
+        std::lock_guard<std::mutex> lock(pending_->mutex);
+        auto& loaded = pending_->loaded;
+        size_t count = max_count ? std::min(max_count, loaded.size()) : loaded.size();
+        batch.assign(std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.begin() + count));
+        loaded.erase(loaded.begin(), loaded.begin() + count);
+        still_loading = pending_->in_flight + loaded.size();
+    }
+    if (batch.empty()) {
+        return 0;
+    }
+
+    for (auto& entity : batch) {
+        if (core_) {
+            entity->BuildBLAS(core_);
+        }
+        entities_.push_back(std::move(entity));
+    }
+
+    // One TLAS build (and materials upload) per batch rather than per entity
+    BuildAccelerationStructures();
+    grassland::LogInfo("Published {} loaded entities (total: {}, {} still loading)",
+                       batch.size(), entities_.size(), still_loading);
+    return batch.size();
+}
+
+size_t Scene::GetPendingEntityCount() const {
+    std::lock_guard<std::mutex> lock(pending_->mutex);
+    return pending_->in_flight + pending_->loaded.size();
+}
+
+void Scene::WaitForLoads() const {
+    std::unique_lock<std::mutex> lock(pending_->mutex);
+    pending_->finished.wait(lock, [this]() { return pending_->in_flight == 0; });
+}
+
 void Scene::Clear() {
     entities_.clear();
     tlas_.reset();
     materials_buffer_.reset();
+    materials_.clear();
+    instances_.clear();
+    instance_slots_.clear();
+    built_entity_count_ = 0;
+    cpu_tlas_ = CpuTlas();
+    // Loads still running finish into the old state and are dropped
+    pending_ = std::make_shared<PendingLoads>();
 }
 
 void Scene::BuildAccelerationStructures() {
@@ -33,9 +132,24 @@ void Scene::BuildAccelerationStructures() {
         return;
     }
 
+    // Everything is rebuilt from the current state, so pending changes are consumed
+    for (auto& entity : entities_) {
+        entity->ClearDirty();
+    }
+    built_entity_count_ = entities_.size();
+
+    if (!core_) {
+        BuildCpuAccelerationStructures();
+        grassland::LogInfo("Built CPU TLAS with {} instances ({} nodes, {} unique meshes)",
+                           cpu_tlas_.GetInstanceCount(), cpu_tlas_.GetNodeCount(), MeshRegistry::Global().GetMeshCount());
+        UpdateMaterialsBuffer();
+        return;
+    }
+
     // Create TLAS instances from all entities
-    std::vector<grassland::graphics::RayTracingInstance> instances;
-    instances.reserve(entities_.size());
+    instances_.clear();
+    instances_.reserve(entities_.size());
+    instance_slots_.assign(entities_.size(), -1);
 
     for (size_t i = 0; i < entities_.size(); ++i) {
         auto& entity = entities_[i];
@@ -52,46 +166,86 @@ void Scene::BuildAccelerationStructures() {
                 0,                          // instanceShaderBindingTableRecordOffset
                 grassland::graphics::RAYTRACING_INSTANCE_FLAG_NONE
             );
-            instances.push_back(instance);
+            instance_slots_[i] = static_cast<int32_t>(instances_.size());
+            instances_.push_back(instance);
         }
     }
 
     // Build TLAS
-    core_->CreateTopLevelAccelerationStructure(instances, &tlas_);
-    grassland::LogInfo("Built TLAS with {} instances", instances.size());
+    core_->CreateTopLevelAccelerationStructure(instances_, &tlas_);
+    grassland::LogInfo("Built TLAS with {} instances", instances_.size());
 
     // Update materials buffer
     UpdateMaterialsBuffer();
 }
 
 void Scene::UpdateInstances() {
-    if (!tlas_ || entities_.empty()) {
+    if (entities_.empty()) {
+        return;
+    }
+
+    // Entities added since the last build need a full build
+    if (entities_.size() != built_entity_count_ || (core_ && !tlas_)) {
+        BuildAccelerationStructures();
         return;
     }
 
-    // Recreate instances with updated transforms
-    std::vector<grassland::graphics::RayTracingInstance> instances;
+    size_t moved = 0;
+    for (size_t i = 0; i < entities_.size(); ++i) {
+        auto& entity = entities_[i];
+        if (entity->IsMaterialDirty()) {
+            materials_[i] = entity->GetMaterial();
+            if (materials_buffer_) {
+                materials_buffer_->UploadData(&materials_[i], sizeof(Material), i * sizeof(Material));
+            }
+        }
+        if (entity->IsTransformDirty()) {
+            glm::mat4x3 transform_3x4 = glm::mat4x3(entity->GetTransform());
+            if (!core_) {
+                moved += cpu_tlas_.SetInstanceTransform(static_cast<uint32_t>(i), transform_3x4) ? 1 : 0;
+            } else if (instance_slots_[i] >= 0) {
+                instances_[instance_slots_[i]] = entity->GetBLAS()->MakeInstance(
+                    transform_3x4,
+                    static_cast<uint32_t>(i),
+                    0xFF,
+                    0,
+                    grassland::graphics::RAYTRACING_INSTANCE_FLAG_NONE
+                );
+                ++moved;
+            }
+        }
+        entity->ClearDirty();
+    }
+    if (moved == 0) {
+        return;
+    }
+
+    if (!core_) {
+        // Refit the CPU TLAS above the moved instances (rebuilt if it degraded too far)
+        if (cpu_tlas_.Refit()) {
+            grassland::LogInfo("Rebuilt CPU TLAS after refitting degraded it (SAH cost {:.2f})", cpu_tlas_.GetSahCost());
+        }
+        return;
+    }
+
+    // The GPU TLAS takes the full instance list; only the moved entries were recreated
+    tlas_->UpdateInstances(instances_);
+}
+
+void Scene::BuildCpuAccelerationStructures() {
+    // Same instance layout as the GPU TLAS: custom index = entity index
+    std::vector<CpuInstance> instances;
     instances.reserve(entities_.size());
 
     for (size_t i = 0; i < entities_.size(); ++i) {
         auto& entity = entities_[i];
-        if (entity->GetBLAS()) {
-            // Convert mat4 to mat4x3
+        if (entity->GetCpuBLAS()) {
             glm::mat4x3 transform_3x4 = glm::mat4x3(entity->GetTransform());
-            
-            auto instance = entity->GetBLAS()->MakeInstance(
-                transform_3x4,
-                static_cast<uint32_t>(i),
-                0xFF,
-                0,
-                grassland::graphics::RAYTRACING_INSTANCE_FLAG_NONE
-            );
-            instances.push_back(instance);
+            instances.push_back(CpuTlas::MakeInstance(entity->GetCpuBLAS(), transform_3x4, static_cast<uint32_t>(i)));
         }
     }
 
-    // Update TLAS
-    tlas_->UpdateInstances(instances);
+    cpu_tlas_.Build(std::move(instances));
 }
 
 void Scene::UpdateMaterialsBuffer() {
@@ -99,24 +253,30 @@ void Scene::UpdateMaterialsBuffer() {
         return;
     }
 
-    // Collect all materials
-    std::vector<Material> materials;
-    materials.reserve(entities_.size());
+    // Collect all materials (kept on the CPU for the CPU backend)
+    materials_.clear();
+    materials_.reserve(entities_.size());
 
     for (const auto& entity : entities_) {
-        materials.push_back(entity->GetMaterial());
+        materials_.push_back(entity->GetMaterial());
+    }
+
+    if (!core_) {
+        return;
     }
 
     // Create/update materials buffer
-    size_t buffer_size = materials.size() * sizeof(Material);
+    size_t buffer_size = materials_.size() * sizeof(Material);
     
-    if (!materials_buffer_) {
+    // Recreated when entities were added since it was created
+    if (!materials_buffer_ || materials_buffer_->Size() != buffer_size) {
+        materials_buffer_.reset();
         core_->CreateBuffer(buffer_size, 
                           grassland::graphics::BUFFER_TYPE_DYNAMIC, 
                           &materials_buffer_);
     }
     
-    materials_buffer_->UploadData(materials.data(), buffer_size);
-    grassland::LogInfo("Updated materials buffer with {} materials", materials.size());
+    materials_buffer_->UploadData(materials_.data(), buffer_size);
+    grassland::LogInfo("Updated materials buffer with {} materials", materials_.size());
 }
 
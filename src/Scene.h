@@ -2,10 +2,16 @@
 #include "long_march.h"
 #include "Entity.h"
 #include "Material.h"
+#include "CpuTlas.h"
 #include <vector>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
 
 // Scene manages a collection of entities and builds the TLAS
+// A scene created without a graphics core (nullptr) builds CPU acceleration
+// structures instead, for the CPU ray tracing backend
 class Scene {
 public:
     Scene(grassland::graphics::Core* core);
@@ -14,21 +20,47 @@ public:
     // Add an entity to the scene
     void AddEntity(std::shared_ptr<Entity> entity);
 
+    // Load an entity (mesh and BLAS/CPU BVH) on a background thread; it joins the
+    // scene at a later PublishLoadedEntities, so rendering can start right away
+    void AddEntityAsync(const std::string& obj_file_path,
+                        const Material& material = Material(),
+                        const glm::mat4& transform = glm::mat4(1.0f));
+
+    // Add the entities that finished loading (at most max_count, 0: all) and rebuild
+    // the TLAS once for the whole batch; returns the number added
+    size_t PublishLoadedEntities(size_t max_count = 0);
+
+    // Number of asynchronous loads not yet published
+    size_t GetPendingEntityCount() const;
+
+    // Block until every asynchronous load has finished (they still need publishing)
+    void WaitForLoads() const;
+
     // Remove all entities
     void Clear();
 
     // Build/rebuild the TLAS from all entities
     void BuildAccelerationStructures();
 
-    // Update TLAS instances (e.g., for animation)
+    // Apply entity transform/material changes made since the last build or update
+    // (e.g., for animation); only entities flagged dirty are touched
     void UpdateInstances();
 
     // Get the TLAS for rendering
     grassland::graphics::AccelerationStructure* GetTLAS() const { return tlas_.get(); }
 
+    // Get the CPU TLAS (CPU backend only)
+    const CpuTlas& GetCpuTLAS() const { return cpu_tlas_; }
+
+    // Check whether this scene uses the CPU backend
+    bool IsCpuScene() const { return core_ == nullptr; }
+
     // Get materials buffer for all entities
     grassland::graphics::Buffer* GetMaterialsBuffer() const { return materials_buffer_.get(); }
 
+    // Get materials indexed by instanceCustomIndex (CPU copy of the materials buffer)
+    const std::vector<Material>& GetMaterials() const { return materials_; }
+
     // Get all entities
     const std::vector<std::shared_ptr<Entity>>& GetEntities() const { return entities_; }
 
@@ -37,10 +69,27 @@ public:
 
 private:
     void UpdateMaterialsBuffer();
+    void BuildCpuAccelerationStructures();
 
     grassland::graphics::Core* core_;
     std::vector<std::shared_ptr<Entity>> entities_;
     std::unique_ptr<grassland::graphics::AccelerationStructure> tlas_;
     std::unique_ptr<grassland::graphics::Buffer> materials_buffer_;
+    std::vector<Material> materials_;
+    CpuTlas cpu_tlas_;
+    // GPU TLAS instances as last submitted, and each entity's slot in them (-1: none)
+    std::vector<grassland::graphics::RayTracingInstance> instances_;
+    std::vector<int32_t> instance_slots_;
+    size_t built_entity_count_ = 0;
+
+    // Entities loading in the background, shared with the load tasks so the scene
+    // can be cleared or destroyed while loads are still running
+    struct PendingLoads {
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::vector<std::shared_ptr<Entity>> loaded;
+        size_t in_flight = 0;
+    };
+    std::shared_ptr<PendingLoads> pending_;
 };
 
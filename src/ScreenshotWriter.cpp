@@ -0,0 +1,89 @@
+#include "ScreenshotWriter.h"
+#include "ExrWriter.h"
+#include "PfmWriter.h"
+#include "PngWriter.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Two workers (ThreadPool counts the calling thread too): one capture encodes while the
+// next is quantized; a capture's strips, tiles and rows are split between these workers,
+// never the global pool the renderer runs on
+ScreenshotWriter::ScreenshotWriter()
+    : pool_(3) {
+}
+
+ScreenshotWriter::~ScreenshotWriter() {
+    WaitForAll();
+}
+
+std::vector<float> ScreenshotWriter::AcquireBuffer(int width, int height) {
+    std::vector<float> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_buffers_.empty()) {
+            buffer = std::move(free_buffers_.back());
+            free_buffers_.pop_back();
+        }
+    }
+    buffer.resize(static_cast<size_t>(width) * height * 4);
+    return buffer;
+}
+
+void ScreenshotWriter::Submit(std::vector<float> buffer, const std::string& path, int width, int height, float scale,
+                              const ToneMapSettings& tone_mapping, int sample_count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++in_flight_;
+    }
+    // std::function needs a copyable callable, so the buffer travels by shared_ptr
+    auto pixels = std::make_shared<std::vector<float>>(std::move(buffer));
+    pool_.Submit([this, pixels, path, width, height, scale, tone_mapping, sample_count]() {
+        bool saved = false;
+        std::string extension = std::filesystem::path(path).extension().string();
+        if (extension == GetExtension(ScreenshotFormat::kExr) || extension == GetExtension(ScreenshotFormat::kPfm)) {
+            // Float formats keep the linear, unclamped radiance
+            for (float& value : *pixels) {
+                value *= scale;
+            }
+            const glm::vec4* colors = reinterpret_cast<const glm::vec4*>(pixels->data());
+            saved = extension == GetExtension(ScreenshotFormat::kExr) ? ExrWriter::Write(path, colors, width, height, {}, pool_)
+                                                                      : PfmWriter::Write(path, colors, width, height, pool_);
+        } else {
+            std::vector<uint8_t> bytes(pixels->size());
+            ToneMapper::Quantize(tone_mapping, reinterpret_cast<const glm::vec4*>(pixels->data()), bytes.data(),
+                                 width, height, scale, pool_);
+            saved = PngWriter::Write(path, bytes.data(), width, height, 4, PngCompression::kDefault, pool_);
+        }
+        if (saved) {
+            grassland::LogInfo("Screenshot saved: {} ({}x{}, {} samples)",
+                               std::filesystem::absolute(path).string(), width, height, sample_count);
+        } else {
+            grassland::LogError("Failed to save screenshot: {}", path);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_buffers_.size() < kMaxPooledBuffers) {
+                free_buffers_.push_back(std::move(*pixels));
+            }
+            --in_flight_;
+        }
+        finished_.notify_all();
+    });
+}
+
+const char* ScreenshotWriter::GetExtension(ScreenshotFormat format) {
+    return format == ScreenshotFormat::kExr ? ".exr" : format == ScreenshotFormat::kPfm ? ".pfm" : ".png";
+}
+
+size_t ScreenshotWriter::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_;
+}
+
+void ScreenshotWriter::WaitForAll() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return in_flight_ == 0; });
+}
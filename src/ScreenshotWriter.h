@@ -0,0 +1,52 @@
+#pragma once
+#include "long_march.h"
+#include "ThreadPool.h"
+#include "ToneMapper.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// File format of a screenshot
+enum class ScreenshotFormat {
+    kPng,  // 8 bits per channel, tone mapped like the display
+    kExr,  // Linear half floats (OpenEXR, ZIP compressed), for compositing
+    kPfm,  // Linear 32-bit floats, uncompressed and memory-mappable
+};
+
+// Writes screenshots without stalling the render loop: the caller only copies the image
+// into a pooled buffer (AcquireBuffer); conversion and encoding run on the writer's own
+// workers (not the global ThreadPool the CPU renderer uses), and several captures may be
+// in flight at once
+// Destroying the writer waits for the captures still in flight
+class ScreenshotWriter {
+public:
+    ScreenshotWriter();
+    ~ScreenshotWriter();
+
+    // Buffer of width * height RGBA floats to fill with the image; pass it to Submit
+    std::vector<float> AcquireBuffer(int width, int height);
+
+    // Encode buffer * scale at path in the background, in the format given by the path's
+    // extension (.exr, .pfm, otherwise PNG); tone_mapping only applies to PNG, the float
+    // formats stay linear; sample_count is only used for logging
+    void Submit(std::vector<float> buffer, const std::string& path, int width, int height, float scale,
+                const ToneMapSettings& tone_mapping, int sample_count);
+
+    // File extension of a format, with the dot
+    static const char* GetExtension(ScreenshotFormat format);
+
+    // Captures queued or being encoded
+    size_t GetPendingCount() const;
+
+    void WaitForAll() const;
+
+private:
+    static constexpr size_t kMaxPooledBuffers = 4;
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable finished_;
+    std::vector<std::vector<float>> free_buffers_;
+    size_t in_flight_ = 0;
+    ThreadPool pool_;  // Last, so it is destroyed (draining its tasks) first
+};
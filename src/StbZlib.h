@@ -0,0 +1,7 @@
+#pragma once
+
+// zlib compressor of stb_image_write (defined in stb_image_write.cpp), which the header
+// only declares in its implementation part
+// Returns a malloc'd zlib stream of *out_len bytes (free with free()); quality is the
+// match search effort, 5 at least
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
@@ -0,0 +1,265 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Index of the current worker thread in its pool, set by WorkerLoop
+thread_local size_t t_worker_index = 0;
+
+// CPUs of each NUMA node, from sysfs; empty when the topology is unknown
+std::vector<std::vector<int>> GetNumaNodes() {
+    std::vector<std::vector<int>> nodes;
+#if defined(__linux__)
+    for (int node = 0;; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file) {
+            break;
+        }
+        // Comma-separated CPUs and ranges, e.g. "0-15,32-47"
+        std::vector<int> cpus;
+        std::string item;
+        while (std::getline(file, item, ',')) {
+            int first = 0;
+            int last = 0;
+            std::istringstream range(item);
+            char dash = 0;
+            if (!(range >> first)) {
+                continue;
+            }
+            last = (range >> dash >> last) ? last : first;
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        nodes.push_back(std::move(cpus));
+    }
+#endif
+    return nodes;
+}
+
+void PinToCpu(std::thread& thread, int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads, bool numa_pinning)
+    : stopping_(false) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Participant p runs on cpus[p % cpus.size()], with the CPUs listed node by node
+    // (the calling thread is participant 0 and is left unpinned)
+    std::vector<std::vector<int>> nodes = GetNumaNodes();
+    std::vector<int> cpus;
+    std::vector<size_t> cpu_nodes;
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        for (int cpu : nodes[node]) {
+            cpus.push_back(cpu);
+            cpu_nodes.push_back(node);
+        }
+    }
+    auto node_of = [&](size_t participant) {
+        return cpus.empty() ? 0 : cpu_nodes[participant % cpus.size()];
+    };
+    bool pin = numa_pinning && nodes.size() > 1;
+
+    // The calling thread is the last "worker"
+    for (size_t i = 1; i < num_threads; ++i) {
+        workers_.emplace_back([this, i]() { WorkerLoop(i - 1); });
+        if (pin) {
+            PinToCpu(workers_.back(), cpus[i % cpus.size()]);
+        }
+    }
+
+    // Steal from the same node first, then from the nearest participants
+    steal_order_.resize(num_threads);
+    for (size_t p = 0; p < num_threads; ++p) {
+        for (size_t q = 0; q < num_threads; ++q) {
+            if (q != p) {
+                steal_order_[p].push_back(static_cast<uint32_t>(q));
+            }
+        }
+        std::stable_sort(steal_order_[p].begin(), steal_order_[p].end(), [&](uint32_t a, uint32_t b) {
+            bool a_remote = node_of(a) != node_of(p);
+            bool b_remote = node_of(b) != node_of(p);
+            if (a_remote != b_remote) {
+                return !a_remote;
+            }
+            size_t a_distance = std::min((a + num_threads - p) % num_threads, (p + num_threads - a) % num_threads);
+            size_t b_distance = std::min((b + num_threads - p) % num_threads, (p + num_threads - b) % num_threads);
+            return a_distance < b_distance;
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    task_available_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Global() {
+    static ThreadPool pool(0, true);
+    return pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    if (workers_.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_available_.notify_one();
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    t_worker_index = index;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_available_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_ && tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    grain_size = std::max<size_t>(1, grain_size);
+    size_t num_chunks = (count + grain_size - 1) / grain_size;
+    if (num_chunks == 1 || workers_.empty()) {
+        body(0, count);
+        return;
+    }
+
+    // Each participant owns a range of chunks, packed as (end << 32 | begin) so the
+    // owner taking from the front and thieves splitting off the back both use one CAS.
+    // Helpers that start after all chunks are taken return immediately, which is
+    // why the job lives in a shared_ptr rather than on this stack frame.
+    struct alignas(64) Share {
+        std::atomic<uint64_t> range{ 0 };
+    };
+    struct Job {
+        std::unique_ptr<Share[]> shares;
+        std::atomic<size_t> remaining{ 0 };
+        size_t count;
+        size_t grain_size;
+        const std::function<void(size_t, size_t)>* body;
+        const std::vector<std::vector<uint32_t>>* steal_order;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto pack = [](uint64_t begin, uint64_t end) { return end << 32 | begin; };
+
+    const size_t participants = workers_.size() + 1;
+    auto job = std::make_shared<Job>();
+    job->shares.reset(new Share[participants]);
+    for (size_t p = 0; p < participants; ++p) {
+        job->shares[p].range = pack(num_chunks * p / participants, num_chunks * (p + 1) / participants);
+    }
+    job->remaining = num_chunks;
+    job->count = count;
+    job->grain_size = grain_size;
+    job->body = &body;
+    job->steal_order = &steal_order_;
+
+    auto run = [job, pack](size_t self) {
+        std::atomic<uint64_t>& own = job->shares[self].range;
+        for (;;) {
+            // Take the next chunk of our own share
+            uint64_t range = own.load();
+            uint64_t begin = range & 0xffffffffu;
+            uint64_t end = range >> 32;
+            if (begin < end) {
+                if (!own.compare_exchange_weak(range, pack(begin + 1, end))) {
+                    continue;
+                }
+                size_t first = begin * job->grain_size;
+                (*job->body)(first, std::min(job->count, first + job->grain_size));
+                if (job->remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(job->mutex);
+                    job->finished.notify_all();
+                }
+                continue;
+            }
+
+            // Out of work: move the back half of another share into ours
+            bool stolen = false;
+            for (uint32_t victim : (*job->steal_order)[self]) {
+                std::atomic<uint64_t>& other = job->shares[victim].range;
+                uint64_t victim_range = other.load();
+                for (;;) {
+                    uint64_t victim_begin = victim_range & 0xffffffffu;
+                    uint64_t victim_end = victim_range >> 32;
+                    if (victim_begin >= victim_end) {
+                        break;
+                    }
+                    uint64_t middle = victim_begin + (victim_end - victim_begin) / 2;
+                    if (other.compare_exchange_weak(victim_range, pack(victim_begin, middle))) {
+                        own.store(pack(middle, victim_end));
+                        stolen = true;
+                        break;
+                    }
+                }
+                if (stolen) {
+                    break;
+                }
+            }
+            if (!stolen) {
+                return;
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers_.size(), num_chunks - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < helpers; ++i) {
+            tasks_.push_back([run]() { run(t_worker_index + 1); });
+        }
+    }
+    task_available_.notify_all();
+
+    run(0);
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job]() { return job->remaining.load() == 0; });
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool runs CPU work (BVH builds, CPU ray tracing) on all cores
+// The calling thread always takes part in ParallelFor, so nested calls from
+// inside a task cannot deadlock the pool
+// ParallelFor schedules by work stealing: every thread starts on its own contiguous
+// share of the chunks and, once done, steals half of what is left of another
+// thread's share, trying threads on its own NUMA node first
+class ThreadPool {
+public:
+    // num_threads = 0 uses std::thread::hardware_concurrency()
+    // With numa_pinning, workers are pinned to one CPU each, filling NUMA nodes in
+    // order, when the machine has more than one node (Linux only)
+    explicit ThreadPool(size_t num_threads = 0, bool numa_pinning = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that execute work (workers + calling thread)
+    size_t GetThreadCount() const { return workers_.size() + 1; }
+
+    // Call body(begin, end) over [0, count) in chunks of grain_size and wait for completion
+    // Neighbouring chunks tend to run on the same thread, so callers should order the
+    // range for locality
+    void ParallelFor(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& body);
+
+    // Queue a task to run asynchronously on a worker
+    void Submit(std::function<void()> task);
+
+    // Process-wide pool shared by the CPU backend
+    static ThreadPool& Global();
+
+private:
+    void WorkerLoop(size_t index);
+
+    std::vector<std::thread> workers_;
+    // Other participants in the order a participant steals from them (same NUMA node
+    // first); participant 0 is the thread calling ParallelFor, i + 1 is worker i
+    std::vector<std::vector<uint32_t>> steal_order_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    bool stopping_;
+};
@@ -0,0 +1,124 @@
+// Compiled with AVX2 and FMA (see src/CMakeLists.txt); only reached after CpuFeatures reports support
+#include "ToneMapKernels.h"
+
+#if defined(SHORT_MARCH_X86_SIMD)
+#include <immintrin.h>
+
+namespace {
+
+// Two RGBA pixels per register
+template <int Curve>
+__m256 ApplyCurve(__m256 x, const ToneMapKernelParams& params) {
+    if (Curve == kToneCurveReinhard) {
+        return _mm256_div_ps(x, _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+    }
+    if (Curve == kToneCurveAces) {
+        __m256 numerator = _mm256_mul_ps(x, _mm256_fmadd_ps(x, _mm256_set1_ps(kAcesA), _mm256_set1_ps(kAcesB)));
+        __m256 denominator = _mm256_fmadd_ps(x, _mm256_fmadd_ps(x, _mm256_set1_ps(kAcesC), _mm256_set1_ps(kAcesD)),
+                                             _mm256_set1_ps(kAcesE));
+        return _mm256_div_ps(numerator, denominator);
+    }
+    if (Curve == kToneCurveFilmic) {
+        __m256 t = _mm256_mul_ps(x, _mm256_set1_ps(kFilmicExposureBias));
+        __m256 numerator = _mm256_fmadd_ps(t, _mm256_fmadd_ps(t, _mm256_set1_ps(kFilmicA), _mm256_set1_ps(kFilmicC * kFilmicB)),
+                                           _mm256_set1_ps(kFilmicD * kFilmicE));
+        __m256 denominator = _mm256_fmadd_ps(t, _mm256_fmadd_ps(t, _mm256_set1_ps(kFilmicA), _mm256_set1_ps(kFilmicB)),
+                                             _mm256_set1_ps(kFilmicD * kFilmicF));
+        __m256 curve = _mm256_sub_ps(_mm256_div_ps(numerator, denominator), _mm256_set1_ps(kFilmicE / kFilmicF));
+        return _mm256_mul_ps(curve, _mm256_set1_ps(params.filmic_white_scale));
+    }
+    return x;
+}
+
+// Color lanes: exposure, curve, clamp and encoding; alpha lanes: scale and clamp
+template <int Curve>
+__m256 MapPixels(__m256 pixels, __m256 scale, const ToneMapKernelParams& params) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    // max returns its second operand for NaN, so NaN becomes 0
+    __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(pixels, scale), _mm256_setzero_ps()),
+                             _mm256_set1_ps(kToneMapMaxInput));
+    __m256 y = _mm256_min_ps(ApplyCurve<Curve>(x, params), one);
+    if (params.oetf_lut) {
+        __m256 position = _mm256_mul_ps(y, _mm256_set1_ps(static_cast<float>(kToneMapLutSize)));
+        __m256i index = _mm256_min_epi32(_mm256_cvttps_epi32(position), _mm256_set1_epi32(kToneMapLutSize - 1));
+        __m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(index));
+        __m256 low = _mm256_i32gather_ps(params.oetf_lut, index, 4);
+        __m256 high = _mm256_i32gather_ps(params.oetf_lut + 1, index, 4);
+        y = _mm256_fmadd_ps(_mm256_sub_ps(high, low), fraction, low);
+    }
+    return _mm256_blend_ps(y, _mm256_min_ps(x, one), 0x88);
+}
+
+// Row y's dither thresholds for 16 pixels from column 0, repeated for each channel, so
+// the 8 floats of two pixels starting at any column mod 8 are one load
+void ExpandDitherRow(const float* thresholds, int y, float* expanded) {
+    for (int i = 0; i < 64; ++i) {
+        expanded[i] = thresholds[(y & 7) * 8 + ((i / 4) & 7)];
+    }
+}
+
+template <int Curve>
+void ToneMapRow(const float* input, float* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params) {
+    const __m256 scale = _mm256_setr_ps(params.color_scale, params.color_scale, params.color_scale, params.alpha_scale,
+                                        params.color_scale, params.color_scale, params.color_scale, params.alpha_scale);
+    alignas(32) float offsets[64] = {};
+    if (params.dither) {
+        // Alpha is not dithered for display
+        ExpandDitherRow(params.dither, y, offsets);
+        for (int i = 0; i < 64; ++i) {
+            offsets[i] = i % 4 == 3 ? 0.0f : (offsets[i] - 0.5f) / 255.0f;
+        }
+    }
+    size_t i = 0;
+    for (; i + 2 <= pixel_count; i += 2) {
+        __m256 mapped = MapPixels<Curve>(_mm256_loadu_ps(input + i * 4), scale, params);
+        __m256 offset = _mm256_loadu_ps(offsets + 4 * ((x + static_cast<int>(i)) & 7));
+        _mm256_storeu_ps(output + i * 4, _mm256_add_ps(mapped, offset));
+    }
+    ToneMapRowScalar(input + i * 4, output + i * 4, pixel_count - i, x + static_cast<int>(i), y, params);
+}
+
+template <int Curve>
+void QuantizeRow(const float* input, uint8_t* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params) {
+    const __m256 scale = _mm256_setr_ps(params.color_scale, params.color_scale, params.color_scale, params.alpha_scale,
+                                        params.color_scale, params.color_scale, params.color_scale, params.alpha_scale);
+    alignas(32) float thresholds[64];
+    if (params.dither) {
+        ExpandDitherRow(params.dither, y, thresholds);
+    } else {
+        for (int i = 0; i < 64; ++i) {
+            thresholds[i] = 0.5f;
+        }
+    }
+    const __m256 max_value = _mm256_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 2 <= pixel_count; i += 2) {
+        __m256 mapped = MapPixels<Curve>(_mm256_loadu_ps(input + i * 4), scale, params);
+        __m256 threshold = _mm256_loadu_ps(thresholds + 4 * ((x + static_cast<int>(i)) & 7));
+        // Values are in [0, 255 + threshold), so truncation floors and the packs saturate
+        __m256i values = _mm256_cvttps_epi32(_mm256_fmadd_ps(mapped, max_value, threshold));
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i * 4), _mm_packus_epi16(words, words));
+    }
+    QuantizeRowScalar(input + i * 4, output + i * 4, pixel_count - i, x + static_cast<int>(i), y, params);
+}
+
+using ToneMapRowFunction = void (*)(const float*, float*, size_t, int, int, const ToneMapKernelParams&);
+using QuantizeRowFunction = void (*)(const float*, uint8_t*, size_t, int, int, const ToneMapKernelParams&);
+
+// Indexed by curve
+constexpr ToneMapRowFunction kToneMapRows[] = { ToneMapRow<kToneCurveClamp>, ToneMapRow<kToneCurveReinhard>,
+                                                ToneMapRow<kToneCurveAces>, ToneMapRow<kToneCurveFilmic> };
+constexpr QuantizeRowFunction kQuantizeRows[] = { QuantizeRow<kToneCurveClamp>, QuantizeRow<kToneCurveReinhard>,
+                                                  QuantizeRow<kToneCurveAces>, QuantizeRow<kToneCurveFilmic> };
+
+}  // namespace
+
+void ToneMapRowAvx2(const float* input, float* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params) {
+    kToneMapRows[params.curve](input, output, pixel_count, x, y, params);
+}
+
+void QuantizeRowAvx2(const float* input, uint8_t* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params) {
+    kQuantizeRows[params.curve](input, output, pixel_count, x, y, params);
+}
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Tone mapping kernels over rows of RGBA floats (see ToneMapper.h); the AVX2 ones live
+// in a translation unit compiled with AVX2 and FMA and are only called after CpuFeatures
+// confirms support, so this header stays free of glm and other shared inline code (see
+// Bvh8Traversal.h)
+
+// ToneCurve values, for kernels that cannot include ToneMapper.h
+constexpr int kToneCurveClamp = 0;
+constexpr int kToneCurveReinhard = 1;
+constexpr int kToneCurveAces = 2;
+constexpr int kToneCurveFilmic = 3;
+
+// sRGB encoding table: kToneMapLutSize + 1 samples over [0, 1]
+constexpr int kToneMapLutSize = 4096;
+
+// Exposed inputs are clamped to this first so infinities cannot turn a curve into
+// inf / inf; every curve is within rounding of 1 there
+constexpr float kToneMapMaxInput = 65504.0f;
+
+// ACES fit: x (a x + b) / (x (c x + d) + e)
+constexpr float kAcesA = 2.51f;
+constexpr float kAcesB = 0.03f;
+constexpr float kAcesC = 2.43f;
+constexpr float kAcesD = 0.59f;
+constexpr float kAcesE = 0.14f;
+
+// Hable's filmic curve: shoulder strength, linear strength, linear angle, toe strength,
+// toe numerator and denominator; applied to 2x and divided by its value at the white point
+constexpr float kFilmicA = 0.15f;
+constexpr float kFilmicB = 0.50f;
+constexpr float kFilmicC = 0.10f;
+constexpr float kFilmicD = 0.20f;
+constexpr float kFilmicE = 0.02f;
+constexpr float kFilmicF = 0.30f;
+constexpr float kFilmicExposureBias = 2.0f;
+constexpr float kFilmicWhite = 11.2f;
+
+struct ToneMapKernelParams {
+    float color_scale;         // Input scale times exposure
+    float alpha_scale;         // Input scale only
+    int curve;                 // kToneCurve*
+    float filmic_white_scale;  // 1 / filmic curve at the white point
+    const float* oetf_lut;     // Encoding table, or null for linear output
+    const float* dither;       // 8x8 thresholds in [0, 1) by y * 8 + x, or null to round
+};
+
+// Pixel count pixels of row y, starting at column x (which selects the dither thresholds)
+void ToneMapRowScalar(const float* input, float* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params);
+void QuantizeRowScalar(const float* input, uint8_t* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params);
+
+#if defined(SHORT_MARCH_X86_SIMD)
+void ToneMapRowAvx2(const float* input, float* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params);
+void QuantizeRowAvx2(const float* input, uint8_t* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params);
+#endif
@@ -0,0 +1,185 @@
+#include "ToneMapper.h"
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include "ToneMapKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(glm::vec4) == 4 * sizeof(float), "tone mapping kernels read glm::vec4 as four floats");
+static_assert(kToneCurveClamp == static_cast<int>(ToneCurve::kClamp) &&
+                  kToneCurveReinhard == static_cast<int>(ToneCurve::kReinhard) &&
+                  kToneCurveAces == static_cast<int>(ToneCurve::kAces) &&
+                  kToneCurveFilmic == static_cast<int>(ToneCurve::kFilmic),
+              "kernel curve numbers follow ToneCurve");
+
+namespace {
+
+struct ToneMapKernel {
+    void (*tone_map)(const float* input, float* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params);
+    void (*quantize)(const float* input, uint8_t* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params);
+};
+
+ToneMapKernel SelectKernel() {
+#if defined(SHORT_MARCH_X86_SIMD)
+    const CpuFeatures& features = CpuFeatures::Get();
+    if (features.avx2 && features.fma) {
+        return ToneMapKernel{ ToneMapRowAvx2, QuantizeRowAvx2 };
+    }
+#endif
+    return ToneMapKernel{ ToneMapRowScalar, QuantizeRowScalar };
+}
+
+const ToneMapKernel& GetKernel() {
+    static const ToneMapKernel kernel = SelectKernel();
+    return kernel;
+}
+
+float SrgbOetf(float linear) {
+    return linear <= 0.0031308f ? 12.92f * linear : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+const float* GetOetfLut() {
+    static const std::array<float, kToneMapLutSize + 1> lut = [] {
+        std::array<float, kToneMapLutSize + 1> table{};
+        for (int i = 0; i <= kToneMapLutSize; ++i) {
+            table[i] = SrgbOetf(static_cast<float>(i) / kToneMapLutSize);
+        }
+        return table;
+    }();
+    return lut.data();
+}
+
+// Bayer matrix: bit-reversed interleaving of the bits of x ^ y and y
+const float* GetDitherThresholds() {
+    static const std::array<float, 64> thresholds = [] {
+        std::array<float, 64> table{};
+        for (int y = 0; y < 8; ++y) {
+            for (int x = 0; x < 8; ++x) {
+                int rank = 0;
+                for (int bit = 0; bit < 3; ++bit) {
+                    rank = (rank << 2) | ((((x ^ y) >> bit) & 1) << 1) | ((y >> bit) & 1);
+                }
+                table[y * 8 + x] = (static_cast<float>(rank) + 0.5f) / 64.0f;
+            }
+        }
+        return table;
+    }();
+    return thresholds.data();
+}
+
+float FilmicCurve(float x) {
+    return (x * (kFilmicA * x + kFilmicC * kFilmicB) + kFilmicD * kFilmicE) /
+               (x * (kFilmicA * x + kFilmicB) + kFilmicD * kFilmicF) -
+           kFilmicE / kFilmicF;
+}
+
+ToneMapKernelParams GetKernelParams(const ToneMapSettings& settings, float scale) {
+    ToneMapKernelParams params;
+    params.color_scale = scale * std::exp2(settings.exposure);
+    params.alpha_scale = scale;
+    params.curve = static_cast<int>(settings.curve);
+    params.filmic_white_scale = 1.0f / FilmicCurve(kFilmicWhite);
+    params.oetf_lut = settings.srgb ? GetOetfLut() : nullptr;
+    params.dither = settings.dither ? GetDitherThresholds() : nullptr;
+    return params;
+}
+
+// One color channel: exposure, curve, clamp and encoding
+float MapColor(float value, const ToneMapKernelParams& params) {
+    float x = value * params.color_scale;
+    x = x > 0.0f ? std::min(x, kToneMapMaxInput) : 0.0f;  // Also maps NaN to 0
+    float y = x;
+    if (params.curve == kToneCurveReinhard) {
+        y = x / (1.0f + x);
+    } else if (params.curve == kToneCurveAces) {
+        y = (x * (kAcesA * x + kAcesB)) / (x * (kAcesC * x + kAcesD) + kAcesE);
+    } else if (params.curve == kToneCurveFilmic) {
+        y = FilmicCurve(kFilmicExposureBias * x) * params.filmic_white_scale;
+    }
+    y = std::min(y, 1.0f);
+    if (params.oetf_lut) {
+        float position = y * kToneMapLutSize;
+        int index = std::min(static_cast<int>(position), kToneMapLutSize - 1);
+        float fraction = position - static_cast<float>(index);
+        y = params.oetf_lut[index] + (params.oetf_lut[index + 1] - params.oetf_lut[index]) * fraction;
+    }
+    return y;
+}
+
+float MapAlpha(float value, const ToneMapKernelParams& params) {
+    float a = value * params.alpha_scale;
+    return std::min(a > 0.0f ? a : 0.0f, 1.0f);
+}
+
+}  // namespace
+
+void ToneMapRowScalar(const float* input, float* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        const float* in = input + i * 4;
+        float* out = output + i * 4;
+        float offset = 0.0f;
+        if (params.dither) {
+            offset = (params.dither[(y & 7) * 8 + ((x + static_cast<int>(i)) & 7)] - 0.5f) / 255.0f;
+        }
+        for (int c = 0; c < 3; ++c) {
+            out[c] = MapColor(in[c], params) + offset;
+        }
+        out[3] = MapAlpha(in[3], params);
+    }
+}
+
+void QuantizeRowScalar(const float* input, uint8_t* output, size_t pixel_count, int x, int y, const ToneMapKernelParams& params) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        const float* in = input + i * 4;
+        uint8_t* out = output + i * 4;
+        float threshold = params.dither ? params.dither[(y & 7) * 8 + ((x + static_cast<int>(i)) & 7)] : 0.5f;
+        for (int c = 0; c < 4; ++c) {
+            float value = c < 3 ? MapColor(in[c], params) : MapAlpha(in[c], params);
+            out[c] = static_cast<uint8_t>(std::min(static_cast<int>(value * 255.0f + threshold), 255));
+        }
+    }
+}
+
+void ToneMapper::Apply(const ToneMapSettings& settings, const glm::vec4* input, glm::vec4* output,
+                       int width, int height, float scale, ThreadPool& pool) {
+    const ToneMapKernelParams params = GetKernelParams(settings, scale);
+    const ToneMapKernel& kernel = GetKernel();
+    pool.ParallelFor(static_cast<size_t>(height), 8, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            size_t first = y * width;
+            kernel.tone_map(&input[first].x, &output[first].x, static_cast<size_t>(width), 0, static_cast<int>(y), params);
+        }
+    });
+}
+
+void ToneMapper::Quantize(const ToneMapSettings& settings, const glm::vec4* input, uint8_t* output,
+                          int width, int height, float scale, ThreadPool& pool) {
+    const ToneMapKernelParams params = GetKernelParams(settings, scale);
+    const ToneMapKernel& kernel = GetKernel();
+    pool.ParallelFor(static_cast<size_t>(height), 8, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            size_t first = y * width;
+            kernel.quantize(&input[first].x, output + first * 4, static_cast<size_t>(width), 0, static_cast<int>(y), params);
+        }
+    });
+}
+
+const char* ToneMapper::GetCurveName(ToneCurve curve) {
+    return curve == ToneCurve::kReinhard ? "reinhard"
+           : curve == ToneCurve::kAces   ? "aces"
+           : curve == ToneCurve::kFilmic ? "filmic"
+                                         : "clamp";
+}
+
+bool ToneMapper::ParseCurve(const char* name, ToneCurve& curve) {
+    for (ToneCurve candidate : { ToneCurve::kClamp, ToneCurve::kReinhard, ToneCurve::kAces, ToneCurve::kFilmic }) {
+        if (std::strcmp(name, GetCurveName(candidate)) == 0) {
+            curve = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "long_march.h"
+#include "ThreadPool.h"
+
+// Curve compressing linear radiance into [0, 1]
+enum class ToneCurve {
+    kClamp,     // Values above 1 clip (the behavior without tone mapping)
+    kReinhard,  // x / (1 + x)
+    kAces,      // Narkowicz's fit of the ACES reference rendering transform
+    kFilmic,    // Hable's filmic curve (Uncharted 2), white point 11.2
+};
+
+struct ToneMapSettings {
+    float exposure = 0.0f;  // In stops, applied before the curve
+    ToneCurve curve = ToneCurve::kClamp;
+    bool srgb = false;    // Encode with the sRGB transfer function (otherwise values stay linear)
+    bool dither = false;  // 8x8 ordered dithering of the 8-bit quantization
+};
+
+// Post-process from linear film colors to display values, shared by the window,
+// screenshots and the headless renderer: exposure, tone curve, sRGB encoding (a
+// 4096-entry table, linearly interpolated) and quantization with optional Bayer
+// dithering; alpha is only scaled and clamped
+// Rows run in parallel on pool (the global ThreadPool by default), with AVX2 kernels
+// where CpuFeatures reports AVX2 and FMA
+class ToneMapper {
+public:
+    // Display floats; with dither, offsets of up to half an 8-bit step are added so the
+    // image is dithered when the swapchain quantizes it
+    // scale multiplies the input first (1 / sample count for sums)
+    static void Apply(const ToneMapSettings& settings, const glm::vec4* input, glm::vec4* output,
+                      int width, int height, float scale = 1.0f, ThreadPool& pool = ThreadPool::Global());
+
+    // 8-bit RGBA
+    static void Quantize(const ToneMapSettings& settings, const glm::vec4* input, uint8_t* output,
+                         int width, int height, float scale = 1.0f, ThreadPool& pool = ThreadPool::Global());
+
+    static const char* GetCurveName(ToneCurve curve);
+    // Parse a name returned by GetCurveName; false if unknown
+    static bool ParseCurve(const char* name, ToneCurve& curve);
+};
@@ -1,20 +1,25 @@
 #include "app.h"
 #include "Material.h"
 #include "Entity.h"
+#include "ThreadPool.h"
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "imgui.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
 
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <cstring>
 #include <filesystem>
 
 namespace {
 #include "built_in_shaders.inl"
+
+// CPU backend adaptive sampling: tiles stop receiving samples once their relative
+// noise is below the threshold
+constexpr float kAdaptiveNoiseThreshold = 0.01f;
+constexpr int kAdaptiveMinSamples = 16;
 }
 
 Application::Application(grassland::graphics::BackendAPI api) {
@@ -23,6 +28,13 @@ Application::Application(grassland::graphics::BackendAPI api) {
 
     grassland::LogInfo("Device Name: {}", core_->DeviceName());
     grassland::LogInfo("- Ray Tracing Support: {}", core_->DeviceRayTracingSupport());
+
+    // Fall back to the CPU ray tracer when the device cannot trace rays
+    cpu_rendering_ = !core_->DeviceRayTracingSupport();
+    if (cpu_rendering_) {
+        grassland::LogInfo("Using CPU ray tracing backend ({} threads, {} BVH traversal)",
+                           ThreadPool::Global().GetThreadCount(), Bvh8::GetKernelName());
+    }
 }
 
 Application::~Application() {
@@ -59,14 +71,34 @@ void Application::ProcessInput() {
         std::tm tm;
         localtime_s(&tm, &time_t);
         
+        // Milliseconds too, so captures in flight together never share a file
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
         std::ostringstream filename;
         filename << "screenshot_" 
                  << std::put_time(&tm, "%Y%m%d_%H%M%S")
-                 << ".png";
+                 << "_" << std::setw(3) << std::setfill('0') << milliseconds
+                 << ScreenshotWriter::GetExtension(screenshot_format_);
         
         SaveAccumulatedOutput(filename.str());
     }
     ctrl_s_was_pressed = ctrl_s_pressed;
+
+    // Ctrl+K records the current view as a camera keyframe one second after the previous
+    // one and saves the path, ready for ShortMarchRender --path
+    static bool ctrl_k_was_pressed = false;
+    bool ctrl_k_pressed = ctrl_pressed && (glfwGetKey(glfw_window, GLFW_KEY_K) == GLFW_PRESS);
+    if (ctrl_k_pressed && !ctrl_k_was_pressed) {
+        const char* path = "camera_path.txt";
+        float time = camera_path_.IsEmpty() ? 0.0f : camera_path_.GetEndTime() + 1.0f;
+        camera_path_.AddKeyframe(CameraKeyframe{ time, camera_pos_, yaw_, pitch_ });
+        if (camera_path_.Save(path)) {
+            grassland::LogInfo("Camera keyframe {} at {} s saved to {}", camera_path_.GetKeyframeCount(), time,
+                               std::filesystem::absolute(path).string());
+        } else {
+            grassland::LogError("Failed to save camera path: {}", path);
+        }
+    }
+    ctrl_k_was_pressed = ctrl_k_pressed;
     
     // Only process camera movement if camera is enabled
     if (!camera_enabled_) {
@@ -217,56 +249,49 @@ void Application::OnInit() {
     mouse_y_ = 0.0;
     // Don't grab cursor initially - user can right-click to enable camera mode
 
-    // Create scene
-    scene_ = std::make_unique<Scene>(core_.get());
+    // Create scene (no graphics core means CPU acceleration structures)
+    scene_ = std::make_unique<Scene>(cpu_rendering_ ? nullptr : core_.get());
 
-    // Add entities to the scene
+    // Add entities to the scene; they load in the background and appear as they finish
     // Ground plane - a cube scaled to be flat
-    {
-        auto ground = std::make_shared<Entity>(
-            "meshes/cube.obj",
-            Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.8f, 0.0f),
-            glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), 
-                      glm::vec3(10.0f, 0.1f, 10.0f))
-        );
-        scene_->AddEntity(ground);
-    }
+    scene_->AddEntityAsync(
+        "meshes/cube.obj",
+        Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.8f, 0.0f),
+        glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), 
+                  glm::vec3(10.0f, 0.1f, 10.0f))
+    );
 
     // Red sphere (using octahedron as sphere substitute)
-    {
-        auto red_sphere = std::make_shared<Entity>(
-            "meshes/octahedron.obj",
-            Material(glm::vec3(1.0f, 0.2f, 0.2f), 0.3f, 0.0f),
-            glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, 0.5f, 0.0f))
-        );
-        scene_->AddEntity(red_sphere);
-    }
+    scene_->AddEntityAsync(
+        "meshes/octahedron.obj",
+        Material(glm::vec3(1.0f, 0.2f, 0.2f), 0.3f, 0.0f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, 0.5f, 0.0f))
+    );
 
     // Green metallic sphere
-    {
-        auto green_sphere = std::make_shared<Entity>(
-            "meshes/octahedron.obj",
-            Material(glm::vec3(0.2f, 1.0f, 0.2f), 0.2f, 0.8f),
-            glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 0.0f))
-        );
-        scene_->AddEntity(green_sphere);
-    }
+    scene_->AddEntityAsync(
+        "meshes/octahedron.obj",
+        Material(glm::vec3(0.2f, 1.0f, 0.2f), 0.2f, 0.8f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 0.0f))
+    );
 
     // Blue cube
-    {
-        auto blue_cube = std::make_shared<Entity>(
-            "meshes/cube.obj",
-            Material(glm::vec3(0.2f, 0.2f, 1.0f), 0.5f, 0.0f),
-            glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.5f, 0.0f))
-        );
-        scene_->AddEntity(blue_cube);
-    }
+    scene_->AddEntityAsync(
+        "meshes/cube.obj",
+        Material(glm::vec3(0.2f, 0.2f, 1.0f), 0.5f, 0.0f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.5f, 0.0f))
+    );
 
-    // Build acceleration structures
-    scene_->BuildAccelerationStructures();
+    screenshot_writer_ = std::make_unique<ScreenshotWriter>();
 
     // Create film for accumulation
-    film_ = std::make_unique<Film>(core_.get(), window_->GetWidth(), window_->GetHeight());
+    if (cpu_rendering_) {
+        cpu_film_ = std::make_unique<CpuFilm>(window_->GetWidth(), window_->GetHeight());
+        cpu_renderer_ = std::make_unique<CpuRenderer>();
+        cpu_denoiser_ = std::make_unique<CpuDenoiser>();
+    } else {
+        film_ = std::make_unique<Film>(core_.get(), window_->GetWidth(), window_->GetHeight());
+    }
 
     core_->CreateBuffer(sizeof(CameraObject), grassland::graphics::BUFFER_TYPE_DYNAMIC, &camera_object_buffer_);
     
@@ -303,6 +328,7 @@ void Application::OnInit() {
     camera_object.camera_to_world =
         glm::inverse(glm::lookAt(camera_pos_, camera_pos_ + camera_front_, camera_up_));
     camera_object_buffer_->UploadData(&camera_object, sizeof(CameraObject));
+    camera_object_ = camera_object;
 
     core_->CreateImage(window_->GetWidth(), window_->GetHeight(), grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT,
         &color_image_);
@@ -311,6 +337,11 @@ void Application::OnInit() {
     core_->CreateImage(window_->GetWidth(), window_->GetHeight(), grassland::graphics::IMAGE_FORMAT_R32_SINT,
         &entity_id_image_);
 
+    // The CPU backend runs the shader logic itself, no ray tracing program needed
+    if (cpu_rendering_) {
+        return;
+    }
+
     core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "RayGenMain", "lib_6_3", &raygen_shader_);
     core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "MissMain", "lib_6_3", &miss_shader_);
     core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "ClosestHitMain", "lib_6_3", &closest_hit_shader_);
@@ -335,8 +366,13 @@ void Application::OnClose() {
     miss_shader_.reset();
     closest_hit_shader_.reset();
 
+    // Finish the screenshots still being encoded
+    screenshot_writer_.reset();
+
     scene_.reset();
     film_.reset();
+    cpu_film_.reset();
+    cpu_renderer_.reset();
 
     color_image_.reset();
     entity_id_image_.reset();
@@ -381,6 +417,14 @@ void Application::UpdateHoveredEntity() {
     // Read pixel color from accumulated buffer (before highlighting is applied)
     // Note: This is a synchronous read which may cause a GPU stall
     // For better performance, consider using a readback buffer with a frame delay
+    // The CPU film's developed output is used as is: adaptive sampling and reprojection
+    // leave every pixel with its own sample count
+    if (cpu_rendering_) {
+        hovered_pixel_color_ = cpu_film_->GetSampleCount() > 0
+                                   ? cpu_film_->GetOutputData()[static_cast<size_t>(y) * width + x]
+                                   : glm::vec4(0.0f);
+        return;
+    }
     float accumulated_rgba[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     film_->GetAccumulatedColorImage()->DownloadData(accumulated_rgba, offset, extent);
     
@@ -417,11 +461,24 @@ void Application::OnUpdate() {
                 grassland::LogInfo("Camera enabled - accumulation will reset when camera stops");
             } else {
                 // Camera just got disabled - reset accumulation for new stationary view
-                film_->Reset();
+                // (the CPU film reprojects its samples into every new view instead)
+                if (!cpu_rendering_) {
+                    film_->Reset();
+                }
                 grassland::LogInfo("Camera disabled - starting accumulation");
             }
             last_camera_enabled_ = camera_enabled_;
         }
+
+        // Add entities that finished loading since the last frame; the scene changed,
+        // so accumulation starts over
+        if (scene_->PublishLoadedEntities() > 0) {
+            if (cpu_rendering_) {
+                cpu_film_->Reset();
+            } else {
+                film_->Reset();
+            }
+        }
         
         // Update which entity is being hovered
         UpdateHoveredEntity();
@@ -438,6 +495,7 @@ void Application::OnUpdate() {
         camera_object.camera_to_world =
             glm::inverse(glm::lookAt(camera_pos_, camera_pos_ + camera_front_, camera_up_));
         camera_object_buffer_->UploadData(&camera_object, sizeof(CameraObject));
+        camera_object_ = camera_object;
 
 
         // Optional: Animate entities
@@ -479,10 +537,10 @@ void Application::ApplyHoverHighlight(grassland::graphics::Image* image) {
 }
 
 void Application::SaveAccumulatedOutput(const std::string& filename) {
-    // Save the accumulated output image to a PNG file (without hover highlighting)
+    // Save the accumulated output image to a PNG, EXR or PFM file (without hover highlighting)
     int width = window_->GetWidth();
     int height = window_->GetHeight();
-    int sample_count = film_->GetSampleCount();
+    int sample_count = cpu_rendering_ ? cpu_film_->GetSampleCount() : film_->GetSampleCount();
     
     if (sample_count == 0) {
         grassland::LogWarning("Cannot save screenshot: no samples accumulated yet");
@@ -490,36 +548,20 @@ void Application::SaveAccumulatedOutput(const std::string& filename) {
     }
     
     // Download accumulated color directly from film buffers (not the output image which may have highlights)
-    std::vector<float> accumulated_colors(width * height * 4);
-    film_->GetAccumulatedColorImage()->DownloadData(accumulated_colors.data());
-    
-    // Convert from accumulated sum to averaged color, then to 8-bit
-    std::vector<uint8_t> byte_data(width * height * 4);
-    for (size_t i = 0; i < width * height; i++) {
-        // Average the accumulated color by dividing by sample count
-        float r = accumulated_colors[i * 4 + 0] / static_cast<float>(sample_count);
-        float g = accumulated_colors[i * 4 + 1] / static_cast<float>(sample_count);
-        float b = accumulated_colors[i * 4 + 2] / static_cast<float>(sample_count);
-        float a = accumulated_colors[i * 4 + 3] / static_cast<float>(sample_count);
-        
-        // Clamp to [0, 1] and convert to 8-bit
-        byte_data[i * 4 + 0] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, r)) * 255.0f);
-        byte_data[i * 4 + 1] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, g)) * 255.0f);
-        byte_data[i * 4 + 2] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, b)) * 255.0f);
-        byte_data[i * 4 + 3] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, a)) * 255.0f);
-    }
-    
-    // Write PNG file
-    int result = stbi_write_png(filename.c_str(), width, height, 4, byte_data.data(), width * 4);
-    
-    if (result) {
-        // Get absolute path for logging
-        std::filesystem::path abs_path = std::filesystem::absolute(filename);
-        grassland::LogInfo("Screenshot saved: {} ({}x{}, {} samples)", 
-                          abs_path.string(), width, height, sample_count);
+    // The CPU film's output is used instead, already averaged per pixel since adaptive
+    // sampling leaves pixels with different sample counts (and denoised if enabled)
+    // Only this copy happens here; averaging, conversion and encoding run in the background
+    std::vector<float> accumulated_colors = screenshot_writer_->AcquireBuffer(width, height);
+    float divisor = static_cast<float>(sample_count);
+    if (cpu_rendering_) {
+        const glm::vec4* colors = cpu_denoise_ ? cpu_denoiser_->Denoise(*cpu_film_, true) : cpu_film_->GetOutputData();
+        std::memcpy(accumulated_colors.data(), colors, accumulated_colors.size() * sizeof(float));
+        divisor = 1.0f;
     } else {
-        grassland::LogError("Failed to save screenshot: {}", filename);
+        film_->GetAccumulatedColorImage()->DownloadData(accumulated_colors.data());
     }
+    screenshot_writer_->Submit(std::move(accumulated_colors), filename, width, height, 1.0f / divisor, tone_mapping_,
+                               sample_count);
 }
 
 void Application::RenderInfoOverlay() {
@@ -556,6 +598,9 @@ void Application::RenderInfoOverlay() {
     size_t entity_count = scene_->GetEntityCount();
     ImGui::Text("Entities: %zu", entity_count);
     ImGui::Text("Materials: %zu", entity_count); // One material per entity
+    if (size_t loading = scene_->GetPendingEntityCount()) {
+        ImGui::Text("Loading: %zu entities", loading);
+    }
     
     // Show hovered entity
     if (hovered_entity_id_ >= 0) {
@@ -598,9 +643,9 @@ void Application::RenderInfoOverlay() {
     // Calculate total triangles
     size_t total_triangles = 0;
     for (const auto& entity : scene_->GetEntities()) {
-        if (entity && entity->GetIndexBuffer()) {
+        if (entity && entity->IsValid()) {
             // Each 3 indices = 1 triangle
-            size_t indices = entity->GetIndexBuffer()->Size() / sizeof(uint32_t);
+            size_t indices = entity->GetIndexCount();
             total_triangles += indices / 3;
         }
     }
@@ -611,9 +656,46 @@ void Application::RenderInfoOverlay() {
     // Render Information
     ImGui::SeparatorText("Render");
     ImGui::Text("Resolution: %d x %d", window_->GetWidth(), window_->GetHeight());
-    ImGui::Text("Backend: %s", 
-                core_->API() == grassland::graphics::BACKEND_API_VULKAN ? "Vulkan" : "D3D12");
+    ImGui::Text("Backend: %s%s", 
+                core_->API() == grassland::graphics::BACKEND_API_VULKAN ? "Vulkan" : "D3D12",
+                cpu_rendering_ ? " (CPU ray tracing)" : "");
     ImGui::Text("Device: %s", core_->DeviceName().c_str());
+    // EXR and PFM keep the linear HDR radiance that PNG clamps away
+    int screenshot_format = static_cast<int>(screenshot_format_);
+    if (ImGui::Combo("Screenshot format", &screenshot_format, "PNG (8-bit)\0OpenEXR (half float)\0PFM (float)\0")) {
+        screenshot_format_ = static_cast<ScreenshotFormat>(screenshot_format);
+    }
+    // Display and PNG post-process; the accumulation itself stays linear
+    bool tone_mapping_changed = ImGui::SliderFloat("Exposure (EV)", &tone_mapping_.exposure, -8.0f, 8.0f, "%.1f");
+    int tone_curve = static_cast<int>(tone_mapping_.curve);
+    if (ImGui::Combo("Tone curve", &tone_curve, "Clamp\0Reinhard\0ACES\0Filmic\0")) {
+        tone_mapping_.curve = static_cast<ToneCurve>(tone_curve);
+        tone_mapping_changed = true;
+    }
+    tone_mapping_changed |= ImGui::Checkbox("sRGB encoding", &tone_mapping_.srgb);
+    tone_mapping_changed |= ImGui::Checkbox("Dither", &tone_mapping_.dither);
+    // The CPU backend has no Film; OnRenderCpu reads tone_mapping_ every frame
+    if (tone_mapping_changed && film_) {
+        film_->SetToneMapping(tone_mapping_);
+    }
+    if (cpu_rendering_) {
+        // Restart accumulation so the image is not a mix of both sequences
+        int sampler = static_cast<int>(cpu_renderer_->GetSamplerType());
+        if (ImGui::Combo("Sampler", &sampler, "Sobol (Owen scrambled)\0Blue-noise lattice\0")) {
+            cpu_renderer_->SetSamplerType(static_cast<SamplerType>(sampler));
+            cpu_film_->Reset();
+        }
+        ImGui::Checkbox("Denoise", &cpu_denoise_);
+        bool compensated = cpu_film_->GetPrecision() == FilmPrecision::kCompensated;
+        if (ImGui::Checkbox("Compensated accumulation", &compensated)) {
+            cpu_film_->SetPrecision(compensated ? FilmPrecision::kCompensated : FilmPrecision::kFloat);
+        }
+        // Both schedules trace the same paths, so accumulation carries on
+        int scheduling = static_cast<int>(cpu_renderer_->GetPathScheduling());
+        if (ImGui::Combo("Path scheduling", &scheduling, "Per pixel\0Wavefront\0")) {
+            cpu_renderer_->SetPathScheduling(static_cast<PathScheduling>(scheduling));
+        }
+    }
     
     ImGui::Spacing();
     
@@ -621,12 +703,26 @@ void Application::RenderInfoOverlay() {
     ImGui::SeparatorText("Accumulation");
     if (!camera_enabled_) {
         ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Status: Active");
-        ImGui::Text("Samples: %d", film_->GetSampleCount());
+        ImGui::Text("Samples: %d", cpu_rendering_ ? cpu_film_->GetSampleCount() : film_->GetSampleCount());
+        if (cpu_rendering_) {
+            ImGui::Text("Converged tiles: %zu / %zu",
+                        cpu_film_->GetTileCount() - cpu_film_->GetActiveTileCount(), cpu_film_->GetTileCount());
+        }
+    } else if (cpu_rendering_) {
+        ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Status: Reprojecting");
+        ImGui::Text("Samples: %d", cpu_film_->GetSampleCount());
     } else {
         ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Status: Paused");
         ImGui::Text("(Disable camera to accumulate)");
     }
 
+    if (size_t pending = screenshot_writer_->GetPendingCount()) {
+        ImGui::Text("Saving %zu screenshot(s)...", pending);
+    }
+    if (!camera_path_.IsEmpty()) {
+        ImGui::Text("Camera keyframes: %zu (%.0f s)", camera_path_.GetKeyframeCount(), camera_path_.GetEndTime());
+    }
+
     ImGui::Spacing();
 
     // Controls hint
@@ -638,6 +734,7 @@ void Application::RenderInfoOverlay() {
     ImGui::Spacing();
     ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.5f, 1.0f), "Hold Tab to hide UI");
     ImGui::TextColored(ImVec4(0.5f, 1.0f, 1.0f, 1.0f), "Ctrl+S to save screenshot");
+    ImGui::TextColored(ImVec4(0.5f, 1.0f, 1.0f, 1.0f), "Ctrl+K to add camera keyframe");
 
     ImGui::End();
 }
@@ -741,17 +838,12 @@ void Application::RenderEntityPanel() {
         
         // Mesh information
         ImGui::SeparatorText("Mesh");
-        if (entity->GetIndexBuffer()) {
-            size_t index_count = entity->GetIndexBuffer()->Size() / sizeof(uint32_t);
+        if (entity->IsValid()) {
+            size_t index_count = entity->GetIndexCount();
             size_t triangle_count = index_count / 3;
             ImGui::Text("Triangles: %zu", triangle_count);
             ImGui::Text("Indices: %zu", index_count);
-        }
-        
-        if (entity->GetVertexBuffer()) {
-            size_t vertex_size = sizeof(float) * 3; // Assuming pos(3)
-            size_t vertex_count = entity->GetVertexBuffer()->Size() / vertex_size;
-            ImGui::Text("Vertices: %zu", vertex_count);
+            ImGui::Text("Vertices: %zu", entity->GetVertexCount());
         }
         
         ImGui::Spacing();
@@ -760,6 +852,8 @@ void Application::RenderEntityPanel() {
         ImGui::SeparatorText("Acceleration Structure");
         if (entity->GetBLAS()) {
             ImGui::Text("BLAS: Built");
+        } else if (entity->GetCpuBLAS()) {
+            ImGui::Text("BLAS: Built (CPU, %zu BVH8 nodes)", entity->GetCpuBLAS()->GetWideBvh().GetNodeCount());
         } else {
             ImGui::Text("BLAS: Not built");
         }
@@ -778,6 +872,11 @@ void Application::OnRender() {
         return;
     }
 
+    if (cpu_rendering_) {
+        OnRenderCpu();
+        return;
+    }
+
     std::unique_ptr<grassland::graphics::CommandContext> command_context;
     core_->CreateCommandContext(&command_context);
     command_context->CmdClearImage(color_image_.get(), { {0.6, 0.7, 0.8, 1.0} });
@@ -785,22 +884,24 @@ void Application::OnRender() {
     // Clear entity ID buffer with -1 (no entity)
     command_context->CmdClearImage(entity_id_image_.get(), { {-1, 0, 0, 0} });
     
-    command_context->CmdBindRayTracingProgram(program_.get());
-    command_context->CmdBindResources(0, scene_->GetTLAS(), grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(1, { color_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(2, { camera_object_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(3, { scene_->GetMaterialsBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(4, { hover_info_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(5, { entity_id_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(6, { film_->GetAccumulatedColorImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(7, { film_->GetAccumulatedSamplesImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdDispatchRays(window_->GetWidth(), window_->GetHeight(), 1);
+    // Nothing to trace until the first entities finish loading
+    if (scene_->GetTLAS()) {
+        command_context->CmdBindRayTracingProgram(program_.get());
+        command_context->CmdBindResources(0, scene_->GetTLAS(), grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(1, { color_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(2, { camera_object_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(3, { scene_->GetMaterialsBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(4, { hover_info_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(5, { entity_id_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(6, { film_->GetAccumulatedColorImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdBindResources(7, { film_->GetAccumulatedSamplesImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
+        command_context->CmdDispatchRays(window_->GetWidth(), window_->GetHeight(), 1);
+    }
     
     // When camera is disabled, increment sample count and use accumulated image
     grassland::graphics::Image* display_image = color_image_.get();
     if (!camera_enabled_) {
         film_->IncrementSampleCount();
-        film_->DevelopToOutput();
         display_image = film_->GetOutputImage();
     }
     
@@ -818,3 +919,43 @@ void Application::OnRender() {
     command_context->CmdPresent(window_.get(), display_image);
     core_->SubmitCommandContext(command_context.get());
 }
+
+void Application::OnRenderCpu() {
+    // When the camera moved, the accumulated samples are reprojected into the new view
+    // (which also makes every tile active), so the image keeps converging while navigating
+    if (std::memcmp(&cpu_film_camera_, &camera_object_, sizeof(CameraObject)) != 0) {
+        if (cpu_film_->GetSampleCount() > 0) {
+            cpu_film_->Reproject(cpu_film_camera_, camera_object_);
+        }
+        cpu_film_camera_ = camera_object_;
+    }
+
+    // Trace on the CPU, then upload the results into the same images the GPU path uses
+    cpu_renderer_->Render(*scene_, camera_object_, cpu_film_.get());
+    entity_id_image_->UploadData(cpu_film_->GetEntityIdData());
+
+    // Converged tiles are skipped from the next frame on
+    cpu_film_->IncrementSampleCount();
+    cpu_film_->UpdateConvergence(kAdaptiveNoiseThreshold, kAdaptiveMinSamples);
+    const glm::vec4* colors = cpu_denoise_ ? cpu_denoiser_->Denoise(*cpu_film_, true) : cpu_film_->GetOutputData();
+    cpu_display_.resize(static_cast<size_t>(cpu_film_->GetWidth()) * cpu_film_->GetHeight());
+    ToneMapper::Apply(tone_mapping_, colors, cpu_display_.data(), cpu_film_->GetWidth(), cpu_film_->GetHeight());
+    color_image_->UploadData(cpu_display_.data());
+
+    // Apply hover highlighting as post-process (doesn't affect accumulation)
+    if (hovered_entity_id_ >= 0 && !camera_enabled_) {
+        ApplyHoverHighlight(color_image_.get());
+    }
+
+    std::unique_ptr<grassland::graphics::CommandContext> command_context;
+    core_->CreateCommandContext(&command_context);
+
+    // Render ImGui overlay
+    window_->BeginImGuiFrame();
+    RenderInfoOverlay();
+    RenderEntityPanel();
+    window_->EndImGuiFrame();
+
+    command_context->CmdPresent(window_.get(), color_image_.get());
+    core_->SubmitCommandContext(command_context.get());
+}
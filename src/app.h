@@ -2,13 +2,14 @@
 #include "long_march.h"
 #include "Scene.h"
 #include "Film.h"
+#include "Camera.h"
+#include "CameraPath.h"
+#include "CpuDenoiser.h"
+#include "CpuFilm.h"
+#include "CpuRenderer.h"
+#include "ScreenshotWriter.h"
 #include <memory>
 
-struct CameraObject {
-    glm::mat4 screen_to_camera;
-    glm::mat4 camera_to_world;
-};
-
 class Application {
 public:
     Application(grassland::graphics::BackendAPI api = grassland::graphics::BACKEND_API_DEFAULT);
@@ -19,6 +20,7 @@ public:
     void OnClose();
     void OnUpdate();
     void OnRender();
+    void OnRenderCpu(); // Render path for the CPU ray tracing backend
     void UpdateHoveredEntity(); // Update which entity the mouse is hovering over
     void RenderEntityPanel(); // Render entity inspector panel on the right
 
@@ -37,6 +39,22 @@ private:
     // Film for accumulation
     std::unique_ptr<Film> film_;
 
+    // CPU ray tracing backend (used when the device has no ray tracing support)
+    bool cpu_rendering_{ false };
+    std::unique_ptr<CpuFilm> cpu_film_;
+    std::unique_ptr<CpuRenderer> cpu_renderer_;
+    std::unique_ptr<CpuDenoiser> cpu_denoiser_;
+
+    // Encodes screenshots in the background
+    std::unique_ptr<ScreenshotWriter> screenshot_writer_;
+    ScreenshotFormat screenshot_format_{ ScreenshotFormat::kPng }; // Format of Ctrl+S captures
+    ToneMapSettings tone_mapping_; // Display and PNG screenshot post-process
+    std::vector<glm::vec4> cpu_display_; // Tone mapped CPU film output, uploaded for display
+    CameraPath camera_path_; // Keyframes recorded with Ctrl+K, for ShortMarchRender --path
+    bool cpu_denoise_{ false }; // Show and save the denoised image
+    CameraObject camera_object_{}; // Last camera uploaded, also read by the CPU renderer
+    CameraObject cpu_film_camera_{}; // Camera the CPU film's samples were taken from
+
     // Camera
     std::unique_ptr<grassland::graphics::Buffer> camera_object_buffer_;
     
@@ -70,7 +88,7 @@ private:
     void OnMouseButton(int button, int action, int mods, double xpos, double ypos); // Mouse button event handler
     void RenderInfoOverlay(); // Render the info overlay
     void ApplyHoverHighlight(grassland::graphics::Image* image); // Apply hover highlighting as post-process
-    void SaveAccumulatedOutput(const std::string& filename); // Save accumulated output to PNG file
+    void SaveAccumulatedOutput(const std::string& filename); // Save accumulated output (PNG, EXR or PFM by extension)
 
     float yaw_;
     float pitch_;
@@ -0,0 +1,435 @@
+// Headless batch renderer: loads a scene, renders it with the CPU backend and
+// writes the image (or the frames of a camera path), without creating a window, a
+// graphics device or ImGui
+#include "Scene.h"
+#include "Entity.h"
+#include "Camera.h"
+#include "CameraPath.h"
+#include "CpuDenoiser.h"
+#include "CpuFilm.h"
+#include "CpuRenderer.h"
+#include "ExrWriter.h"
+#include "FrameWriter.h"
+#include "PfmWriter.h"
+#include "PngWriter.h"
+#include "Sampler.h"
+#include "ThreadPool.h"
+#include "ToneMapper.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct RenderOptions {
+    std::string scene_path;  // Empty: the demo scene
+    std::string output_path = "render.png";
+    int width = 1280;
+    int height = 720;
+    int spp = 16;
+    glm::vec3 camera_pos{ 0.0f, 1.0f, 5.0f };
+    glm::vec3 camera_target{ 0.0f, 1.0f, 4.0f };
+    float fov = 60.0f;  // Vertical, in degrees
+    SamplerType sampler = SamplerType::kSobol;
+    PathScheduling scheduling = PathScheduling::kPerPixel;
+    float noise_threshold = 0.0f;  // Adaptive sampling when > 0
+    int min_spp = 16;
+    int denoise_iterations = 0;  // Denoise the output when > 0
+    FilmPrecision precision = FilmPrecision::kFloat;
+    PngCompression png_compression = PngCompression::kDefault;
+    ExrOptions exr;
+    ToneMapSettings tone_mapping;  // 8-bit output: PNG images and sequences, Y4M video
+    std::string camera_path;  // Render an animation along this path when set
+    int fps = 30;
+};
+
+void PrintUsage() {
+    std::printf(
+        "Usage: ShortMarchRender [options]\n"
+        "  --scene FILE       Scene description (default: the demo scene)\n"
+        "  --output FILE      Output image, PNG unless it ends in .exr or .pfm (default: render.png)\n"
+        "  --size WxH         Image size (default: 1280x720)\n"
+        "  --spp N            Samples per pixel (default: 16; the maximum with --noise)\n"
+        "  --noise T          Stop sampling tiles whose relative noise is at most T\n"
+        "  --min-spp N        Samples before a tile may converge (default: 16)\n"
+        "  --camera X,Y,Z     Camera position (overrides the scene's camera)\n"
+        "  --target X,Y,Z     Point the camera looks at\n"
+        "  --fov DEGREES      Vertical field of view\n"
+        "  --sampler NAME     Pixel sample sequence: sobol (default) or bluenoise\n"
+        "  --schedule NAME    Path scheduling: pixel (default) or wavefront\n"
+        "  --precision NAME   Sample sums: float (default) or compensated (Kahan, for very high spp)\n"
+        "  --denoise N        Denoise the image with N a-trous passes (typically 5; default: off)\n"
+        "  --png NAME         PNG compression: default or fast (larger files)\n"
+        "  --exr-type NAME    EXR pixels: half (default) or float\n"
+        "  --exr-compression NAME  EXR compression: zip (default) or none\n"
+        "  --exr-tile N       Write a tiled EXR with NxN tiles (default: 0, scanlines)\n"
+        "  --exposure EV      Exposure in stops of 8-bit output (PNG, Y4M) (default: 0)\n"
+        "  --tonemap NAME     Tone curve of 8-bit output: clamp (default), reinhard, aces or filmic\n"
+        "  --srgb on|off      Encode PNG output with the sRGB transfer function (default: off;\n"
+        "                     Y4M video is always encoded)\n"
+        "  --dither on|off    Ordered dithering of the 8-bit quantization (default: off)\n"
+        "  --path FILE        Render every frame of a camera path; --output is then an image\n"
+        "                     sequence (frame_####.png, .exr or .pfm) or a .y4m video file or pipe\n"
+        "  --fps N            Frames per second of the camera path (default: 30)\n"
+        "\n"
+        "Scene files hold one statement per line ('#' starts a comment):\n"
+        "  entity MESH R G B ROUGHNESS METALLIC TX TY TZ [SX SY SZ]\n"
+        "  camera X Y Z TARGET_X TARGET_Y TARGET_Z [FOV]\n"
+        "Camera path files hold one keyframe per line (yaw and pitch in degrees, as in the viewer):\n"
+        "  key TIME X Y Z YAW PITCH\n");
+}
+
+bool ParseVec3(const std::string& text, glm::vec3& value) {
+    return std::sscanf(text.c_str(), "%f,%f,%f", &value.x, &value.y, &value.z) == 3;
+}
+
+// Returns false (after printing why) on malformed arguments
+bool ParseArguments(int argc, char** argv, RenderOptions& options, bool& camera_set) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--scene") {
+            options.scene_path = value;
+        } else if (arg == "--output") {
+            options.output_path = value;
+        } else if (arg == "--size") {
+            ok = std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) == 2 &&
+                 options.width > 0 && options.height > 0;
+        } else if (arg == "--spp") {
+            options.spp = std::atoi(value.c_str());
+            ok = options.spp > 0;
+        } else if (arg == "--noise") {
+            options.noise_threshold = static_cast<float>(std::atof(value.c_str()));
+            ok = options.noise_threshold >= 0.0f;
+        } else if (arg == "--min-spp") {
+            options.min_spp = std::atoi(value.c_str());
+            ok = options.min_spp > 0;
+        } else if (arg == "--camera") {
+            ok = ParseVec3(value, options.camera_pos);
+            camera_set = true;
+        } else if (arg == "--target") {
+            ok = ParseVec3(value, options.camera_target);
+            camera_set = true;
+        } else if (arg == "--fov") {
+            options.fov = static_cast<float>(std::atof(value.c_str()));
+            ok = options.fov > 0.0f && options.fov < 180.0f;
+            camera_set = true;
+        } else if (arg == "--sampler") {
+            ok = Sampler::ParseType(value.c_str(), options.sampler);
+        } else if (arg == "--precision") {
+            ok = value == "float" || value == "compensated";
+            options.precision = value == "compensated" ? FilmPrecision::kCompensated : FilmPrecision::kFloat;
+        } else if (arg == "--denoise") {
+            options.denoise_iterations = std::atoi(value.c_str());
+            ok = options.denoise_iterations >= 0;
+        } else if (arg == "--png") {
+            ok = value == "default" || value == "fast";
+            options.png_compression = value == "fast" ? PngCompression::kFast : PngCompression::kDefault;
+        } else if (arg == "--exr-type") {
+            ok = value == "half" || value == "float";
+            options.exr.pixel_type = value == "float" ? ExrPixelType::kFloat : ExrPixelType::kHalf;
+        } else if (arg == "--exr-compression") {
+            ok = value == "zip" || value == "none";
+            options.exr.compression = value == "none" ? ExrCompression::kNone : ExrCompression::kZip;
+        } else if (arg == "--exr-tile") {
+            options.exr.tile_size = std::atoi(value.c_str());
+            ok = options.exr.tile_size >= 0;
+        } else if (arg == "--exposure") {
+            options.tone_mapping.exposure = static_cast<float>(std::atof(value.c_str()));
+        } else if (arg == "--tonemap") {
+            ok = ToneMapper::ParseCurve(value.c_str(), options.tone_mapping.curve);
+        } else if (arg == "--srgb") {
+            ok = value == "on" || value == "off";
+            options.tone_mapping.srgb = value == "on";
+        } else if (arg == "--dither") {
+            ok = value == "on" || value == "off";
+            options.tone_mapping.dither = value == "on";
+        } else if (arg == "--path") {
+            options.camera_path = value;
+        } else if (arg == "--fps") {
+            options.fps = std::atoi(value.c_str());
+            ok = options.fps > 0;
+        } else if (arg == "--schedule") {
+            ok = value == "pixel" || value == "wavefront";
+            options.scheduling = value == "wavefront" ? PathScheduling::kWavefront : PathScheduling::kPerPixel;
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", arg.c_str(), value.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same entities as Application::OnInit
+void AddDemoScene(Scene& scene) {
+    scene.AddEntityAsync(
+        "meshes/cube.obj",
+        Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.8f, 0.0f),
+        glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), glm::vec3(10.0f, 0.1f, 10.0f)));
+    scene.AddEntityAsync(
+        "meshes/octahedron.obj",
+        Material(glm::vec3(1.0f, 0.2f, 0.2f), 0.3f, 0.0f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, 0.5f, 0.0f)));
+    scene.AddEntityAsync(
+        "meshes/octahedron.obj",
+        Material(glm::vec3(0.2f, 1.0f, 0.2f), 0.2f, 0.8f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 0.0f)));
+    scene.AddEntityAsync(
+        "meshes/cube.obj",
+        Material(glm::vec3(0.2f, 0.2f, 1.0f), 0.5f, 0.0f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.5f, 0.0f)));
+}
+
+// Queue the entities of a scene file; its camera is used unless given on the command line
+bool LoadSceneFile(const std::string& path, Scene& scene, RenderOptions& options, bool camera_set) {
+    std::ifstream file(path);
+    if (!file) {
+        grassland::LogError("Failed to open scene file: {}", path);
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+        std::string statement;
+        if (!(stream >> statement)) {
+            continue;
+        }
+
+        if (statement == "entity") {
+            std::string mesh;
+            glm::vec3 color, translation, scale(1.0f);
+            float roughness, metallic;
+            if (!(stream >> mesh >> color.r >> color.g >> color.b >> roughness >> metallic >>
+                  translation.x >> translation.y >> translation.z)) {
+                grassland::LogError("{}:{}: malformed entity", path, line_number);
+                return false;
+            }
+            stream >> scale.x >> scale.y >> scale.z;
+            scene.AddEntityAsync(mesh, Material(color, roughness, metallic),
+                                 glm::scale(glm::translate(glm::mat4(1.0f), translation), scale));
+        } else if (statement == "camera") {
+            glm::vec3 position, target;
+            float fov = options.fov;
+            if (!(stream >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z)) {
+                grassland::LogError("{}:{}: malformed camera", path, line_number);
+                return false;
+            }
+            stream >> fov;
+            if (!camera_set) {
+                options.camera_pos = position;
+                options.camera_target = target;
+                options.fov = fov;
+            }
+        } else {
+            grassland::LogError("{}:{}: unknown statement '{}'", path, line_number, statement);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WritePng(const RenderOptions& options, const glm::vec4* colors) {
+    std::vector<uint8_t> bytes(static_cast<size_t>(options.width) * options.height * 4);
+    ToneMapper::Quantize(options.tone_mapping, colors, bytes.data(), options.width, options.height);
+    return PngWriter::Write(options.output_path, bytes.data(), options.width, options.height, 4, options.png_compression);
+}
+
+// Write in the format given by the path's extension; EXR and PFM keep the linear radiance
+bool WriteImage(const RenderOptions& options, const glm::vec4* colors) {
+    std::string extension = std::filesystem::path(options.output_path).extension().string();
+    if (extension == ".exr") {
+        return ExrWriter::Write(options.output_path, colors, options.width, options.height, options.exr);
+    }
+    if (extension == ".pfm") {
+        return PfmWriter::Write(options.output_path, colors, options.width, options.height);
+    }
+    return WritePng(options, colors);
+}
+
+CameraObject MakeCamera(const RenderOptions& options, const glm::vec3& position, const glm::vec3& target) {
+    CameraObject camera{};
+    camera.screen_to_camera = glm::inverse(
+        glm::perspective(glm::radians(options.fov), (float)options.width / (float)options.height, 0.1f, 10.0f));
+    camera.camera_to_world = glm::inverse(glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    return camera;
+}
+
+// Accumulate up to options.spp samples (fewer once every tile converged with --noise)
+void RenderSamples(const RenderOptions& options, const Scene& scene, const CameraObject& camera,
+                   const CpuRenderer& renderer, CpuFilm& film) {
+    for (int sample = 0; sample < options.spp; ++sample) {
+        renderer.Render(scene, camera, &film);
+        film.IncrementSampleCount();
+        if (options.noise_threshold > 0.0f && film.UpdateConvergence(options.noise_threshold, options.min_spp) == 0) {
+            break;
+        }
+    }
+}
+
+// Render every frame of the camera path and stream them to options.output_path; the
+// writer encodes each frame while the next one renders
+int RenderAnimation(const RenderOptions& options, const Scene& scene) {
+    CameraPath path;
+    if (!path.Load(options.camera_path)) {
+        return 1;
+    }
+    const int frame_count =
+        static_cast<int>(std::floor((path.GetEndTime() - path.GetStartTime()) * options.fps + 1e-3f)) + 1;
+
+    FrameWriterOptions writer_options;
+    writer_options.fps = options.fps;
+    writer_options.tone_mapping = options.tone_mapping;
+    writer_options.png_compression = options.png_compression;
+    writer_options.exr = options.exr;
+    FrameWriter writer(options.output_path, options.width, options.height, writer_options);
+
+    CpuFilm film(options.width, options.height);
+    film.SetPrecision(options.precision);
+    CpuRenderer renderer;
+    renderer.SetSamplerType(options.sampler);
+    renderer.SetPathScheduling(options.scheduling);
+    CpuDenoiser denoiser;
+    denoiser.SetIterations(options.denoise_iterations);
+
+    using Clock = std::chrono::steady_clock;
+    auto render_start = Clock::now();
+    int frames = 0;
+    for (; frames < frame_count; ++frames) {
+        const CameraKeyframe pose = path.Evaluate(path.GetStartTime() + static_cast<float>(frames) / options.fps);
+        const CameraObject camera =
+            MakeCamera(options, pose.position, pose.position + CameraPath::GetFront(pose.yaw, pose.pitch));
+        film.Reset();
+        RenderSamples(options, scene, camera, renderer, film);
+
+        const glm::vec4* colors = options.denoise_iterations > 0 ? denoiser.Denoise(film, true) : film.GetOutputData();
+        std::vector<glm::vec4> buffer = writer.AcquireBuffer();
+        std::memcpy(buffer.data(), colors, buffer.size() * sizeof(glm::vec4));
+        if (!writer.Push(std::move(buffer))) {
+            break;
+        }
+    }
+    const bool written = writer.Finish();
+    double seconds = std::max(std::chrono::duration<double>(Clock::now() - render_start).count(), 1e-9);
+    if (!written) {
+        grassland::LogError("Failed to write the frames of {}", options.output_path);
+        return 1;
+    }
+
+    std::printf("animation: %d frames at %d fps, %dx%d, up to %d spp, %zu threads, %.3f s (%.2f frames/sec)\n",
+                frames, options.fps, options.width, options.height, options.spp,
+                ThreadPool::Global().GetThreadCount(), seconds, frames / seconds);
+    std::printf("encoder stalls: %.3f s\n", writer.GetStallSeconds());
+    std::printf("rays/sec: %.0f\n", static_cast<double>(renderer.GetRayCount()) / seconds);
+    std::printf("output: %s\n", options.output_path.c_str());
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    RenderOptions options;
+    bool camera_set = false;
+    if (!ParseArguments(argc, argv, options, camera_set)) {
+        PrintUsage();
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto load_start = Clock::now();
+
+    // Meshes load on the background pool in parallel; one TLAS build once all are in
+    Scene scene(nullptr);
+    if (options.scene_path.empty()) {
+        AddDemoScene(scene);
+    } else if (!LoadSceneFile(options.scene_path, scene, options, camera_set)) {
+        return 1;
+    }
+    scene.WaitForLoads();
+    if (scene.PublishLoadedEntities() == 0) {
+        grassland::LogError("Scene has no entities that could be loaded");
+        return 1;
+    }
+    double load_seconds = std::chrono::duration<double>(Clock::now() - load_start).count();
+    if (!options.camera_path.empty()) {
+        std::printf("scene: %zu entities, loaded in %.3f s\n", scene.GetEntityCount(), load_seconds);
+        return RenderAnimation(options, scene);
+    }
+
+    const CameraObject camera = MakeCamera(options, options.camera_pos, options.camera_target);
+
+    CpuFilm film(options.width, options.height);
+    film.SetPrecision(options.precision);
+    CpuRenderer renderer;
+    renderer.SetSamplerType(options.sampler);
+    renderer.SetPathScheduling(options.scheduling);
+    auto render_start = Clock::now();
+    RenderSamples(options, scene, camera, renderer, film);
+    double render_seconds = std::max(std::chrono::duration<double>(Clock::now() - render_start).count(), 1e-9);
+
+    const glm::vec4* colors = film.GetOutputData();
+    double denoise_seconds = 0.0;
+    CpuDenoiser denoiser;
+    if (options.denoise_iterations > 0) {
+        auto denoise_start = Clock::now();
+        denoiser.SetIterations(options.denoise_iterations);
+        colors = denoiser.Denoise(film, true);
+        denoise_seconds = std::chrono::duration<double>(Clock::now() - denoise_start).count();
+    }
+
+    if (!WriteImage(options, colors)) {
+        grassland::LogError("Failed to write {}", options.output_path);
+        return 1;
+    }
+
+    // Converged tiles stop early, so count the samples every pixel actually received
+    double samples = 0.0;
+    const int32_t* pixel_samples = film.GetAccumulatedSamplesData();
+    for (size_t i = 0; i < static_cast<size_t>(options.width) * options.height; ++i) {
+        samples += pixel_samples[i];
+    }
+    double rays = static_cast<double>(renderer.GetRayCount());
+    std::printf("scene: %zu entities, loaded in %.3f s\n", scene.GetEntityCount(), load_seconds);
+    std::printf("render: %dx%d, %d spp (%s, %s), %zu threads, %.3f s\n",
+                options.width, options.height, film.GetSampleCount(), Sampler::GetTypeName(options.sampler),
+                options.scheduling == PathScheduling::kWavefront ? "wavefront" : "per pixel",
+                ThreadPool::Global().GetThreadCount(), render_seconds);
+    if (options.noise_threshold > 0.0f) {
+        std::printf("adaptive: %.1f mean spp, %zu / %zu tiles converged, noise %.4f\n",
+                    samples / (static_cast<double>(options.width) * options.height),
+                    film.GetTileCount() - film.GetActiveTileCount(), film.GetTileCount(), film.GetNoiseLevel());
+    }
+    if (options.denoise_iterations > 0) {
+        std::printf("denoise: %d passes, %.3f s\n", options.denoise_iterations, denoise_seconds);
+    }
+    std::printf("samples/sec: %.0f\n", samples / render_seconds);
+    std::printf("rays/sec: %.0f\n", rays / render_seconds);
+    std::printf("output: %s\n", options.output_path.c_str());
+    return 0;
+}
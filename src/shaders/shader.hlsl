@@ -29,9 +29,54 @@ struct RayPayload {
   uint instance_id;
 };
 
+// Owen-scrambled Sobol points, dimensions 0 and 1 of Sampler::SobolSample on the CPU
+uint Hash(uint x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+uint HashCombine(uint seed, uint value) {
+  return Hash(seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+}
+
+uint NestedUniformScramble(uint x, uint seed) {
+  x = reversebits(x);
+  x ^= x * 0x3d20adeau;
+  x += seed;
+  x *= (seed >> 16) | 1;
+  x ^= x * 0x05526c56u;
+  x ^= x * 0x53a22864u;
+  return reversebits(x);
+}
+
+float2 SobolSample2D(uint index, uint seed) {
+  index = NestedUniformScramble(index, HashCombine(seed, 0));
+  // Dimension 0 is the van der Corput sequence, dimension 1 has the Pascal matrix
+  uint x = reversebits(index);
+  uint y = 0;
+  for (uint v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+    if (index & 1) {
+      y ^= v;
+    }
+  }
+  x = NestedUniformScramble(x, HashCombine(seed, 0 + 0x9e3779b9u));
+  y = NestedUniformScramble(y, HashCombine(seed, 1 + 0x9e3779b9u));
+  return float2(x >> 8, y >> 8) * (1.0 / 16777216.0);
+}
+
 [shader("raygeneration")] void RayGenMain() {
-  float2 pixel_center = (float2)DispatchRaysIndex() + float2(0.5, 0.5);
-  float2 uv = pixel_center / float2(DispatchRaysDimensions().xy);
+  uint2 pixel_coords = DispatchRaysIndex().xy;
+  int prev_samples = accumulated_samples[pixel_coords];
+
+  // Sample i of a pixel goes through point i of its own scrambled sequence, so
+  // accumulation anti-aliases instead of repeating the pixel center
+  uint pixel_seed = HashCombine(Hash(pixel_coords.x), pixel_coords.y);
+  float2 film_position = (float2)pixel_coords + SobolSample2D((uint)prev_samples, pixel_seed);
+  float2 uv = film_position / float2(DispatchRaysDimensions().xy);
   uv.y = 1.0 - uv.y;
   float2 d = uv * 2.0 - 1.0;
   float4 origin = mul(camera_info.camera_to_world, float4(0, 0, 0, 1));
@@ -54,8 +99,7 @@ struct RayPayload {
 
   TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, ray, payload);
 
-  uint2 pixel_coords = DispatchRaysIndex().xy;
-  
+
   // Write to immediate output (for camera movement mode)
   output[pixel_coords] = float4(payload.color, 1);
   
@@ -65,8 +109,7 @@ struct RayPayload {
   
   // Accumulate color for progressive rendering (when camera is stationary)
   float4 prev_color = accumulated_color[pixel_coords];
-  int prev_samples = accumulated_samples[pixel_coords];
-  
+
   accumulated_color[pixel_coords] = prev_color + float4(payload.color, 1);
   accumulated_samples[pixel_coords] = prev_samples + 1;
 }
@@ -0,0 +1,3 @@
+// Single definition of the stb_image_write functions, shared by the demo and the headless renderer
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"